@@ -0,0 +1,52 @@
+//
+// A design of SNP genotypes in {0, 1, 2}, packed 4 to a byte (2 bits each) column by column,
+// so that it takes 1/32 of the memory of a double matrix.
+//
+#ifndef SRC_GENOTYPEMATRIX_H
+#define SRC_GENOTYPEMATRIX_H
+
+#ifdef R_BUILD
+#include <RcppEigen.h>
+#else
+#include <Eigen/Eigen>
+#endif
+#include <stdint.h>
+#include <vector>
+
+// Sample i of column j is in bits 2 * (i % 4) of byte j * stride + i / 4, where stride = ceil(n / 4).
+// The code 3 is a missing genotype, which is read as the mean of the observed ones.
+// Column j is read through the table values.col(j): a code k is the value values(k, j),
+// so normalization only changes the table, never the codes.
+class GenotypeMatrix
+{
+public:
+    Eigen::Matrix<double, 4, Eigen::Dynamic> values;
+
+    GenotypeMatrix() = default;
+    GenotypeMatrix(const uint8_t *codes, int n, int p);
+
+    int rows() const { return this->n; };
+    int cols() const { return this->p; };
+
+    int code(int i, int j) const { return (this->codes[(int64_t)j * this->stride + i / 4] >> (2 * (i % 4))) & 3; };
+
+    // column j, as values
+    void unpack(int j, double *x) const;
+
+    // sums of r over the samples of each code of column j, r of length n
+    void code_sums(int j, const double *r, double *sums) const;
+
+    // x_j^T r
+    double dot(int j, const double *r) const;
+
+    // the rows (axis = 0) or columns (axis = 1) in ind
+    void slice(Eigen::VectorXi &ind, GenotypeMatrix &A, int axis) const;
+
+private:
+    int n = 0;
+    int p = 0;
+    int stride = 0;
+    std::vector<uint8_t> codes;
+};
+
+#endif //SRC_GENOTYPEMATRIX_H
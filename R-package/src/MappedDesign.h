@@ -0,0 +1,109 @@
+//
+// A column-major design matrix kept on disk and read through mmap,
+// so that only the columns in use have to be loaded into memory.
+//
+#ifndef SRC_MAPPEDDESIGN_H
+#define SRC_MAPPEDDESIGN_H
+
+#ifdef R_BUILD
+#include <RcppEigen.h>
+#else
+#include <Eigen/Eigen>
+#endif
+#include <stdint.h>
+#include <memory>
+
+// layout of the file:
+//   header (64 bytes)
+//   x_mean[p], x_norm[p]   column mean and centered norm with unit weights
+//   columns[n * p]         from data_offset, which is page aligned
+struct MappedDesignHeader
+{
+    char magic[8]; // "ABESSX01"
+    int32_t version;
+    int32_t dtype; // 0: float64
+    int64_t n;
+    int64_t p;
+    int64_t data_offset;
+    int64_t reserved[3];
+};
+
+// the mapping of a file, shared by the designs read from it
+class MappedFile
+{
+public:
+    int n = 0;
+    int p = 0;
+    Eigen::VectorXd x_mean;
+    Eigen::VectorXd x_norm;
+
+    MappedFile(const char *path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool is_open() const { return this->data != NULL; };
+
+    const double *col_ptr(int j) const { return this->data + (int64_t)j * this->n; };
+
+    // hint the kernel to read ahead or to drop the pages of columns [start, start + cols)
+    void advise(int start, int cols, bool need) const;
+
+private:
+    const double *data = NULL;
+    void *map = NULL;
+    int64_t map_size = 0;
+};
+
+// Row i and column j are row row_ind(i) and column col_ind(j) of the file, or the i-th and j-th
+// when they are empty, and a column x is read as scale(j) * x + shift(j): slicing and
+// normalization only change the indices and the table, never the file.
+class MappedDesign
+{
+public:
+    Eigen::VectorXd scale;
+    Eigen::VectorXd shift;
+
+    MappedDesign() = default;
+    MappedDesign(const char *path);
+
+    bool is_open() const { return this->file && this->file->is_open(); };
+
+    int rows() const { return this->n; };
+    int cols() const { return this->p; };
+
+    // the mean and centered norm of the columns with unit weights, from the header of the file;
+    // false if they are not those of this design, as for a slice of the rows or a normalized one
+    bool file_stats(Eigen::VectorXd &x_mean, Eigen::VectorXd &x_norm) const;
+
+    // column j, as values
+    void unpack(int j, double *x) const;
+
+    // x_j^T r
+    double dot(int j, const double *r) const;
+
+    // columns [start, start + cols) as values; the next block is read ahead and this one
+    // released, so that a pass over the columns reads the file once, in order
+    void read_block(int start, int cols, Eigen::MatrixXd &x_block) const;
+
+    // the columns in ind as values, with the same hints column by column
+    void read_cols(Eigen::VectorXi &ind, Eigen::MatrixXd &x_cols) const;
+
+    // the rows (axis = 0) or columns (axis = 1) in ind
+    void slice(Eigen::VectorXi &ind, MappedDesign &A, int axis) const;
+
+    // the hints of MappedFile::advise() for the columns [start, start + cols)
+    void advise(int start, int cols, bool need) const;
+
+private:
+    std::shared_ptr<MappedFile> file;
+    int n = 0;
+    int p = 0;
+    Eigen::VectorXi row_ind;
+    Eigen::VectorXi col_ind;
+
+    int file_col(int j) const { return this->col_ind.size() == 0 ? j : this->col_ind(j); };
+};
+
+#endif //SRC_MAPPEDDESIGN_H
@@ -0,0 +1,225 @@
+//
+// Keeps the normalized design and the quantities derived from it,
+// so that repeated fits on the same X do not rebuild them.
+//
+#ifndef SRC_SESSION_H
+#define SRC_SESSION_H
+
+#ifdef R_BUILD
+#include <RcppEigen.h>
+// [[Rcpp::depends(RcppEigen)]]
+#else
+#include <Eigen/Eigen>
+#endif
+
+#include <vector>
+#include "Data.h"
+#include "Algorithm.h"
+#include "screening.h"
+#include "utilities.h"
+
+// caches of one training set, i.e. the full data or the train part of a fold
+template <class T1, class T4>
+class TrainCache
+{
+public:
+    // depend on x only
+    bool group_XTX_valid = false;
+    Eigen::Matrix<Eigen::MatrixXd, -1, -1> group_XTX;
+    Eigen::Matrix<Eigen::MatrixXd, -1, -1> PhiG;
+    Eigen::Matrix<Eigen::MatrixXd, -1, -1> invPhiG;
+    double PhiG_lambda = 0;
+    bool XTone_valid = false;
+    T1 XTone;
+    Eigen::MatrixXd covariance;
+    Eigen::VectorXi covariance_update_flag;
+
+    // depend on y as well
+    bool XTy_valid = false;
+    T1 XTy;
+
+    template <class T2, class T3>
+    void load(Algorithm<T1, T2, T3, T4> *algorithm, T4 &train_x, T1 &train_y, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int train_n, int p, int N, int M)
+    {
+        if (!this->group_XTX_valid)
+        {
+            this->group_XTX = ::group_XTX<T4>(train_x, algorithm->train_mask, g_index, g_size, train_n, p, N, algorithm->model_type, algorithm->x_center);
+            this->group_XTX_valid = true;
+        }
+        algorithm->update_group_XTX(this->group_XTX);
+
+        // PhiG is rebuilt in fit() when it is empty or the lambda differs
+        algorithm->PhiG = this->PhiG;
+        algorithm->invPhiG = this->invPhiG;
+        algorithm->lambda_level = this->PhiG_lambda;
+
+        if (algorithm->covariance_update)
+        {
+            if (!this->XTone_valid)
+            {
+                Eigen::MatrixXd one = Eigen::MatrixXd::Ones(train_n, M);
+                this->XTone = XTr(train_x, algorithm->train_mask, one, algorithm->x_center);
+                this->covariance.resize(0, 0);
+                this->covariance_update_flag = Eigen::VectorXi::Zero(p);
+                this->XTone_valid = true;
+            }
+            if (!this->XTy_valid)
+            {
+                this->XTy = XTr(train_x, algorithm->train_mask, train_y, algorithm->x_center);
+                this->XTy_valid = true;
+            }
+            algorithm->XTy = this->XTy;
+            algorithm->XTone = this->XTone;
+            algorithm->covariance = this->covariance;
+            algorithm->covariance_update_flag = this->covariance_update_flag;
+        }
+    }
+
+    template <class T2, class T3>
+    void save(Algorithm<T1, T2, T3, T4> *algorithm)
+    {
+        this->PhiG = algorithm->PhiG;
+        this->invPhiG = algorithm->invPhiG;
+        this->PhiG_lambda = algorithm->lambda_level;
+        if (algorithm->covariance_update && this->XTone_valid)
+        {
+            this->covariance = algorithm->covariance;
+            this->covariance_update_flag = algorithm->covariance_update_flag;
+        }
+    }
+};
+
+template <class T1, class T2, class T3, class T4>
+class Session
+{
+public:
+    Data<T1, T2, T3, T4> full_data;
+    Data<T1, T2, T3, T4> screened_data;
+    bool is_screening = false;
+    bool sparse_matrix;
+
+    // the raw response of the last fit
+    T1 y;
+    Eigen::VectorXi status;
+
+    // screening result and the arguments it was computed with
+    bool screening_valid = false;
+    int screening_model_type = 0;
+    int screening_size = 0;
+    Eigen::VectorXi screening_always_select;
+    bool screening_approximate_Newton = false;
+    int screening_max_iter = 0;
+    double screening_epsilon = 0;
+    Eigen::VectorXi screening_A;
+    Eigen::VectorXi screened_always_select;
+
+    // 0 for the full data, k + 1 for the k-th fold
+    std::vector<TrainCache<T1, T4>> train_cache;
+    int cache_model_type = 0;
+    int cache_Kfold = 0;
+
+    template <class T5>
+    Session(T5 &x, T1 &y, int data_type, Eigen::VectorXd &weight, bool is_normal, Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool sparse_matrix, Eigen::VectorXi &row_order)
+        : full_data(x, y, data_type, weight, is_normal, g_index, status, sparse_matrix, row_order)
+    {
+        this->sparse_matrix = sparse_matrix;
+        this->y = y;
+        this->status = status;
+    };
+
+    Data<T1, T2, T3, T4> &data()
+    {
+        return this->is_screening ? this->screened_data : this->full_data;
+    };
+
+    // a new y keeps everything that only depends on x
+    void update_y(T1 &y, Eigen::VectorXi &status)
+    {
+        if (same(y, this->y) && same(status, this->status))
+            return;
+
+        this->y = y;
+        this->status = status;
+        this->full_data.update_y(y, status);
+        this->screening_valid = false;
+        for (unsigned int i = 0; i < this->train_cache.size(); i++)
+        {
+            this->train_cache[i].XTy_valid = false;
+        }
+    };
+
+    // return the screened variables and map always_select into the screened data
+    Eigen::VectorXi screen(bool is_screening, int model_type, int screening_size, Eigen::VectorXi &always_select, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+    {
+        if (!is_screening)
+        {
+            if (this->is_screening)
+            {
+                this->is_screening = false;
+                this->train_cache.clear();
+            }
+            return Eigen::VectorXi::Zero(0);
+        }
+
+        bool valid = this->screening_valid && this->screening_model_type == model_type && this->screening_size == screening_size && same(this->screening_always_select, always_select) && this->screening_approximate_Newton == approximate_Newton && this->screening_max_iter == primary_model_fit_max_iter && this->screening_epsilon == primary_model_fit_epsilon;
+        if (!valid)
+        {
+            this->screening_model_type = model_type;
+            this->screening_size = screening_size;
+            this->screening_always_select = always_select;
+            this->screening_approximate_Newton = approximate_Newton;
+            this->screening_max_iter = primary_model_fit_max_iter;
+            this->screening_epsilon = primary_model_fit_epsilon;
+
+            this->screened_data.y = this->full_data.y;
+            this->screened_data.weight = this->full_data.weight;
+            this->screened_data.status = this->full_data.status;
+            this->screened_data.y_mean = this->full_data.y_mean;
+            this->screened_data.n = this->full_data.n;
+            this->screened_data.M = this->full_data.M;
+            this->screened_data.data_type = this->full_data.data_type;
+            this->screened_data.is_normal = this->full_data.is_normal;
+
+            this->screened_always_select = always_select;
+            Eigen::VectorXi new_screening_A = screening(this->full_data, this->screened_data, model_type, screening_size, this->screened_always_select, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
+
+            // the x caches stay valid as long as the same variables survive
+            if (!this->is_screening || !same(new_screening_A, this->screening_A))
+            {
+                this->train_cache.clear();
+            }
+            this->screening_A = new_screening_A;
+            this->screening_valid = true;
+            this->is_screening = true;
+        }
+        always_select = this->screened_always_select;
+        return this->screening_A;
+    };
+
+    void update_cache(int model_type, bool is_cv, int Kfold)
+    {
+        if (model_type != this->cache_model_type)
+        {
+            this->train_cache.clear();
+            this->cache_model_type = model_type;
+        }
+        if (is_cv && Kfold != this->cache_Kfold)
+        {
+            if (this->train_cache.size() > 1)
+                this->train_cache.resize(1);
+            this->cache_Kfold = Kfold;
+        }
+        unsigned int size = is_cv ? Kfold + 1 : 1;
+        if (this->train_cache.size() < size)
+            this->train_cache.resize(size);
+    };
+
+private:
+    template <class T>
+    static bool same(const T &a, const T &b)
+    {
+        return a.rows() == b.rows() && a.cols() == b.cols() && a == b;
+    };
+};
+
+#endif //SRC_SESSION_H
@@ -25,8 +25,6 @@ using namespace Rcpp;
 #include "screening.h"
 #include <vector>
 
-typedef Eigen::Triplet<double> triplet;
-
 #ifdef _OPENMP
 #include <omp.h>
 // [[Rcpp::plugins(openmp)]]
@@ -54,8 +52,140 @@ inline void omp_set_dynamic(int flag) {}
 using namespace Eigen;
 using namespace std;
 
+template <class T>
+void AbessSession::new_dense_session(T &x, Eigen::MatrixXd &y, int data_type, Eigen::VectorXd &weight, bool is_normal,
+                                     Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool float_x, Eigen::VectorXi &row_order)
+{
+  this->n = x.rows();
+  this->p = x.cols();
+  this->M = y.cols();
+  this->sparse_matrix = false;
+  this->float_x = float_x;
+  Eigen::VectorXd y_vec;
+  if (this->M == 1)
+  {
+    y_vec = y.col(0).eval();
+  }
+
+  if (float_x)
+  {
+    if (this->M == 1)
+      this->session_uni_float = new Session<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXf>(x, y_vec, data_type, weight, is_normal, g_index, status, false, row_order);
+    else
+      this->session_mul_float = new Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXf>(x, y, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+  else if (this->M == 1)
+  {
+    this->session_uni_dense = new Session<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXd>(x, y_vec, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+  else
+  {
+    this->session_mul_dense = new Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd>(x, y, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+}
+
+AbessSession::AbessSession(Eigen::Map<Eigen::MatrixXd> &x, Eigen::Map<Eigen::SparseMatrix<double>> &sparse_x, Eigen::MatrixXd &y,
+                           int data_type, Eigen::VectorXd &weight, bool is_normal,
+                           Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool sparse_matrix, bool float_x, Eigen::VectorXi &row_order)
+{
+  if (!sparse_matrix)
+  {
+    this->new_dense_session(x, y, data_type, weight, is_normal, g_index, status, float_x, row_order);
+    return;
+  }
+
+  this->n = sparse_x.rows();
+  this->p = sparse_x.cols();
+  this->M = y.cols();
+  this->sparse_matrix = true;
+  if (this->M == 1)
+  {
+    Eigen::VectorXd y_vec = y.col(0).eval();
+    this->session_uni_sparse = new Session<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double>>(sparse_x, y_vec, data_type, weight, is_normal, g_index, status, true, row_order);
+  }
+  else
+  {
+    this->session_mul_sparse = new Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double>>(sparse_x, y, data_type, weight, is_normal, g_index, status, true, row_order);
+  }
+}
+
+AbessSession::AbessSession(Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> &x, Eigen::MatrixXd &y,
+                           int data_type, Eigen::VectorXd &weight, bool is_normal,
+                           Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool float_x, Eigen::VectorXi &row_order)
+{
+  this->new_dense_session(x, y, data_type, weight, is_normal, g_index, status, float_x, row_order);
+}
+
+AbessSession::AbessSession(Eigen::Map<Eigen::MatrixXf> &x, Eigen::MatrixXd &y,
+                           int data_type, Eigen::VectorXd &weight, bool is_normal,
+                           Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order)
+{
+  this->new_dense_session(x, y, data_type, weight, is_normal, g_index, status, true, row_order);
+}
+
+AbessSession::AbessSession(Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> &x, Eigen::MatrixXd &y,
+                           int data_type, Eigen::VectorXd &weight, bool is_normal,
+                           Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order)
+{
+  this->new_dense_session(x, y, data_type, weight, is_normal, g_index, status, true, row_order);
+}
+
+AbessSession::AbessSession(GenotypeMatrix &x, Eigen::MatrixXd &y,
+                           int data_type, Eigen::VectorXd &weight, bool is_normal,
+                           Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order)
+{
+  this->n = x.rows();
+  this->p = x.cols();
+  this->M = y.cols();
+  this->sparse_matrix = false;
+  this->genotype_x = true;
+  if (this->M == 1)
+  {
+    Eigen::VectorXd y_vec = y.col(0).eval();
+    this->session_uni_genotype = new Session<Eigen::VectorXd, Eigen::VectorXd, double, GenotypeMatrix>(x, y_vec, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+  else
+  {
+    this->session_mul_genotype = new Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, GenotypeMatrix>(x, y, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+}
+
+AbessSession::AbessSession(MappedDesign &x, Eigen::MatrixXd &y,
+                           int data_type, Eigen::VectorXd &weight, bool is_normal,
+                           Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order)
+{
+  this->n = x.rows();
+  this->p = x.cols();
+  this->M = y.cols();
+  this->sparse_matrix = false;
+  this->mapped_x = true;
+  if (this->M == 1)
+  {
+    Eigen::VectorXd y_vec = y.col(0).eval();
+    this->session_uni_mapped = new Session<Eigen::VectorXd, Eigen::VectorXd, double, MappedDesign>(x, y_vec, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+  else
+  {
+    this->session_mul_mapped = new Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, MappedDesign>(x, y, data_type, weight, is_normal, g_index, status, false, row_order);
+  }
+}
+
+AbessSession::~AbessSession()
+{
+  delete this->session_uni_dense;
+  delete this->session_mul_dense;
+  delete this->session_uni_sparse;
+  delete this->session_mul_sparse;
+  delete this->session_uni_float;
+  delete this->session_mul_float;
+  delete this->session_uni_genotype;
+  delete this->session_mul_genotype;
+  delete this->session_uni_mapped;
+  delete this->session_mul_mapped;
+}
+
 // [[Rcpp::export]]
-List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
+List abessCpp2(Eigen::Map<Eigen::MatrixXd> x, Eigen::Map<Eigen::SparseMatrix<double>> sparse_x, Eigen::MatrixXd y, int n, int p,
                int data_type, Eigen::VectorXd weight, Eigen::MatrixXd sigma,
                bool is_normal,
                int algorithm_type, int model_type, int max_iter, int exchange_num,
@@ -75,9 +205,68 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                int thread,
                bool covariance_update,
                bool sparse_matrix,
-               int splicing_type)
+               int splicing_type,
+               int important_search,
+               double strong_rule,
+               bool active_warm_start,
+               int cox_ties,
+               int primary_solver,
+               bool parallel_exchange,
+               bool float_x,
+               Eigen::VectorXi row_order)
+{
+  AbessSession session(x, sparse_x, y, data_type, weight, is_normal, g_index, status, sparse_matrix, float_x, row_order);
+  return abessSessionFit(session, y, sigma,
+                         algorithm_type, model_type, max_iter, exchange_num,
+                         path_type, is_warm_start,
+                         ic_type, ic_coef, is_cv, Kfold,
+                         status,
+                         sequence,
+                         lambda_seq,
+                         s_min, s_max, K_max, epsilon,
+                         lambda_min, lambda_max, nlambda,
+                         is_screening, screening_size, powell_path,
+                         always_select,
+                         tau,
+                         primary_model_fit_max_iter, primary_model_fit_epsilon,
+                         early_stop, approximate_Newton,
+                         thread,
+                         covariance_update,
+                         splicing_type,
+                         important_search,
+                         strong_rule,
+                         active_warm_start,
+                         cox_ties,
+                         primary_solver,
+                         parallel_exchange);
+}
+
+List abessSessionFit(AbessSession &session, Eigen::MatrixXd y, Eigen::MatrixXd sigma,
+                     int algorithm_type, int model_type, int max_iter, int exchange_num,
+                     int path_type, bool is_warm_start,
+                     int ic_type, double ic_coef, bool is_cv, int Kfold,
+                     Eigen::VectorXi status,
+                     Eigen::VectorXi sequence,
+                     Eigen::VectorXd lambda_seq,
+                     int s_min, int s_max, int K_max, double epsilon,
+                     double lambda_min, double lambda_max, int nlambda,
+                     bool is_screening, int screening_size, int powell_path,
+                     Eigen::VectorXi always_select,
+                     double tau,
+                     int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                     bool early_stop, bool approximate_Newton,
+                     int thread,
+                     bool covariance_update,
+                     int splicing_type,
+                     int important_search,
+                     double strong_rule,
+                     bool active_warm_start,
+                     int cox_ties,
+                     int primary_solver,
+                     bool parallel_exchange)
 {
   bool is_parallel = thread != 1;
+  bool sparse_matrix = session.sparse_matrix;
 
 #ifdef _OPENMP
   // Eigen::initParallel();
@@ -97,10 +286,109 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
   Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd> *algorithm_mul_dense = nullptr;
   Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double>> *algorithm_uni_sparse = nullptr;
   Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double>> *algorithm_mul_sparse = nullptr;
+  Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXf> *algorithm_uni_float = nullptr;
+  Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXf> *algorithm_mul_float = nullptr;
+  Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, GenotypeMatrix> *algorithm_uni_genotype = nullptr;
+  Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, GenotypeMatrix> *algorithm_mul_genotype = nullptr;
+  Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, MappedDesign> *algorithm_uni_mapped = nullptr;
+  Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, MappedDesign> *algorithm_mul_mapped = nullptr;
 
   //////////////////// function generate_algorithm_pointer() ////////////////////////////
   // to do
-  if (!sparse_matrix)
+  if (session.float_x)
+  {
+    // PCA is not available for a float x
+    if (algorithm_type == 6)
+    {
+      if (model_type == 1)
+      {
+        algorithm_uni_float = new abessLm<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+      }
+      else if (model_type == 2)
+      {
+        algorithm_uni_float = new abessLogistic<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 3)
+      {
+        algorithm_uni_float = new abessPoisson<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 4)
+      {
+        algorithm_uni_float = new abessCox<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 5)
+      {
+        algorithm_mul_float = new abessMLm<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+      }
+      else if (model_type == 6)
+      {
+        algorithm_mul_float = new abessMultinomial<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+    }
+  }
+  else if (session.genotype_x)
+  {
+    // PCA is not available for genotypes
+    if (algorithm_type == 6)
+    {
+      if (model_type == 1)
+      {
+        algorithm_uni_genotype = new abessLm<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+      }
+      else if (model_type == 2)
+      {
+        algorithm_uni_genotype = new abessLogistic<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 3)
+      {
+        algorithm_uni_genotype = new abessPoisson<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 4)
+      {
+        algorithm_uni_genotype = new abessCox<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 5)
+      {
+        algorithm_mul_genotype = new abessMLm<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+      }
+      else if (model_type == 6)
+      {
+        algorithm_mul_genotype = new abessMultinomial<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+    }
+  }
+  else if (session.mapped_x)
+  {
+    // PCA is not available for a design on disk
+    if (algorithm_type == 6)
+    {
+      if (model_type == 1)
+      {
+        algorithm_uni_mapped = new abessLm<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+      }
+      else if (model_type == 2)
+      {
+        algorithm_uni_mapped = new abessLogistic<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 3)
+      {
+        algorithm_uni_mapped = new abessPoisson<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 4)
+      {
+        algorithm_uni_mapped = new abessCox<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+      else if (model_type == 5)
+      {
+        algorithm_mul_mapped = new abessMLm<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+      }
+      else if (model_type == 6)
+      {
+        algorithm_mul_mapped = new abessMultinomial<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+      }
+    }
+  }
+  else if (!sparse_matrix)
   {
     if (algorithm_type == 6)
     {
@@ -177,11 +465,107 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
   vector<Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd> *> algorithm_list_mul_dense(max(Kfold, thread));
   vector<Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double>> *> algorithm_list_uni_sparse(max(Kfold, thread));
   vector<Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double>> *> algorithm_list_mul_sparse(max(Kfold, thread));
+  vector<Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXf> *> algorithm_list_uni_float(max(Kfold, thread));
+  vector<Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXf> *> algorithm_list_mul_float(max(Kfold, thread));
+  vector<Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, GenotypeMatrix> *> algorithm_list_uni_genotype(max(Kfold, thread));
+  vector<Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, GenotypeMatrix> *> algorithm_list_mul_genotype(max(Kfold, thread));
+  vector<Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, MappedDesign> *> algorithm_list_uni_mapped(max(Kfold, thread));
+  vector<Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, MappedDesign> *> algorithm_list_mul_mapped(max(Kfold, thread));
   if (is_cv)
   {
     for (int i = 0; i < max(Kfold, thread); i++)
     {
-      if (!sparse_matrix)
+      if (session.float_x)
+      {
+        if (algorithm_type == 6)
+        {
+          if (model_type == 1)
+          {
+            algorithm_list_uni_float[i] = new abessLm<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+          }
+          else if (model_type == 2)
+          {
+            algorithm_list_uni_float[i] = new abessLogistic<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 3)
+          {
+            algorithm_list_uni_float[i] = new abessPoisson<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 4)
+          {
+            algorithm_list_uni_float[i] = new abessCox<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 5)
+          {
+            algorithm_list_mul_float[i] = new abessMLm<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+          }
+          else if (model_type == 6)
+          {
+            algorithm_list_mul_float[i] = new abessMultinomial<Eigen::MatrixXf>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+        }
+      }
+      else if (session.genotype_x)
+      {
+        if (algorithm_type == 6)
+        {
+          if (model_type == 1)
+          {
+            algorithm_list_uni_genotype[i] = new abessLm<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+          }
+          else if (model_type == 2)
+          {
+            algorithm_list_uni_genotype[i] = new abessLogistic<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 3)
+          {
+            algorithm_list_uni_genotype[i] = new abessPoisson<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 4)
+          {
+            algorithm_list_uni_genotype[i] = new abessCox<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 5)
+          {
+            algorithm_list_mul_genotype[i] = new abessMLm<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+          }
+          else if (model_type == 6)
+          {
+            algorithm_list_mul_genotype[i] = new abessMultinomial<GenotypeMatrix>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+        }
+      }
+      else if (session.mapped_x)
+      {
+        if (algorithm_type == 6)
+        {
+          if (model_type == 1)
+          {
+            algorithm_list_uni_mapped[i] = new abessLm<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+          }
+          else if (model_type == 2)
+          {
+            algorithm_list_uni_mapped[i] = new abessLogistic<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 3)
+          {
+            algorithm_list_uni_mapped[i] = new abessPoisson<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 4)
+          {
+            algorithm_list_uni_mapped[i] = new abessCox<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+          else if (model_type == 5)
+          {
+            algorithm_list_mul_mapped[i] = new abessMLm<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type);
+          }
+          else if (model_type == 6)
+          {
+            algorithm_list_mul_mapped[i] = new abessMultinomial<MappedDesign>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, is_warm_start, exchange_num, approximate_Newton, always_select, splicing_type);
+          }
+        }
+      }
+      else if (!sparse_matrix)
       {
         if (algorithm_type == 6)
         {
@@ -256,9 +640,186 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
 #endif
 
   List out_result;
-  if (!sparse_matrix)
+  if (session.float_x)
   {
-    if (y.cols() == 1)
+    if (session.M == 1)
+    {
+      Eigen::VectorXd y_vec = y.col(0).eval();
+
+      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXf>(*session.session_uni_float, y_vec, sigma,
+                                                                                       algorithm_type, model_type, max_iter, exchange_num,
+                                                                                       path_type, is_warm_start,
+                                                                                       ic_type, ic_coef, is_cv, Kfold,
+                                                                                       status,
+                                                                                       sequence,
+                                                                                       lambda_seq,
+                                                                                       s_min, s_max, K_max, epsilon,
+                                                                                       lambda_min, lambda_max, nlambda,
+                                                                                       is_screening, screening_size, powell_path,
+                                                                                       always_select,
+                                                                                       tau,
+                                                                                       primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                                                                       early_stop, approximate_Newton,
+                                                                                       thread,
+                                                                                       covariance_update,
+                                                                                       sparse_matrix,
+                                                                                       important_search,
+                                                                                       strong_rule,
+                                                                                       active_warm_start,
+                                                                                       cox_ties,
+                                                                                       primary_solver,
+                                                                                       parallel_exchange,
+                                                                                       algorithm_uni_float, algorithm_list_uni_float);
+    }
+    else
+    {
+      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXf>(*session.session_mul_float, y, sigma,
+                                                                                                algorithm_type, model_type, max_iter, exchange_num,
+                                                                                                path_type, is_warm_start,
+                                                                                                ic_type, ic_coef, is_cv, Kfold,
+                                                                                                status,
+                                                                                                sequence,
+                                                                                                lambda_seq,
+                                                                                                s_min, s_max, K_max, epsilon,
+                                                                                                lambda_min, lambda_max, nlambda,
+                                                                                                is_screening, screening_size, powell_path,
+                                                                                                always_select,
+                                                                                                tau,
+                                                                                                primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                                                                                early_stop, approximate_Newton,
+                                                                                                thread,
+                                                                                                covariance_update,
+                                                                                                sparse_matrix,
+                                                                                                important_search,
+                                                                                                strong_rule,
+                                                                                                active_warm_start,
+                                                                                                cox_ties,
+                                                                                                primary_solver,
+                                                                                                parallel_exchange,
+                                                                                                algorithm_mul_float, algorithm_list_mul_float);
+    }
+  }
+  else if (session.genotype_x)
+  {
+    if (session.M == 1)
+    {
+      Eigen::VectorXd y_vec = y.col(0).eval();
+
+      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, GenotypeMatrix>(*session.session_uni_genotype, y_vec, sigma,
+                                                                                      algorithm_type, model_type, max_iter, exchange_num,
+                                                                                      path_type, is_warm_start,
+                                                                                      ic_type, ic_coef, is_cv, Kfold,
+                                                                                      status,
+                                                                                      sequence,
+                                                                                      lambda_seq,
+                                                                                      s_min, s_max, K_max, epsilon,
+                                                                                      lambda_min, lambda_max, nlambda,
+                                                                                      is_screening, screening_size, powell_path,
+                                                                                      always_select,
+                                                                                      tau,
+                                                                                      primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                                                                      early_stop, approximate_Newton,
+                                                                                      thread,
+                                                                                      covariance_update,
+                                                                                      sparse_matrix,
+                                                                                      important_search,
+                                                                                      strong_rule,
+                                                                                      active_warm_start,
+                                                                                      cox_ties,
+                                                                                      primary_solver,
+                                                                                      parallel_exchange,
+                                                                                      algorithm_uni_genotype, algorithm_list_uni_genotype);
+    }
+    else
+    {
+      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, GenotypeMatrix>(*session.session_mul_genotype, y, sigma,
+                                                                                               algorithm_type, model_type, max_iter, exchange_num,
+                                                                                               path_type, is_warm_start,
+                                                                                               ic_type, ic_coef, is_cv, Kfold,
+                                                                                               status,
+                                                                                               sequence,
+                                                                                               lambda_seq,
+                                                                                               s_min, s_max, K_max, epsilon,
+                                                                                               lambda_min, lambda_max, nlambda,
+                                                                                               is_screening, screening_size, powell_path,
+                                                                                               always_select,
+                                                                                               tau,
+                                                                                               primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                                                                               early_stop, approximate_Newton,
+                                                                                               thread,
+                                                                                               covariance_update,
+                                                                                               sparse_matrix,
+                                                                                               important_search,
+                                                                                               strong_rule,
+                                                                                               active_warm_start,
+                                                                                               cox_ties,
+                                                                                               primary_solver,
+                                                                                               parallel_exchange,
+                                                                                               algorithm_mul_genotype, algorithm_list_mul_genotype);
+    }
+  }
+  else if (session.mapped_x)
+  {
+    if (session.M == 1)
+    {
+      Eigen::VectorXd y_vec = y.col(0).eval();
+
+      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, MappedDesign>(*session.session_uni_mapped, y_vec, sigma,
+                                                                                      algorithm_type, model_type, max_iter, exchange_num,
+                                                                                      path_type, is_warm_start,
+                                                                                      ic_type, ic_coef, is_cv, Kfold,
+                                                                                      status,
+                                                                                      sequence,
+                                                                                      lambda_seq,
+                                                                                      s_min, s_max, K_max, epsilon,
+                                                                                      lambda_min, lambda_max, nlambda,
+                                                                                      is_screening, screening_size, powell_path,
+                                                                                      always_select,
+                                                                                      tau,
+                                                                                      primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                                                                      early_stop, approximate_Newton,
+                                                                                      thread,
+                                                                                      covariance_update,
+                                                                                      sparse_matrix,
+                                                                                      important_search,
+                                                                                      strong_rule,
+                                                                                      active_warm_start,
+                                                                                      cox_ties,
+                                                                                      primary_solver,
+                                                                                      parallel_exchange,
+                                                                                      algorithm_uni_mapped, algorithm_list_uni_mapped);
+    }
+    else
+    {
+      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, MappedDesign>(*session.session_mul_mapped, y, sigma,
+                                                                                               algorithm_type, model_type, max_iter, exchange_num,
+                                                                                               path_type, is_warm_start,
+                                                                                               ic_type, ic_coef, is_cv, Kfold,
+                                                                                               status,
+                                                                                               sequence,
+                                                                                               lambda_seq,
+                                                                                               s_min, s_max, K_max, epsilon,
+                                                                                               lambda_min, lambda_max, nlambda,
+                                                                                               is_screening, screening_size, powell_path,
+                                                                                               always_select,
+                                                                                               tau,
+                                                                                               primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                                                                               early_stop, approximate_Newton,
+                                                                                               thread,
+                                                                                               covariance_update,
+                                                                                               sparse_matrix,
+                                                                                               important_search,
+                                                                                               strong_rule,
+                                                                                               active_warm_start,
+                                                                                               cox_ties,
+                                                                                               primary_solver,
+                                                                                               parallel_exchange,
+                                                                                               algorithm_mul_mapped, algorithm_list_mul_mapped);
+    }
+  }
+  else if (!sparse_matrix)
+  {
+    if (session.M == 1)
     {
 #ifdef TEST
       cout << "abesscpp2 4" << endl;
@@ -266,9 +827,7 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
 #endif
       Eigen::VectorXd y_vec = y.col(0).eval();
 
-      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXd>(x, y_vec, n, p,
-                                                                                       data_type, weight, sigma,
-                                                                                       is_normal,
+      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXd>(*session.session_uni_dense, y_vec, sigma,
                                                                                        algorithm_type, model_type, max_iter, exchange_num,
                                                                                        path_type, is_warm_start,
                                                                                        ic_type, ic_coef, is_cv, Kfold,
@@ -278,7 +837,6 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                        s_min, s_max, K_max, epsilon,
                                                                                        lambda_min, lambda_max, nlambda,
                                                                                        is_screening, screening_size, powell_path,
-                                                                                       g_index,
                                                                                        always_select,
                                                                                        tau,
                                                                                        primary_model_fit_max_iter, primary_model_fit_epsilon,
@@ -286,6 +844,12 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                        thread,
                                                                                        covariance_update,
                                                                                        sparse_matrix,
+                                                                                       important_search,
+                                                                                       strong_rule,
+                                                                                       active_warm_start,
+                                                                                       cox_ties,
+                                                                                       primary_solver,
+                                                                                       parallel_exchange,
                                                                                        algorithm_uni_dense, algorithm_list_uni_dense);
 #ifdef TEST
       cout << "abesscpp2 5" << endl;
@@ -297,9 +861,7 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
       cout << "abesscpp2 5" << endl;
       cout << "mul_dense" << endl;
 #endif
-      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd>(x, y, n, p,
-                                                                                                data_type, weight, sigma,
-                                                                                                is_normal,
+      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd>(*session.session_mul_dense, y, sigma,
                                                                                                 algorithm_type, model_type, max_iter, exchange_num,
                                                                                                 path_type, is_warm_start,
                                                                                                 ic_type, ic_coef, is_cv, Kfold,
@@ -309,7 +871,6 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                                 s_min, s_max, K_max, epsilon,
                                                                                                 lambda_min, lambda_max, nlambda,
                                                                                                 is_screening, screening_size, powell_path,
-                                                                                                g_index,
                                                                                                 always_select,
                                                                                                 tau,
                                                                                                 primary_model_fit_max_iter, primary_model_fit_epsilon,
@@ -317,6 +878,12 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                                 thread,
                                                                                                 covariance_update,
                                                                                                 sparse_matrix,
+                                                                                                important_search,
+                                                                                                strong_rule,
+                                                                                                active_warm_start,
+                                                                                                cox_ties,
+                                                                                                primary_solver,
+                                                                                                parallel_exchange,
                                                                                                 algorithm_mul_dense, algorithm_list_mul_dense);
 #ifdef TEST
       cout << "abesscpp2 6" << endl;
@@ -325,33 +892,7 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
   }
   else
   {
-#ifdef TEST
-    clock_t t1 = clock();
-#endif
-    Eigen::SparseMatrix<double> sparse_x(n, p);
-
-    // std::vector<triplet> tripletList;
-    // tripletList.reserve(x.rows());
-    // for (int i = 0; i < x.rows(); i++)
-    // {
-    //   tripletList.push_back(triplet(int(x(i, 1)), int(x(i, 2)), x(i, 0)));
-    // }
-    // sparse_x.setFromTriplets(tripletList.begin(), tripletList.end());
-
-    sparse_x.reserve(x.rows());
-    for (int i = 0; i < x.rows(); i++)
-    {
-      sparse_x.insert(int(x(i, 1)), int(x(i, 2))) = x(i, 0);
-    }
-    sparse_x.makeCompressed();
-
-#ifdef TEST
-    cout << "sparse x nonZeros: " << sparse_x.nonZeros() << endl;
-    clock_t t2 = clock();
-    std::cout << "sparse X time: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
-#endif
-
-    if (y.cols() == 1)
+    if (session.M == 1)
     {
 #ifdef TEST
       cout << "abesscpp2 3" << endl;
@@ -359,9 +900,7 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
 #endif
       Eigen::VectorXd y_vec = y.col(0).eval();
 
-      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double>>(sparse_x, y_vec, n, p,
-                                                                                                   data_type, weight, sigma,
-                                                                                                   is_normal,
+      out_result = abessCpp<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double>>(*session.session_uni_sparse, y_vec, sigma,
                                                                                                    algorithm_type, model_type, max_iter, exchange_num,
                                                                                                    path_type, is_warm_start,
                                                                                                    ic_type, ic_coef, is_cv, Kfold,
@@ -371,7 +910,6 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                                    s_min, s_max, K_max, epsilon,
                                                                                                    lambda_min, lambda_max, nlambda,
                                                                                                    is_screening, screening_size, powell_path,
-                                                                                                   g_index,
                                                                                                    always_select,
                                                                                                    tau,
                                                                                                    primary_model_fit_max_iter, primary_model_fit_epsilon,
@@ -379,6 +917,12 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                                    thread,
                                                                                                    covariance_update,
                                                                                                    sparse_matrix,
+                                                                                                   important_search,
+                                                                                                   strong_rule,
+                                                                                                   active_warm_start,
+                                                                                                   cox_ties,
+                                                                                                   primary_solver,
+                                                                                                   parallel_exchange,
                                                                                                    algorithm_uni_sparse, algorithm_list_uni_sparse);
 #ifdef TEST
       cout << "abesscpp2 5" << endl;
@@ -391,9 +935,7 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
       cout << "mul_sparse" << endl;
 #endif
 
-      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double>>(sparse_x, y, n, p,
-                                                                                                            data_type, weight, sigma,
-                                                                                                            is_normal,
+      out_result = abessCpp<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double>>(*session.session_mul_sparse, y, sigma,
                                                                                                             algorithm_type, model_type, max_iter, exchange_num,
                                                                                                             path_type, is_warm_start,
                                                                                                             ic_type, ic_coef, is_cv, Kfold,
@@ -403,7 +945,6 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                                             s_min, s_max, K_max, epsilon,
                                                                                                             lambda_min, lambda_max, nlambda,
                                                                                                             is_screening, screening_size, powell_path,
-                                                                                                            g_index,
                                                                                                             always_select,
                                                                                                             tau,
                                                                                                             primary_model_fit_max_iter, primary_model_fit_epsilon,
@@ -411,6 +952,12 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                                                                                                             thread,
                                                                                                             covariance_update,
                                                                                                             sparse_matrix,
+                                                                                                            important_search,
+                                                                                                            strong_rule,
+                                                                                                            active_warm_start,
+                                                                                                            cox_ties,
+                                                                                                            primary_solver,
+                                                                                                            parallel_exchange,
                                                                                                             algorithm_mul_sparse, algorithm_list_mul_sparse);
 #ifdef TEST
       cout << "abesscpp2 6" << endl;
@@ -422,6 +969,12 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
   delete algorithm_mul_dense;
   delete algorithm_uni_sparse;
   delete algorithm_mul_sparse;
+  delete algorithm_uni_float;
+  delete algorithm_mul_float;
+  delete algorithm_uni_genotype;
+  delete algorithm_mul_genotype;
+  delete algorithm_uni_mapped;
+  delete algorithm_mul_mapped;
   for (unsigned int i = 0; i < algorithm_list_uni_dense.size(); i++)
   {
     delete algorithm_list_uni_dense[i];
@@ -438,9 +991,103 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
   {
     delete algorithm_list_mul_sparse[i];
   }
+  for (unsigned int i = 0; i < algorithm_list_uni_float.size(); i++)
+  {
+    delete algorithm_list_uni_float[i];
+  }
+  for (unsigned int i = 0; i < algorithm_list_mul_float.size(); i++)
+  {
+    delete algorithm_list_mul_float[i];
+  }
+  for (unsigned int i = 0; i < algorithm_list_uni_genotype.size(); i++)
+  {
+    delete algorithm_list_uni_genotype[i];
+  }
+  for (unsigned int i = 0; i < algorithm_list_mul_genotype.size(); i++)
+  {
+    delete algorithm_list_mul_genotype[i];
+  }
+  for (unsigned int i = 0; i < algorithm_list_uni_mapped.size(); i++)
+  {
+    delete algorithm_list_uni_mapped[i];
+  }
+  for (unsigned int i = 0; i < algorithm_list_mul_mapped.size(); i++)
+  {
+    delete algorithm_list_mul_mapped[i];
+  }
   return out_result;
 };
 
+#ifdef R_BUILD
+// [[Rcpp::export]]
+SEXP abessSessionNew(Eigen::Map<Eigen::MatrixXd> x, Eigen::Map<Eigen::SparseMatrix<double>> sparse_x, Eigen::MatrixXd y,
+                     int data_type, Eigen::VectorXd weight, bool is_normal,
+                     Eigen::VectorXi g_index, Eigen::VectorXi status, bool sparse_matrix, bool float_x, Eigen::VectorXi row_order)
+{
+  Rcpp::XPtr<AbessSession> session(new AbessSession(x, sparse_x, y, data_type, weight, is_normal, g_index, status, sparse_matrix, float_x, row_order), true);
+  return session;
+}
+
+// [[Rcpp::export]]
+List abessSessionCpp(SEXP session, Eigen::MatrixXd y, Eigen::MatrixXd sigma,
+                     int algorithm_type, int model_type, int max_iter, int exchange_num,
+                     int path_type, bool is_warm_start,
+                     int ic_type, double ic_coef, bool is_cv, int Kfold,
+                     Eigen::VectorXi status,
+                     Eigen::VectorXi sequence,
+                     Eigen::VectorXd lambda_seq,
+                     int s_min, int s_max, int K_max, double epsilon,
+                     double lambda_min, double lambda_max, int nlambda,
+                     bool is_screening, int screening_size, int powell_path,
+                     Eigen::VectorXi always_select,
+                     double tau,
+                     int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                     bool early_stop, bool approximate_Newton,
+                     int thread,
+                     bool covariance_update,
+                     int splicing_type,
+                     int important_search,
+                     double strong_rule,
+                     bool active_warm_start,
+                     int cox_ties,
+                     int primary_solver,
+                     bool parallel_exchange)
+{
+  Rcpp::XPtr<AbessSession> ptr(session);
+  return abessSessionFit(*ptr, y, sigma,
+                         algorithm_type, model_type, max_iter, exchange_num,
+                         path_type, is_warm_start,
+                         ic_type, ic_coef, is_cv, Kfold,
+                         status,
+                         sequence,
+                         lambda_seq,
+                         s_min, s_max, K_max, epsilon,
+                         lambda_min, lambda_max, nlambda,
+                         is_screening, screening_size, powell_path,
+                         always_select,
+                         tau,
+                         primary_model_fit_max_iter, primary_model_fit_epsilon,
+                         early_stop, approximate_Newton,
+                         thread,
+                         covariance_update,
+                         splicing_type,
+                         important_search,
+                         strong_rule,
+                         active_warm_start,
+                         cox_ties,
+                         primary_solver,
+                         parallel_exchange);
+}
+
+// [[Rcpp::export]]
+List coxRiskSets(Eigen::VectorXd time, Eigen::VectorXi strata)
+{
+  Eigen::VectorXi order, key;
+  cox_risk_sets(time, strata, order, key);
+  return List::create(Named("order") = order, Named("key") = key);
+}
+#endif
+
 //  T1 for y, XTy, XTone
 //  T2 for beta
 //  T3 for coef0
@@ -450,9 +1097,7 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
 //  <Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd> for Multivariable Dense
 //  <Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double> > for Multivariable Sparse
 template <class T1, class T2, class T3, class T4>
-List abessCpp(T4 &x, T1 &y, int n, int p,
-              int data_type, Eigen::VectorXd weight, Eigen::MatrixXd sigma,
-              bool is_normal,
+List abessCpp(Session<T1, T2, T3, T4> &session, T1 &y, Eigen::MatrixXd sigma,
               int algorithm_type, int model_type, int max_iter, int exchange_num,
               int path_type, bool is_warm_start,
               int ic_type, double ic_coef, bool is_cv, int Kfold,
@@ -462,7 +1107,6 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
               int s_min, int s_max, int K_max, double epsilon,
               double lambda_min, double lambda_max, int nlambda,
               bool is_screening, int screening_size, int powell_path,
-              Eigen::VectorXi g_index,
               Eigen::VectorXi always_select,
               double tau,
               int primary_model_fit_max_iter, double primary_model_fit_epsilon,
@@ -470,6 +1114,12 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
               int thread,
               bool covariance_update,
               bool sparse_matrix,
+              int important_search,
+              double strong_rule,
+              bool active_warm_start,
+              int cox_ties,
+              int primary_solver,
+              bool parallel_exchange,
               Algorithm<T1, T2, T3, T4> *algorithm, vector<Algorithm<T1, T2, T3, T4> *> algorithm_list)
 {
   // to do: -openmp
@@ -484,12 +1134,31 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
 
   bool is_parallel = thread != 1;
 
-  Data<T1, T2, T3, T4> data(x, y, data_type, weight, is_normal, g_index, status, sparse_matrix);
-
-  Eigen::VectorXi screening_A;
-  if (is_screening)
+  // only the parts of the session that depend on what changed are rebuilt
+  session.update_y(y, status);
+  Eigen::VectorXi screening_A = session.screen(is_screening, model_type, screening_size, always_select, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
+  Data<T1, T2, T3, T4> &data = session.data();
+  session.update_cache(model_type, is_cv, Kfold);
+
+  algorithm->x_center = data.x_center;
+  // with parallel_exchange and without cv, the threads fit the exchanges of each splicing step instead
+  algorithm->splicing_threads = parallel_exchange && !is_cv ? max(thread, 1) : 1;
+  algorithm->important_search = important_search;
+  algorithm->strong_rule = strong_rule;
+  algorithm->active_warm_start = active_warm_start;
+  algorithm->cox_ties = cox_ties;
+  algorithm->primary_solver = primary_solver;
+  if (is_cv)
   {
-    screening_A = screening(data, model_type, screening_size, always_select, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
+    for (unsigned int i = 0; i < algorithm_list.size(); i++)
+    {
+      algorithm_list[i]->x_center = data.x_center;
+      algorithm_list[i]->important_search = important_search;
+      algorithm_list[i]->strong_rule = strong_rule;
+      algorithm_list[i]->active_warm_start = active_warm_start;
+      algorithm_list[i]->cox_ties = cox_ties;
+      algorithm_list[i]->primary_solver = primary_solver;
+    }
   }
 
   int M = data.y.cols();
@@ -528,20 +1197,20 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
 #pragma omp parallel for
         for (int i = 0; i < Kfold; i++)
         {
-          sequential_path_cv<T1, T2, T3, T4>(data, sigma, algorithm_list[i], metric, sequence, lambda_seq, early_stop, i, result_list[i]);
+          sequential_path_cv<T1, T2, T3, T4>(data, sigma, algorithm_list[i], metric, sequence, lambda_seq, early_stop, i, result_list[i], session.train_cache);
         }
       }
       else
       {
         for (int i = 0; i < Kfold; i++)
         {
-          sequential_path_cv<T1, T2, T3, T4>(data, sigma, algorithm, metric, sequence, lambda_seq, early_stop, i, result_list[i]);
+          sequential_path_cv<T1, T2, T3, T4>(data, sigma, algorithm, metric, sequence, lambda_seq, early_stop, i, result_list[i], session.train_cache);
         }
       }
     }
     else
     {
-      sequential_path_cv<T1, T2, T3, T4>(data, sigma, algorithm, metric, sequence, lambda_seq, early_stop, -1, result);
+      sequential_path_cv<T1, T2, T3, T4>(data, sigma, algorithm, metric, sequence, lambda_seq, early_stop, -1, result, session.train_cache);
     }
   }
   else
@@ -553,7 +1222,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
 
     //     result = pgs_path(data, algorithm, metric, s_min, s_max, log_lambda_min, log_lambda_max, powell_path, nlambda);
     // }
-    gs_path(data, algorithm, algorithm_list, metric, s_min, s_max, sequence, lambda_seq, K_max, epsilon, is_parallel, result);
+    gs_path(data, algorithm, algorithm_list, metric, s_min, s_max, sequence, lambda_seq, K_max, epsilon, is_parallel, result, session.train_cache);
   }
 
 #ifdef TEST
@@ -569,44 +1238,40 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
   Eigen::MatrixXd ic_matrix(s_size, lambda_size);
   Eigen::MatrixXd test_loss_sum = Eigen::MatrixXd::Zero(s_size, lambda_size);
   Eigen::MatrixXd train_loss_matrix(s_size, lambda_size);
+  // the groups left out of the path fits, their splicing iterations and their primary fits, summed over the folds
+  Eigen::MatrixXi pruned_matrix = result.pruned_matrix;
+  Eigen::MatrixXi iter_matrix = result.iter_matrix;
+  Eigen::MatrixXi primary_iter_matrix = result.primary_iter_matrix;
+  Eigen::MatrixXd primary_time_matrix = result.primary_time_matrix;
 
   if (path_type == 1)
   {
     if (is_cv)
     {
       Eigen::MatrixXd test_loss_tmp;
+      pruned_matrix = Eigen::MatrixXi::Zero(s_size, lambda_size);
+      iter_matrix = Eigen::MatrixXi::Zero(s_size, lambda_size);
+      primary_iter_matrix = Eigen::MatrixXi::Zero(s_size, lambda_size);
+      primary_time_matrix = Eigen::MatrixXd::Zero(s_size, lambda_size);
       for (int i = 0; i < Kfold; i++)
       {
         test_loss_tmp = result_list[i].test_loss_matrix;
         test_loss_sum = test_loss_sum + test_loss_tmp / Kfold;
+        pruned_matrix = pruned_matrix + result_list[i].pruned_matrix;
+        iter_matrix = iter_matrix + result_list[i].iter_matrix;
+        primary_iter_matrix = primary_iter_matrix + result_list[i].primary_iter_matrix;
+        primary_time_matrix = primary_time_matrix + result_list[i].primary_time_matrix;
       }
       test_loss_sum.minCoeff(&min_loss_index_row, &min_loss_index_col);
 
-      Eigen::Matrix<T4, -1, -1> full_group_XTX = group_XTX(data.x, data.g_index, data.g_size, data.n, data.p, data.g_num, model_type);
-
-      Eigen::MatrixXd covariance;
-      T1 XTy;
-      T1 XTone;
-      if (covariance_update)
-      {
-        XTy = data.x.transpose() * data.y;
-        XTone = data.x.transpose() * Eigen::MatrixXd::Ones(data.n, data.M);
-      }
+      TrainCache<T1, T4> &full_cache = session.train_cache[0];
 
       if (is_parallel)
       {
         // cout << "cv parallel" << endl;
         for (int i = 0; i < max(Kfold, thread); i++)
         {
-          if (covariance_update)
-          {
-            algorithm_list[i]->covariance_update_flag = Eigen::VectorXi::Zero(data.p);
-            algorithm_list[i]->XTy = XTy;
-            algorithm_list[i]->XTone = XTone;
-          }
-
-          algorithm_list[i]->update_group_XTX(full_group_XTX);
-          algorithm_list[i]->PhiG = Eigen::Matrix<Eigen::MatrixXd, -1, -1>(0, 0);
+          full_cache.load(algorithm_list[i], data.x, data.y, data.g_index, data.g_size, data.n, data.p, data.g_num, data.M);
         }
 #pragma omp parallel for
         for (int i = 0; i < sequence.size() * lambda_seq.size(); i++)
@@ -619,6 +1284,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
           T3 coef0_init;
           coef_set_zero(data.p, M, beta_init, coef0_init);
           Eigen::VectorXd bd_init = Eigen::VectorXd::Zero(data.p);
+          Eigen::VectorXi A_init;
 
           for (int j = 0; j < Kfold; j++)
           {
@@ -632,6 +1298,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
           algorithm_list[algorithm_index]->update_beta_init(beta_init);
           algorithm_list[algorithm_index]->update_coef0_init(coef0_init);
           algorithm_list[algorithm_index]->update_bd_init(bd_init);
+          algorithm_list[algorithm_index]->update_A_init(A_init, data.g_num);
 
           algorithm_list[algorithm_index]->fit(data.x, data.y, data.weight, data.g_index, data.g_size, data.n, data.p, data.g_num, data.status, sigma);
 
@@ -640,22 +1307,14 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
           train_loss_matrix(s_index, lambda_index) = algorithm_list[algorithm_index]->get_train_loss();
           ic_matrix(s_index, lambda_index) = metric->ic(data.n, data.M, data.g_num, algorithm_list[algorithm_index]);
         }
+        full_cache.save(algorithm_list[0]);
 #ifdef TEST
         std::cout << "parallel cv 2 end--------" << std::endl;
 #endif
       }
       else
       {
-        if (covariance_update)
-        {
-          algorithm->covariance_update_flag = Eigen::VectorXi::Zero(data.p);
-          algorithm->XTy = XTy;
-          algorithm->XTone = XTone;
-        }
-
-        algorithm->update_group_XTX(full_group_XTX);
-
-        algorithm->PhiG = Eigen::Matrix<Eigen::MatrixXd, -1, -1>(0, 0);
+        full_cache.load(algorithm, data.x, data.y, data.g_index, data.g_size, data.n, data.p, data.g_num, data.M);
         for (int i = 0; i < sequence.size() * lambda_seq.size(); i++)
         {
           int s_index = i / lambda_seq.size();
@@ -665,6 +1324,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
           T3 coef0_init;
           coef_set_zero(data.p, M, beta_init, coef0_init);
           Eigen::VectorXd bd_init = Eigen::VectorXd::Zero(data.p);
+          Eigen::VectorXi A_init;
 
           for (int j = 0; j < Kfold; j++)
           {
@@ -678,6 +1338,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
           algorithm->update_beta_init(beta_init);
           algorithm->update_coef0_init(coef0_init);
           algorithm->update_bd_init(bd_init);
+          algorithm->update_A_init(A_init, data.g_num);
 
           algorithm->fit(data.x, data.y, data.weight, data.g_index, data.g_size, data.n, data.p, data.g_num, data.status, sigma);
 
@@ -686,6 +1347,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
           train_loss_matrix(s_index, lambda_index) = algorithm->get_train_loss();
           ic_matrix(s_index, lambda_index) = metric->ic(data.n, data.M, data.g_num, algorithm);
         }
+        full_cache.save(algorithm);
       }
 #ifdef TEST
       cout << "test_loss: " << test_loss_sum << endl;
@@ -715,6 +1377,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
     Eigen::MatrixXd test_loss_matrix = result.test_loss_matrix;
     if (is_cv)
     {
+      test_loss_sum = test_loss_matrix;
       test_loss_matrix.minCoeff(&min_loss_index_row, &min_loss_index_col);
     }
     else
@@ -750,8 +1413,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
   best_test_loss = test_loss_sum(min_loss_index_row, min_loss_index_col);
 
   //////////////Restore best_fit_result for normal//////////////
-  // to do
-  if (data.is_normal && !sparse_matrix)
+  if (data.is_normal)
   {
     if (data.data_type == 1)
     {
@@ -773,8 +1435,7 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
   }
 
   ////////////// Restore all_fit_result for normal ////////////////////////
-  // to do
-  if (data.is_normal && !sparse_matrix)
+  if (data.is_normal)
   {
     if (data.data_type == 1)
     {
@@ -826,7 +1487,11 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
                             Named("coef0_all") = coef0_matrix,
                             Named("train_loss_all") = train_loss_matrix,
                             Named("ic_all") = ic_matrix,
-                            Named("test_loss_all") = test_loss_sum);
+                            Named("test_loss_all") = test_loss_sum,
+                            Named("pruned_all") = pruned_matrix,
+                            Named("iter_all") = iter_matrix,
+                            Named("primary_iter_all") = primary_iter_matrix,
+                            Named("primary_time_all") = primary_time_matrix);
   if (path_type == 2) {
     out_result.push_back(sequence, "sequence");
   }
@@ -837,11 +1502,16 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
   out_result.add("test_loss", best_test_loss);
   out_result.add("ic", best_ic);
   out_result.add("lambda", best_lambda);
-  // out_result.add("beta_all", beta_matrix);
-  // out_result.add("coef0_all", coef0_matrix);
-  // out_result.add("train_loss_all", train_loss_matrix);
-  // out_result.add("ic_all", ic_matrix);
-  // out_result.add("test_loss_all", test_loss_sum);
+  out_result.add("beta_all", beta_matrix);
+  out_result.add("coef0_all", coef0_matrix);
+  out_result.add("train_loss_all", train_loss_matrix);
+  out_result.add("ic_all", ic_matrix);
+  out_result.add("test_loss_all", test_loss_sum);
+  out_result.add("sequence", sequence);
+  out_result.add("pruned_all", pruned_matrix);
+  out_result.add("iter_all", iter_matrix);
+  out_result.add("primary_iter_all", primary_iter_matrix);
+  out_result.add("primary_time_all", primary_time_matrix);
 #endif
 
   // Restore best_fit_result for screening
@@ -849,18 +1519,29 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
   {
 #ifdef TEST
     cout << "screening_A: " << screening_A << endl;
-    cout << "p: " << x.cols() << endl;
+    cout << "p: " << session.full_data.p << endl;
 #endif
     T2 beta_screening_A;
     T2 beta;
     T3 coef0;
-    coef_set_zero(x.cols(), M, beta, coef0);
+    coef_set_zero(session.full_data.p, M, beta, coef0);
 
 #ifndef R_BUILD
     out_result.get_value_by_name("beta", beta_screening_A);
     slice_restore(beta_screening_A, screening_A, beta);
     out_result.add("beta", beta);
     out_result.add("screening_A", screening_A);
+
+    for (int i = 0; i < beta_matrix.rows(); i++)
+    {
+      for (int j = 0; j < beta_matrix.cols(); j++)
+      {
+        coef_set_zero(session.full_data.p, M, beta, coef0);
+        slice_restore(beta_matrix(i, j), screening_A, beta);
+        beta_matrix(i, j) = beta;
+      }
+    }
+    out_result.add("beta_all", beta_matrix);
 #else
     beta_screening_A = out_result["beta"];
     slice_restore(beta_screening_A, screening_A, beta);
@@ -875,35 +1556,156 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
 
 #ifndef R_BUILD
 
-void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_col, int n, int p, int data_type, double *weight, int weight_len, double *sigma, int sigma_row, int sigma_col,
-                  bool is_normal,
-                  int algorithm_type, int model_type, int max_iter, int exchange_num,
-                  int path_type, bool is_warm_start,
-                  int ic_type, double ic_coef, bool is_cv, int Kfold,
-                  int *gindex, int gindex_len,
-                  int *status, int status_len,
-                  int *sequence, int sequence_len,
-                  double *lambda_sequence, int lambda_sequence_len,
-                  int s_min, int s_max, int K_max, double epsilon,
-                  double lambda_min, double lambda_max, int n_lambda,
-                  bool is_screening, int screening_size, int powell_path,
-                  int *always_select, int always_select_len, double tau,
-                  int primary_model_fit_max_iter, double primary_model_fit_epsilon,
-                  bool early_stop, bool approximate_Newton,
-                  int thread,
-                  bool covariance_update,
-                  bool sparse_matrix,
-                  int splicing_type,
-                  double *beta_out, int beta_out_len, double *coef0_out, int coef0_out_len, double *train_loss_out,
-                  int train_loss_out_len, double *ic_out, int ic_out_len, double *nullloss_out, double *aic_out,
-                  int aic_out_len, double *bic_out, int bic_out_len, double *gic_out, int gic_out_len, int *A_out,
-                  int A_out_len, int *l_out)
+AbessSession *pywrap_session_new(double *x, int x_row, int x_col, double *y, int y_row, int y_col, int n, int p, int x_layout,
+                                 double *sparse_x_val, int sparse_x_nnz, int *sparse_x_idx, int sparse_x_idx_len, int *sparse_x_ptr, int sparse_x_ptr_len, int sparse_format,
+                                 int *row_order, int row_order_len,
+                                 int data_type, double *weight, int weight_len,
+                                 bool is_normal,
+                                 int *gindex, int gindex_len,
+                                 int *status, int status_len,
+                                 bool sparse_matrix)
+{
+  // x_layout = 1: x is a column-major (Fortran) buffer passed as its transpose.
+  // x_layout = 0: x is row-major (C).
+  // Either way x is mapped without copy, and the session makes the only column-major copy.
+  if (x_layout == 1)
+  {
+    std::swap(x_row, x_col);
+  }
+  Eigen::Map<Eigen::MatrixXd> x_Map(x, x_row, x_col);
+
+  // sparse_format = 0: CSC buffers, with sorted and unique row indices, are mapped as they are.
+  // sparse_format = 1 or 2: CSR or COO buffers are converted to CSC first.
+  Eigen::VectorXi csc_outer, csc_inner;
+  Eigen::VectorXd csc_value;
+  int zero = 0;
+  int *outer = &zero, *inner = &zero;
+  double *value = sparse_x_val;
+  int sparse_row = 0, sparse_col = 0, nnz = 0;
+  if (sparse_matrix)
+  {
+    sparse_row = n;
+    sparse_col = p;
+    if (sparse_format == 0)
+    {
+      outer = sparse_x_ptr;
+      inner = sparse_x_idx;
+      nnz = sparse_x_ptr[p];
+    }
+    else
+    {
+      sparse_to_csc(n, p, sparse_x_nnz, sparse_x_val, sparse_x_idx, sparse_x_ptr, sparse_format, csc_outer, csc_inner, csc_value);
+      outer = csc_outer.data();
+      inner = csc_inner.data();
+      value = csc_value.data();
+      nnz = csc_outer(p);
+    }
+  }
+  Eigen::Map<Eigen::SparseMatrix<double>> sparse_x_Map(sparse_row, sparse_col, nnz, outer, inner, value);
+
+  Eigen::MatrixXd y_Mat = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(y, y_row, y_col);
+  Eigen::VectorXd weight_Vec = Eigen::Map<Eigen::VectorXd>(weight, weight_len);
+  Eigen::VectorXi gindex_Vec = Eigen::Map<Eigen::VectorXi>(gindex, gindex_len);
+  Eigen::VectorXi status_Vec = Eigen::Map<Eigen::VectorXi>(status, status_len);
+  Eigen::VectorXi row_order_Vec = Eigen::Map<Eigen::VectorXi>(row_order, row_order_len);
+
+  if (!sparse_matrix && x_layout != 1)
+  {
+    Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> x_row_major(x, x_row, x_col);
+    return new AbessSession(x_row_major, y_Mat, data_type, weight_Vec, is_normal, gindex_Vec, status_Vec, false, row_order_Vec);
+  }
+  return new AbessSession(x_Map, sparse_x_Map, y_Mat, data_type, weight_Vec, is_normal, gindex_Vec, status_Vec, sparse_matrix, false, row_order_Vec);
+}
+
+AbessSession *pywrap_session_new_float(float *x, int x_row, int x_col, double *y, int y_row, int y_col, int x_layout,
+                                       int *row_order, int row_order_len,
+                                       int data_type, double *weight, int weight_len,
+                                       bool is_normal,
+                                       int *gindex, int gindex_len,
+                                       int *status, int status_len)
+{
+  Eigen::MatrixXd y_Mat = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(y, y_row, y_col);
+  Eigen::VectorXd weight_Vec = Eigen::Map<Eigen::VectorXd>(weight, weight_len);
+  Eigen::VectorXi gindex_Vec = Eigen::Map<Eigen::VectorXi>(gindex, gindex_len);
+  Eigen::VectorXi status_Vec = Eigen::Map<Eigen::VectorXi>(status, status_len);
+  Eigen::VectorXi row_order_Vec = Eigen::Map<Eigen::VectorXi>(row_order, row_order_len);
+
+  if (x_layout == 1)
+  {
+    Eigen::Map<Eigen::MatrixXf> x_Map(x, x_col, x_row);
+    return new AbessSession(x_Map, y_Mat, data_type, weight_Vec, is_normal, gindex_Vec, status_Vec, row_order_Vec);
+  }
+  Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> x_Map(x, x_row, x_col);
+  return new AbessSession(x_Map, y_Mat, data_type, weight_Vec, is_normal, gindex_Vec, status_Vec, row_order_Vec);
+}
+
+AbessSession *pywrap_session_new_genotype(unsigned char *codes, int codes_row, int codes_col, int n, double *y, int y_row, int y_col,
+                                          int *row_order, int row_order_len,
+                                          int data_type, double *weight, int weight_len,
+                                          bool is_normal,
+                                          int *gindex, int gindex_len,
+                                          int *status, int status_len)
+{
+  GenotypeMatrix x(codes, n, codes_row);
+
+  Eigen::MatrixXd y_Mat = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(y, y_row, y_col);
+  Eigen::VectorXd weight_Vec = Eigen::Map<Eigen::VectorXd>(weight, weight_len);
+  Eigen::VectorXi gindex_Vec = Eigen::Map<Eigen::VectorXi>(gindex, gindex_len);
+  Eigen::VectorXi status_Vec = Eigen::Map<Eigen::VectorXi>(status, status_len);
+  Eigen::VectorXi row_order_Vec = Eigen::Map<Eigen::VectorXi>(row_order, row_order_len);
+
+  return new AbessSession(x, y_Mat, data_type, weight_Vec, is_normal, gindex_Vec, status_Vec, row_order_Vec);
+}
+
+AbessSession *pywrap_session_new_mapped(MappedDesign *design, double *y, int y_row, int y_col,
+                                        int *row_order, int row_order_len,
+                                        int data_type, double *weight, int weight_len,
+                                        bool is_normal,
+                                        int *gindex, int gindex_len,
+                                        int *status, int status_len)
+{
+  Eigen::MatrixXd y_Mat = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(y, y_row, y_col);
+  Eigen::VectorXd weight_Vec = Eigen::Map<Eigen::VectorXd>(weight, weight_len);
+  Eigen::VectorXi gindex_Vec = Eigen::Map<Eigen::VectorXi>(gindex, gindex_len);
+  Eigen::VectorXi status_Vec = Eigen::Map<Eigen::VectorXi>(status, status_len);
+  Eigen::VectorXi row_order_Vec = Eigen::Map<Eigen::VectorXi>(row_order, row_order_len);
+
+  return new AbessSession(*design, y_Mat, data_type, weight_Vec, is_normal, gindex_Vec, status_Vec, row_order_Vec);
+}
+
+void pywrap_session_fit(AbessSession *session, double *y, int y_row, int y_col, double *sigma, int sigma_row, int sigma_col,
+                        int algorithm_type, int model_type, int max_iter, int exchange_num,
+                        int path_type, bool is_warm_start,
+                        int ic_type, double ic_coef, bool is_cv, int K,
+                        int *status, int status_len,
+                        int *sequence, int sequence_len,
+                        double *lambda_sequence, int lambda_sequence_len,
+                        int s_min, int s_max, int K_max, double epsilon,
+                        double lambda_min, double lambda_max, int n_lambda,
+                        bool is_screening, int screening_size, int powell_path,
+                        int *always_select, int always_select_len, double tau,
+                        int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                        bool early_stop, bool approximate_Newton,
+                        int thread,
+                        bool covariance_update,
+                        int splicing_type,
+                        int important_search,
+                        double strong_rule,
+                        bool active_warm_start,
+                        int cox_ties,
+                        int primary_solver,
+                        bool parallel_exchange,
+                        double *beta_out, int beta_out_len, double *coef0_out, int coef0_out_len, double *train_loss_out,
+                        int train_loss_out_len, double *ic_out, int ic_out_len, double *nullloss_out,
+                        double *beta_all_out, int beta_all_out_len, double *coef0_all_out, int coef0_all_out_len,
+                        double *train_loss_all_out, int train_loss_all_out_len, double *ic_all_out, int ic_all_out_len,
+                        double *test_loss_all_out, int test_loss_all_out_len, int *sequence_out, int sequence_out_len,
+                        int *pruned_all_out, int pruned_all_out_len, int *iter_all_out, int iter_all_out_len,
+                        int *primary_iter_all_out, int primary_iter_all_out_len, double *primary_time_all_out, int primary_time_all_out_len,
+                        int *path_len_out)
 {
-  Eigen::MatrixXd x_Mat;
   Eigen::MatrixXd y_Mat;
   Eigen::MatrixXd sigma_Mat;
-  Eigen::VectorXd weight_Vec;
-  Eigen::VectorXi gindex_Vec;
   Eigen::VectorXi status_Vec;
   Eigen::VectorXi sequence_Vec;
   Eigen::VectorXd lambda_sequence_Vec;
@@ -912,40 +1714,37 @@ void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_c
 #ifdef TEST
   clock_t t1, t2;
 #endif
-  // t1 = clock();
-  x_Mat = Pointer2MatrixXd(x, x_row, x_col);
-  y_Mat = Pointer2MatrixXd(y, y_row, y_col);
-  sigma_Mat = Pointer2MatrixXd(sigma, sigma_row, sigma_col);
-  weight_Vec = Pointer2VectorXd(weight, weight_len);
-  status_Vec = Pointer2VectorXi(status, status_len);
-  gindex_Vec = Pointer2VectorXi(gindex, gindex_len);
-  sequence_Vec = Pointer2VectorXi(sequence, sequence_len);
-  lambda_sequence_Vec = Pointer2VectorXd(lambda_sequence, lambda_sequence_len);
-  always_select_Vec = Pointer2VectorXi(always_select, always_select_len);
-  // t2 = clock();
-  // std::cout << "pointer to data: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
+  y_Mat = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(y, y_row, y_col);
+  sigma_Mat = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(sigma, sigma_row, sigma_col);
+  status_Vec = Eigen::Map<Eigen::VectorXi>(status, status_len);
+  sequence_Vec = Eigen::Map<Eigen::VectorXi>(sequence, sequence_len);
+  lambda_sequence_Vec = Eigen::Map<Eigen::VectorXd>(lambda_sequence, lambda_sequence_len);
+  always_select_Vec = Eigen::Map<Eigen::VectorXi>(always_select, always_select_len);
 #ifdef TEST
   t1 = clock();
 #endif
-  List mylist = abessCpp2(x_Mat, y_Mat, n, p, data_type, weight_Vec, sigma_Mat,
-                          is_normal,
-                          algorithm_type, model_type, max_iter, exchange_num,
-                          path_type, is_warm_start,
-                          ic_type, ic_coef, is_cv, Kfold,
-                          status_Vec,
-                          sequence_Vec,
-                          lambda_sequence_Vec,
-                          s_min, s_max, K_max, epsilon,
-                          lambda_min, lambda_max, n_lambda,
-                          is_screening, screening_size, powell_path,
-                          gindex_Vec,
-                          always_select_Vec, tau,
-                          primary_model_fit_max_iter, primary_model_fit_epsilon,
-                          early_stop, approximate_Newton,
-                          thread,
-                          covariance_update,
-                          sparse_matrix,
-                          splicing_type);
+  List mylist = abessSessionFit(*session, y_Mat, sigma_Mat,
+                                algorithm_type, model_type, max_iter, exchange_num,
+                                path_type, is_warm_start,
+                                ic_type, ic_coef, is_cv, K,
+                                status_Vec,
+                                sequence_Vec,
+                                lambda_sequence_Vec,
+                                s_min, s_max, K_max, epsilon,
+                                lambda_min, lambda_max, n_lambda,
+                                is_screening, screening_size, powell_path,
+                                always_select_Vec, tau,
+                                primary_model_fit_max_iter, primary_model_fit_epsilon,
+                                early_stop, approximate_Newton,
+                                thread,
+                                covariance_update,
+                                splicing_type,
+                                important_search,
+                                strong_rule,
+                                active_warm_start,
+                                cox_ties,
+                                primary_solver,
+                                parallel_exchange);
 
 #ifdef TEST
   t2 = clock();
@@ -953,7 +1752,7 @@ void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_c
 #endif
 
   // t1 = clock();
-  if (y_col == 1)
+  if (session->M == 1)
   {
     Eigen::VectorXd beta;
     double coef0 = 0;
@@ -964,10 +1763,24 @@ void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_c
     mylist.get_value_by_name("train_loss", train_loss);
     mylist.get_value_by_name("ic", ic);
 
-    VectorXd2Pointer(beta, beta_out);
+    Eigen::Map<Eigen::VectorXd>(beta_out, beta_out_len) = beta;
     *coef0_out = coef0;
     *train_loss_out = train_loss;
     *ic_out = ic;
+
+    Eigen::Matrix<Eigen::VectorXd, Eigen::Dynamic, Eigen::Dynamic> beta_all;
+    Eigen::MatrixXd coef0_all;
+    mylist.get_value_by_name("beta_all", beta_all);
+    mylist.get_value_by_name("coef0_all", coef0_all);
+    for (int i = 0; i < beta_all.rows(); i++)
+    {
+      for (int j = 0; j < beta_all.cols(); j++)
+      {
+        int k = i * beta_all.cols() + j;
+        Eigen::Map<Eigen::VectorXd>(beta_all_out + k * beta_out_len, beta_out_len) = beta_all(i, j);
+        coef0_all_out[k] = coef0_all(i, j);
+      }
+    }
   }
   else
   {
@@ -988,13 +1801,183 @@ void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_c
     // cout << "ic" << endl;
     // cout << ic << endl;
 
-    MatrixXd2Pointer(beta, beta_out);
-    VectorXd2Pointer(coef0, coef0_out);
+    // beta_out is read back as a C-ordered (p, M) array
+    Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(beta_out, beta.rows(), beta.cols()) = beta;
+    Eigen::Map<Eigen::VectorXd>(coef0_out, coef0_out_len) = coef0;
     train_loss_out[0] = train_loss;
     ic_out[0] = ic;
+
+    Eigen::Matrix<Eigen::MatrixXd, Eigen::Dynamic, Eigen::Dynamic> beta_all;
+    Eigen::Matrix<Eigen::VectorXd, Eigen::Dynamic, Eigen::Dynamic> coef0_all;
+    mylist.get_value_by_name("beta_all", beta_all);
+    mylist.get_value_by_name("coef0_all", coef0_all);
+    for (int i = 0; i < beta_all.rows(); i++)
+    {
+      for (int j = 0; j < beta_all.cols(); j++)
+      {
+        int k = i * beta_all.cols() + j;
+        Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(beta_all_out + k * beta_out_len, beta_all(i, j).rows(), beta_all(i, j).cols()) = beta_all(i, j);
+        Eigen::Map<Eigen::VectorXd>(coef0_all_out + k * coef0_out_len, coef0_out_len) = coef0_all(i, j);
+      }
+    }
+  }
+
+  // the path is written cell by cell, support size first and lambda second
+  Eigen::MatrixXd train_loss_all;
+  Eigen::MatrixXd ic_all;
+  Eigen::MatrixXd test_loss_all;
+  Eigen::VectorXi sequence_all;
+  Eigen::MatrixXi pruned_all;
+  Eigen::MatrixXi iter_all;
+  Eigen::MatrixXi primary_iter_all;
+  Eigen::MatrixXd primary_time_all;
+  mylist.get_value_by_name("train_loss_all", train_loss_all);
+  mylist.get_value_by_name("ic_all", ic_all);
+  mylist.get_value_by_name("test_loss_all", test_loss_all);
+  mylist.get_value_by_name("sequence", sequence_all);
+  mylist.get_value_by_name("pruned_all", pruned_all);
+  mylist.get_value_by_name("iter_all", iter_all);
+  mylist.get_value_by_name("primary_iter_all", primary_iter_all);
+  mylist.get_value_by_name("primary_time_all", primary_time_all);
+  typedef Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> RowMajorMap;
+  RowMajorMap(train_loss_all_out, train_loss_all.rows(), train_loss_all.cols()) = train_loss_all;
+  RowMajorMap(ic_all_out, ic_all.rows(), ic_all.cols()) = ic_all;
+  RowMajorMap(test_loss_all_out, test_loss_all.rows(), test_loss_all.cols()) = test_loss_all;
+  RowMajorMap(primary_time_all_out, primary_time_all.rows(), primary_time_all.cols()) = primary_time_all;
+  Eigen::Map<Eigen::VectorXi>(sequence_out, sequence_all.size()) = sequence_all;
+  typedef Eigen::Map<Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> RowMajorMapi;
+  RowMajorMapi(pruned_all_out, pruned_all.rows(), pruned_all.cols()) = pruned_all;
+  RowMajorMapi(iter_all_out, iter_all.rows(), iter_all.cols()) = iter_all;
+  RowMajorMapi(primary_iter_all_out, primary_iter_all.rows(), primary_iter_all.cols()) = primary_iter_all;
+  *path_len_out = train_loss_all.size();
+
+}
+
+void pywrap_session_free(AbessSession *session)
+{
+  delete session;
+}
+
+void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_col, int n, int p, int x_layout,
+                  double *sparse_x_val, int sparse_x_nnz, int *sparse_x_idx, int sparse_x_idx_len, int *sparse_x_ptr, int sparse_x_ptr_len, int sparse_format,
+                  int *row_order, int row_order_len,
+                  int data_type, double *weight, int weight_len, double *sigma, int sigma_row, int sigma_col,
+                  bool is_normal,
+                  int algorithm_type, int model_type, int max_iter, int exchange_num,
+                  int path_type, bool is_warm_start,
+                  int ic_type, double ic_coef, bool is_cv, int K,
+                  int *gindex, int gindex_len,
+                  int *status, int status_len,
+                  int *sequence, int sequence_len,
+                  double *lambda_sequence, int lambda_sequence_len,
+                  int s_min, int s_max, int K_max, double epsilon,
+                  double lambda_min, double lambda_max, int n_lambda,
+                  bool is_screening, int screening_size, int powell_path,
+                  int *always_select, int always_select_len, double tau,
+                  int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                  bool early_stop, bool approximate_Newton,
+                  int thread,
+                  bool covariance_update,
+                  bool sparse_matrix,
+                  int splicing_type,
+                  int important_search,
+                  double strong_rule,
+                  bool active_warm_start,
+                  int cox_ties,
+                  int primary_solver,
+                  bool parallel_exchange,
+                  double *beta_out, int beta_out_len, double *coef0_out, int coef0_out_len, double *train_loss_out,
+                  int train_loss_out_len, double *ic_out, int ic_out_len, double *nullloss_out,
+                  double *beta_all_out, int beta_all_out_len, double *coef0_all_out, int coef0_all_out_len,
+                  double *train_loss_all_out, int train_loss_all_out_len, double *ic_all_out, int ic_all_out_len,
+                  double *test_loss_all_out, int test_loss_all_out_len, int *sequence_out, int sequence_out_len,
+                  int *pruned_all_out, int pruned_all_out_len, int *iter_all_out, int iter_all_out_len,
+                  int *primary_iter_all_out, int primary_iter_all_out_len, double *primary_time_all_out, int primary_time_all_out_len,
+                  int *path_len_out)
+{
+  AbessSession *session = pywrap_session_new(x, x_row, x_col, y, y_row, y_col, n, p, x_layout,
+                                             sparse_x_val, sparse_x_nnz, sparse_x_idx, sparse_x_idx_len, sparse_x_ptr, sparse_x_ptr_len, sparse_format,
+                                             row_order, row_order_len,
+                                             data_type, weight, weight_len,
+                                             is_normal,
+                                             gindex, gindex_len,
+                                             status, status_len,
+                                             sparse_matrix);
+  pywrap_session_fit(session, y, y_row, y_col, sigma, sigma_row, sigma_col,
+                     algorithm_type, model_type, max_iter, exchange_num,
+                     path_type, is_warm_start,
+                     ic_type, ic_coef, is_cv, K,
+                     status, status_len,
+                     sequence, sequence_len,
+                     lambda_sequence, lambda_sequence_len,
+                     s_min, s_max, K_max, epsilon,
+                     lambda_min, lambda_max, n_lambda,
+                     is_screening, screening_size, powell_path,
+                     always_select, always_select_len, tau,
+                     primary_model_fit_max_iter, primary_model_fit_epsilon,
+                     early_stop, approximate_Newton,
+                     thread,
+                     covariance_update,
+                     splicing_type,
+                     important_search,
+                     strong_rule,
+                     active_warm_start,
+                     cox_ties,
+                     primary_solver,
+                     parallel_exchange,
+                     beta_out, beta_out_len, coef0_out, coef0_out_len, train_loss_out,
+                     train_loss_out_len, ic_out, ic_out_len, nullloss_out,
+                     beta_all_out, beta_all_out_len, coef0_all_out, coef0_all_out_len,
+                     train_loss_all_out, train_loss_all_out_len, ic_all_out, ic_all_out_len,
+                     test_loss_all_out, test_loss_all_out_len, sequence_out, sequence_out_len,
+                     pruned_all_out, pruned_all_out_len, iter_all_out, iter_all_out_len,
+                     primary_iter_all_out, primary_iter_all_out_len, primary_time_all_out, primary_time_all_out_len,
+                     path_len_out);
+  delete session;
+}
+
+MappedDesign *pywrap_mapped_open(char *path)
+{
+  MappedDesign *design = new MappedDesign(path);
+  if (!design->is_open())
+  {
+    delete design;
+    return NULL;
   }
+  return design;
+}
 
-  // t2 = clock();
-  // std::cout << "result to pointer: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
+int pywrap_mapped_rows(MappedDesign *design)
+{
+  return design->rows();
+}
+
+int pywrap_mapped_cols(MappedDesign *design)
+{
+  return design->cols();
+}
+
+void pywrap_mapped_gather(MappedDesign *design, int *ind, int ind_len, double *x_out, int x_out_len)
+{
+  Eigen::VectorXi ind_Vec = Eigen::Map<Eigen::VectorXi>(ind, ind_len);
+  Eigen::MatrixXd x_seg;
+  design->read_cols(ind_Vec, x_seg);
+  Eigen::Map<Eigen::MatrixXd>(x_out, design->rows(), ind_len) = x_seg;
+}
+
+void pywrap_mapped_close(MappedDesign *design)
+{
+  delete design;
+}
+
+void pywrap_cox_risk_sets(double *time, int time_len, int *strata, int strata_len,
+                          int *order_out, int order_out_len, int *key_out, int key_out_len)
+{
+  Eigen::VectorXd time_Vec = Eigen::Map<Eigen::VectorXd>(time, time_len);
+  Eigen::VectorXi strata_Vec = Eigen::Map<Eigen::VectorXi>(strata, strata_len);
+  Eigen::VectorXi order, key;
+  cox_risk_sets(time_Vec, strata_Vec, order, key);
+  Eigen::Map<Eigen::VectorXi>(order_out, time_len) = order;
+  Eigen::Map<Eigen::VectorXi>(key_out, time_len) = key;
 }
 #endif
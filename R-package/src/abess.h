@@ -14,9 +14,11 @@ using namespace Rcpp;
 #include <Eigen/Eigen>
 #include "List.h"
 #include "Algorithm.h"
+#include "MappedDesign.h"
 #endif
 
 #include <iostream>
+#include "Session.h"
 
 template <class T2, class T3>
 struct Result
@@ -26,11 +28,81 @@ struct Result
     Eigen::MatrixXd ic_matrix;
     Eigen::MatrixXd test_loss_matrix;
     Eigen::MatrixXd train_loss_matrix;
+    // the pruned_size and the splicing iterations of each fit, see Algorithm
+    Eigen::MatrixXi pruned_matrix;
+    Eigen::MatrixXi iter_matrix;
+    // the iterations and seconds of the primary fits of each fit, see Algorithm::primary_stats()
+    Eigen::MatrixXi primary_iter_matrix;
+    Eigen::MatrixXd primary_time_matrix;
     // Eigen::Matrix<Eigen::VectorXi, Eigen::Dynamic, Eigen::Dynamic> A_matrix;
     Eigen::Matrix<Eigen::VectorXd, Eigen::Dynamic, Eigen::Dynamic> bd_matrix;
 };
 
-List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
+// The normalized design and its caches, kept across fits on the same x.
+// Only one of the sessions is used, depending on y, sparse_matrix, float_x, genotype_x and mapped_x.
+class AbessSession
+{
+public:
+  int n;
+  int p;
+  int M;
+  bool sparse_matrix;
+  // a dense x stored in float, see ActiveDesign
+  bool float_x = false;
+  // x given as packed genotypes, see GenotypeMatrix
+  bool genotype_x = false;
+  // x read from a file on disk, see MappedDesign
+  bool mapped_x = false;
+  Session<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXd> *session_uni_dense = nullptr;
+  Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd> *session_mul_dense = nullptr;
+  Session<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double>> *session_uni_sparse = nullptr;
+  Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::SparseMatrix<double>> *session_mul_sparse = nullptr;
+  Session<Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXf> *session_uni_float = nullptr;
+  Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXf> *session_mul_float = nullptr;
+  Session<Eigen::VectorXd, Eigen::VectorXd, double, GenotypeMatrix> *session_uni_genotype = nullptr;
+  Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, GenotypeMatrix> *session_mul_genotype = nullptr;
+  Session<Eigen::VectorXd, Eigen::VectorXd, double, MappedDesign> *session_uni_mapped = nullptr;
+  Session<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, MappedDesign> *session_mul_mapped = nullptr;
+
+  // the rows of x are taken in row_order if it is not empty, so that they follow y, weight and status
+  AbessSession(Eigen::Map<Eigen::MatrixXd> &x, Eigen::Map<Eigen::SparseMatrix<double>> &sparse_x, Eigen::MatrixXd &y,
+               int data_type, Eigen::VectorXd &weight, bool is_normal,
+               Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool sparse_matrix, bool float_x, Eigen::VectorXi &row_order);
+
+  AbessSession(Eigen::Map<Eigen::MatrixXf> &x, Eigen::MatrixXd &y,
+               int data_type, Eigen::VectorXd &weight, bool is_normal,
+               Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order);
+
+  // x in row-major (C) order, converted in the single copy the session makes
+  AbessSession(Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> &x, Eigen::MatrixXd &y,
+               int data_type, Eigen::VectorXd &weight, bool is_normal,
+               Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool float_x, Eigen::VectorXi &row_order);
+
+  AbessSession(Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> &x, Eigen::MatrixXd &y,
+               int data_type, Eigen::VectorXd &weight, bool is_normal,
+               Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order);
+
+  AbessSession(GenotypeMatrix &x, Eigen::MatrixXd &y,
+               int data_type, Eigen::VectorXd &weight, bool is_normal,
+               Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order);
+
+  // the session shares the file of x, which stays on disk
+  AbessSession(MappedDesign &x, Eigen::MatrixXd &y,
+               int data_type, Eigen::VectorXd &weight, bool is_normal,
+               Eigen::VectorXi &g_index, Eigen::VectorXi &status, Eigen::VectorXi &row_order);
+
+  AbessSession(const AbessSession &) = delete;
+  AbessSession &operator=(const AbessSession &) = delete;
+
+  ~AbessSession();
+
+private:
+  template <class T>
+  void new_dense_session(T &x, Eigen::MatrixXd &y, int data_type, Eigen::VectorXd &weight, bool is_normal,
+                         Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool float_x, Eigen::VectorXi &row_order);
+};
+
+List abessCpp2(Eigen::Map<Eigen::MatrixXd> x, Eigen::Map<Eigen::SparseMatrix<double>> sparse_x, Eigen::MatrixXd y, int n, int p,
                int data_type, Eigen::VectorXd weight, Eigen::MatrixXd sigma,
                bool is_normal,
                int algorithm_type, int model_type, int max_iter, int exchange_num,
@@ -50,12 +122,42 @@ List abessCpp2(Eigen::MatrixXd x, Eigen::MatrixXd y, int n, int p,
                int thread,
                bool covariance_update,
                bool sparse_matrix,
-               int splicing_type);
+               int splicing_type,
+               int important_search,
+               double strong_rule,
+               bool active_warm_start,
+               int cox_ties,
+               int primary_solver,
+               bool parallel_exchange,
+               bool float_x,
+               Eigen::VectorXi row_order);
+
+List abessSessionFit(AbessSession &session, Eigen::MatrixXd y, Eigen::MatrixXd sigma,
+                     int algorithm_type, int model_type, int max_iter, int exchange_num,
+                     int path_type, bool is_warm_start,
+                     int ic_type, double ic_coef, bool is_cv, int Kfold,
+                     Eigen::VectorXi status,
+                     Eigen::VectorXi sequence,
+                     Eigen::VectorXd lambda_seq,
+                     int s_min, int s_max, int K_max, double epsilon,
+                     double lambda_min, double lambda_max, int nlambda,
+                     bool is_screening, int screening_size, int powell_path,
+                     Eigen::VectorXi always_select,
+                     double tau,
+                     int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                     bool early_stop, bool approximate_Newton,
+                     int thread,
+                     bool covariance_update,
+                     int splicing_type,
+                     int important_search,
+                     double strong_rule,
+                     bool active_warm_start,
+                     int cox_ties,
+                     int primary_solver,
+                     bool parallel_exchange);
 
 template <class T1, class T2, class T3, class T4>
-List abessCpp(T4 &x, T1 &y, int n, int p,
-              int data_type, Eigen::VectorXd weight, Eigen::MatrixXd sigma,
-              bool is_normal,
+List abessCpp(Session<T1, T2, T3, T4> &session, T1 &y, Eigen::MatrixXd sigma,
               int algorithm_type, int model_type, int max_iter, int exchange_num,
               int path_type, bool is_warm_start,
               int ic_type, double ic_coef, bool is_cv, int Kfold,
@@ -65,7 +167,6 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
               int s_min, int s_max, int K_max, double epsilon,
               double lambda_min, double lambda_max, int nlambda,
               bool is_screening, int screening_size, int powell_path,
-              Eigen::VectorXi g_index,
               Eigen::VectorXi always_select,
               double tau,
               int primary_model_fit_max_iter, double primary_model_fit_epsilon,
@@ -73,10 +174,87 @@ List abessCpp(T4 &x, T1 &y, int n, int p,
               int thread,
               bool covariance_update,
               bool sparse_matrix,
+              int important_search,
+              double strong_rule,
+              bool active_warm_start,
+              int cox_ties,
+              int primary_solver,
+              bool parallel_exchange,
               Algorithm<T1, T2, T3, T4> *algorithm, vector<Algorithm<T1, T2, T3, T4> *> algorithm_list);
 
 #ifndef R_BUILD
-void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int n, int p, int y_col, int data_type, double *weight, int weight_len, double *sigma, int sigma_row, int sigma_col,
+AbessSession *pywrap_session_new(double *x, int x_row, int x_col, double *y, int y_row, int y_col, int n, int p, int x_layout,
+                                 double *sparse_x_val, int sparse_x_nnz, int *sparse_x_idx, int sparse_x_idx_len, int *sparse_x_ptr, int sparse_x_ptr_len, int sparse_format,
+                                 int *row_order, int row_order_len,
+                                 int data_type, double *weight, int weight_len,
+                                 bool is_normal,
+                                 int *gindex, int gindex_len,
+                                 int *status, int status_len,
+                                 bool sparse_matrix);
+
+// a dense x given in float32, x_layout as in pywrap_session_new
+AbessSession *pywrap_session_new_float(float *x, int x_row, int x_col, double *y, int y_row, int y_col, int x_layout,
+                                       int *row_order, int row_order_len,
+                                       int data_type, double *weight, int weight_len,
+                                       bool is_normal,
+                                       int *gindex, int gindex_len,
+                                       int *status, int status_len);
+
+// codes[j] holds the packed genotypes of column j, see GenotypeMatrix;
+// the rows are taken in row_order if it is not empty
+AbessSession *pywrap_session_new_genotype(unsigned char *codes, int codes_row, int codes_col, int n, double *y, int y_row, int y_col,
+                                          int *row_order, int row_order_len,
+                                          int data_type, double *weight, int weight_len,
+                                          bool is_normal,
+                                          int *gindex, int gindex_len,
+                                          int *status, int status_len);
+
+// a design opened by pywrap_mapped_open(), fitted from the file;
+// the rows are taken in row_order if it is not empty
+AbessSession *pywrap_session_new_mapped(MappedDesign *design, double *y, int y_row, int y_col,
+                                        int *row_order, int row_order_len,
+                                        int data_type, double *weight, int weight_len,
+                                        bool is_normal,
+                                        int *gindex, int gindex_len,
+                                        int *status, int status_len);
+
+void pywrap_session_fit(AbessSession *session, double *y, int y_row, int y_col, double *sigma, int sigma_row, int sigma_col,
+                        int algorithm_type, int model_type, int max_iter, int exchange_num,
+                        int path_type, bool is_warm_start,
+                        int ic_type, double ic_coef, bool is_cv, int K,
+                        int *status, int status_len,
+                        int *sequence, int sequence_len,
+                        double *lambda_sequence, int lambda_sequence_len,
+                        int s_min, int s_max, int K_max, double epsilon,
+                        double lambda_min, double lambda_max, int n_lambda,
+                        bool is_screening, int screening_size, int powell_path,
+                        int *always_select, int always_select_len, double tau,
+                        int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                        bool early_stop, bool approximate_Newton,
+                        int thread,
+                        bool covariance_update,
+                        int splicing_type,
+                        int important_search,
+                        double strong_rule,
+                        bool active_warm_start,
+                        int cox_ties,
+                        int primary_solver,
+                        bool parallel_exchange,
+                        double *beta_out, int beta_out_len, double *coef0_out, int coef0_out_len, double *train_loss_out,
+                        int train_loss_out_len, double *ic_out, int ic_out_len, double *nullloss_out,
+                        double *beta_all_out, int beta_all_out_len, double *coef0_all_out, int coef0_all_out_len,
+                        double *train_loss_all_out, int train_loss_all_out_len, double *ic_all_out, int ic_all_out_len,
+                        double *test_loss_all_out, int test_loss_all_out_len, int *sequence_out, int sequence_out_len,
+                        int *pruned_all_out, int pruned_all_out_len, int *iter_all_out, int iter_all_out_len,
+                        int *primary_iter_all_out, int primary_iter_all_out_len, double *primary_time_all_out, int primary_time_all_out_len,
+                        int *path_len_out);
+
+void pywrap_session_free(AbessSession *session);
+
+void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int y_col, int n, int p, int x_layout,
+                  double *sparse_x_val, int sparse_x_nnz, int *sparse_x_idx, int sparse_x_idx_len, int *sparse_x_ptr, int sparse_x_ptr_len, int sparse_format,
+                  int *row_order, int row_order_len,
+                  int data_type, double *weight, int weight_len, double *sigma, int sigma_row, int sigma_col,
                   bool is_normal,
                   int algorithm_type, int model_type, int max_iter, int exchange_num,
                   int path_type, bool is_warm_start,
@@ -95,10 +273,36 @@ void pywrap_abess(double *x, int x_row, int x_col, double *y, int y_row, int n,
                   bool covariance_update,
                   bool sparse_matrix,
                   int splicing_type,
+                  int important_search,
+                  double strong_rule,
+                  bool active_warm_start,
+                  int cox_ties,
+                  int primary_solver,
+                  bool parallel_exchange,
                   double *beta_out, int beta_out_len, double *coef0_out, int coef0_out_len, double *train_loss_out,
-                  int train_loss_out_len, double *ic_out, int ic_out_len, double *nullloss_out, double *aic_out,
-                  int aic_out_len, double *bic_out, int bic_out_len, double *gic_out, int gic_out_len, int *A_out,
-                  int A_out_len, int *l_out);
+                  int train_loss_out_len, double *ic_out, int ic_out_len, double *nullloss_out,
+                  double *beta_all_out, int beta_all_out_len, double *coef0_all_out, int coef0_all_out_len,
+                  double *train_loss_all_out, int train_loss_all_out_len, double *ic_all_out, int ic_all_out_len,
+                  double *test_loss_all_out, int test_loss_all_out_len, int *sequence_out, int sequence_out_len,
+                  int *pruned_all_out, int pruned_all_out_len, int *iter_all_out, int iter_all_out_len,
+                  int *primary_iter_all_out, int primary_iter_all_out_len, double *primary_time_all_out, int primary_time_all_out_len,
+                  int *path_len_out);
+
+// a design matrix file written by abess.save_design, NULL if it cannot be opened
+MappedDesign *pywrap_mapped_open(char *path);
+
+int pywrap_mapped_rows(MappedDesign *design);
+
+int pywrap_mapped_cols(MappedDesign *design);
+
+// the raw columns in ind, column-major
+void pywrap_mapped_gather(MappedDesign *design, int *ind, int ind_len, double *x_out, int x_out_len);
+
+void pywrap_mapped_close(MappedDesign *design);
+
+// the order that sorts the samples by strata and time, and the keys of cox_risk_sets() in that order
+void pywrap_cox_risk_sets(double *time, int time_len, int *strata, int strata_len,
+                          int *order_out, int order_out_len, int *key_out, int key_out_len);
 #endif
 
 #endif //BESS_BESS_H
\ No newline at end of file
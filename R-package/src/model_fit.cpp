@@ -1 +1,264 @@
+#include "model_fit.h"
 
+#include <algorithm>
+#include <vector>
+
+void cox_risk_sets(Eigen::VectorXd &time, Eigen::VectorXi &strata, Eigen::VectorXi &order, Eigen::VectorXi &key)
+{
+    int n = time.size();
+    bool stratified = strata.size() == n;
+    order = Eigen::VectorXi::LinSpaced(n, 0, n - 1);
+    std::stable_sort(order.data(), order.data() + n, [&](int i, int j) {
+        if (stratified && strata(i) != strata(j))
+            return strata(i) < strata(j);
+        return time(i) < time(j);
+    });
+
+    // the rank of each tie block within its stratum, and the first sample of each stratum
+    key.resize(n);
+    std::vector<int> stratum_start;
+    for (int i = 0; i < n; i++)
+    {
+        if (i == 0 || (stratified && strata(order(i)) != strata(order(i - 1))))
+        {
+            stratum_start.push_back(i);
+            key(i) = 0;
+        }
+        else
+        {
+            key(i) = time(order(i)) == time(order(i - 1)) ? key(i - 1) : key(i - 1) + 1;
+        }
+    }
+    stratum_start.push_back(n);
+
+    // the blocks of a later stratum are numbered below those of an earlier one
+    int offset = 0;
+    for (int s = (int)stratum_start.size() - 2; s >= 0; s--)
+    {
+        int end = stratum_start[s + 1];
+        int blocks = key(end - 1) + 1;
+        key.segment(stratum_start[s], end - stratum_start[s]).array() += offset;
+        offset += blocks;
+    }
+}
+
+void cox_blocks(Eigen::VectorXi &key, int n, Eigen::VectorXi &next, Eigen::VectorXi &start)
+{
+    next.resize(n);
+    std::vector<int> stratum_start(1, 0);
+    for (int i = 0; i < n - 1; i++)
+    {
+        if (key.size() != n || key(i + 1) > key(i))
+            next(i) = 1;
+        else if (key(i + 1) == key(i))
+            next(i) = 2;
+        else
+        {
+            next(i) = 0;
+            stratum_start.push_back(i + 1);
+        }
+    }
+    if (n > 0)
+        next(n - 1) = 0;
+    stratum_start.push_back(n);
+    start = Eigen::Map<Eigen::VectorXi>(stratum_start.data(), stratum_start.size());
+}
+
+void cox_scan(CoxHessian &h, Eigen::VectorXd &y, Eigen::VectorXd &weight, int begin, int end, bool efron)
+{
+    Eigen::VectorXd cum_eta(end - begin);
+    cum_eta(end - begin - 1) = h.eta(end - 1);
+    for (int k = end - 2; k >= begin; k--)
+    {
+        cum_eta(k - begin) = cum_eta(k + 1 - begin) + h.eta(k);
+    }
+
+    // the sum of the event weights over the risk sums of the earlier blocks
+    double cum_eta2 = 0;
+    int i = begin;
+    while (i < end)
+    {
+        int j = i + 1;
+        while (j < end && h.next(j - 1) == 2)
+            j++;
+
+        double S = cum_eta(i - begin);
+        double W = 0, E = 0;
+        int d = 0;
+        for (int k = i; k < j; k++)
+        {
+            if (y(k) != 0)
+            {
+                W += y(k) * weight(k);
+                E += h.eta(k);
+                d++;
+            }
+        }
+
+        // alpha for the samples of the risk set, beta for the events of the block
+        double alpha, beta;
+        if (!efron || d <= 1)
+        {
+            alpha = W / S;
+            beta = alpha;
+            h.a(i, 0) = W / pow(S, 2);
+        }
+        else
+        {
+            alpha = 0;
+            beta = 0;
+            for (int l = 0; l < d; l++)
+            {
+                double f = double(l) / d;
+                double S_l = S - f * E;
+                double m = W / d / S_l;
+                alpha += m;
+                beta += (1 - f) * m;
+                h.a(i, 0) += m / S_l;
+                h.a(i, 1) += f * m / S_l;
+                h.a(i, 2) += f * f * m / S_l;
+            }
+        }
+        for (int k = i; k < j; k++)
+        {
+            h.d(k) = (cum_eta2 + (y(k) != 0 ? beta : alpha)) * h.eta(k);
+            if (efron)
+                h.event(k) = y(k) != 0 ? h.eta(k) : 0;
+        }
+        cum_eta2 += alpha;
+        i = j;
+    }
+}
+
+void cox_log_ratio(Eigen::VectorXd &eta, Eigen::VectorXd &expeta, Eigen::VectorXd &status, Eigen::VectorXi &next, int begin, int end, bool efron, Eigen::VectorXd &ratio)
+{
+    Eigen::VectorXd cum_expeta(end - begin);
+    cum_expeta(end - begin - 1) = expeta(end - 1);
+    for (int k = end - 2; k >= begin; k--)
+    {
+        cum_expeta(k - begin) = cum_expeta(k + 1 - begin) + expeta(k);
+    }
+
+    int i = begin;
+    while (i < end)
+    {
+        int j = i + 1;
+        while (j < end && next(j - 1) == 2)
+            j++;
+
+        double S = cum_expeta(i - begin);
+        double E = 0;
+        int d = 0;
+        for (int k = i; k < j; k++)
+        {
+            if (status(k) != 0)
+            {
+                E += expeta(k);
+                d++;
+            }
+        }
+        if (!efron || d <= 1)
+        {
+            for (int k = i; k < j; k++)
+                ratio(k) = log(expeta(k) / S);
+        }
+        else
+        {
+            double log_S = 0;
+            for (int l = 0; l < d; l++)
+                log_S += log(S - double(l) / d * E);
+            for (int k = i; k < j; k++)
+                ratio(k) = eta(k) - log_S / d;
+        }
+        i = j;
+    }
+}
+
+void multinomial_weights(Eigen::MatrixXd &Pi, Eigen::MatrixXd &W)
+{
+    int n = Pi.rows();
+    int M = Pi.cols();
+    W.resize(n, M * M);
+    for (int m1 = 0; m1 < M; m1++)
+    {
+        for (int m2 = m1; m2 < M; m2++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                double PiPj = m1 == m2 ? Pi(i, m1) * (1 - Pi(i, m1)) : Pi(i, m1) * Pi(i, m2);
+                if (PiPj < 0.001)
+                {
+                    PiPj = 0.001;
+                }
+                W(i, m1 + m2 * M) = m1 == m2 ? PiPj : -PiPj;
+            }
+            W.col(m2 + m1 * M) = W.col(m1 + m2 * M);
+        }
+    }
+}
+
+void lbfgs_restrict(LbfgsMemory &memory, Eigen::VectorXi &col, int M)
+{
+    int q = col.size(), q0 = memory.col.size();
+    int k = memory.s.cols();
+    if (k == 0 || memory.s.rows() != q0 * M)
+    {
+        memory.s.resize(q * M, 0);
+        memory.y.resize(q * M, 0);
+        memory.col = col;
+        return;
+    }
+
+    // from(i) is the row of the old pairs on the column col(i), or -1
+    Eigen::VectorXi from = Eigen::VectorXi::Constant(q, -1);
+    for (int i = 0, j = 0; i < q && j < q0;)
+    {
+        if (col(i) == memory.col(j))
+            from(i++) = j++;
+        else if (col(i) < memory.col(j))
+            i++;
+        else
+            j++;
+    }
+
+    Eigen::MatrixXd s = Eigen::MatrixXd::Zero(q * M, k), y = Eigen::MatrixXd::Zero(q * M, k);
+    for (int m = 0; m < M; m++)
+    {
+        for (int i = 0; i < q; i++)
+        {
+            if (from(i) >= 0)
+            {
+                s.row(m * q + i) = memory.s.row(m * q0 + from(i));
+                y.row(m * q + i) = memory.y.row(m * q0 + from(i));
+            }
+        }
+    }
+
+    int kept = 0;
+    for (int l = 0; l < k; l++)
+    {
+        if (s.col(l).dot(y.col(l)) > 1e-10 * s.col(l).norm() * y.col(l).norm())
+        {
+            s.col(kept) = s.col(l);
+            y.col(kept++) = y.col(l);
+        }
+    }
+    memory.s = s.leftCols(kept);
+    memory.y = y.leftCols(kept);
+    memory.col = col;
+}
+
+Eigen::VectorXi fit_columns(Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+{
+    int q = 1;
+    for (int i = 0; i < A.size(); i++)
+        q += g_size(A(i));
+    Eigen::VectorXi col(q);
+    col(0) = -1;
+    for (int i = 0, k = 1; i < A.size(); i++)
+    {
+        for (int j = 0; j < g_size(A(i)); j++)
+            col(k++) = g_index(A(i)) + j;
+    }
+    return col;
+}
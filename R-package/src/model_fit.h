@@ -96,6 +96,77 @@ void pi(T4 &X, Eigen::MatrixXd &y, Eigen::MatrixXd &coef, Eigen::MatrixXd &pr)
     // return pi;
 };
 
+// the same with the columns of X after the constant first one centered by center, unless it is empty
+template <class T4>
+void pi(T4 &X, Eigen::MatrixXd &y, Eigen::MatrixXd &coef, Eigen::MatrixXd &pr, Eigen::VectorXd &center)
+{
+    if (center.size() == 0)
+    {
+        pi(X, y, coef, pr);
+        return;
+    }
+    Eigen::MatrixXd beta = coef.bottomRows(coef.rows() - 1);
+    Eigen::MatrixXd coef_X = coef;
+    coef_X.row(0) -= center_shift(center, beta).transpose();
+    pi(X, y, coef_X, pr);
+};
+
+// The IRLS weights of a multinomial fit: W(i, m1 + m2 * M) is the (m1, m2) entry of the weight block
+// diag(Pi_i) - Pi_i^T Pi_i of sample i, with each entry at least 0.001 in absolute value.
+void multinomial_weights(Eigen::MatrixXd &Pi, Eigen::MatrixXd &W);
+
+// The normal equations XTWX vec(beta1) = XTWz of the IRLS step from the (p + 1) x M beta, with
+// XTWX = sum_i (x_i x_i^T) (x) W_i and XTWz = X^T W X beta + X^T (y - Pi) assembled by class pair,
+// so the (M n) x (M n) weight matrix is never formed. 2 * lambda I is added to each block of XTWX.
+// The columns of X after the first are centered by center, see Data::x_center, unless it is empty.
+template <class T4>
+void multinomial_irls(T4 &X, Eigen::MatrixXd &y, Eigen::MatrixXd &Pi, Eigen::MatrixXd &beta, double lambda, Eigen::MatrixXd &XTWX, Eigen::VectorXd &XTWz, Eigen::VectorXd &center)
+{
+    int q = X.cols();
+    int M = y.cols();
+    Eigen::MatrixXd W;
+    multinomial_weights(Pi, W);
+    Eigen::VectorXd center_all;
+    if (center.size() != 0)
+    {
+        center_all.resize(q);
+        center_all << 0, center;
+    }
+
+    XTWX.resize(M * q, M * q);
+    Eigen::VectorXd w, no_z;
+    Eigen::MatrixXd XTWX_block;
+    for (int m1 = 0; m1 < M; m1++)
+    {
+        for (int m2 = m1; m2 < M; m2++)
+        {
+            w = W.col(m1 + m2 * M);
+            weighted_gram(X, w, no_z, XTWX_block, XTWz);
+            if (center.size() != 0)
+            {
+                Eigen::VectorXd XTw = X.transpose() * w;
+                center_XTHX(XTWX_block, XTw, w.sum(), center_all);
+            }
+            XTWX_block.diagonal().array() += 2 * lambda;
+            XTWX.block(m1 * q, m2 * q, q, q) = XTWX_block;
+            XTWX.block(m2 * q, m1 * q, q, q) = XTWX_block;
+        }
+    }
+
+    Eigen::MatrixXd Xbeta = X * beta;
+    Xbeta.rowwise() -= center_shift(center_all, beta).transpose();
+    Eigen::MatrixXd z = y - Pi;
+    for (int m1 = 0; m1 < M; m1++)
+    {
+        for (int m2 = 0; m2 < M; m2++)
+        {
+            z.col(m1) += W.col(m1 + m2 * M).cwiseProduct(Xbeta.col(m2));
+        }
+    }
+    Eigen::MatrixXd XTz = XTr(X, z, center_all);
+    XTWz = Eigen::Map<Eigen::VectorXd>(XTz.data(), M * q);
+}
+
 template <class T4>
 void multinomial_fit(T4 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon, double tau, double lambda)
 {
@@ -212,121 +283,17 @@ void multinomial_fit(T4 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen:
     }
     else
     {
-        Eigen::MatrixXd W(M * n, M * n);
-        Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
-        for (int m1 = 0; m1 < M; m1++)
-        {
-            for (int m2 = m1; m2 < M; m2++)
-            {
-                if (m1 == m2)
-                {
-                    W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-#ifdef TEST
-                    std::cout << "primary_model_fit 5" << endl;
-
-#endif
-                    Eigen::VectorXd PiPj = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-                    // cout << "PiPj: " << PiPj << endl;
-                    for (int i = 0; i < PiPj.size(); i++)
-                    {
-                        if (PiPj(i) < 0.001)
-                        {
-                            PiPj(i) = 0.001;
-                        }
-                    }
-                    W.block(m1 * n, m2 * n, n, n).diagonal() = PiPj;
-
-#ifdef TEST
-                    std::cout << "primary_model_fit 6" << endl;
-                    cout << "W m1 m2: " << W.block(m1 * n, m2 * n, n, n) << endl;
-#endif
-                }
-                else
-                {
-                    W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-#ifdef TEST
-                    std::cout << "primary_model_fit 5" << endl;
-
-#endif
-                    Eigen::VectorXd PiPj = Pi.col(m1).array() * Pi.col(m2).array();
-                    // cout << "PiPj: " << PiPj << endl;
-                    for (int i = 0; i < PiPj.size(); i++)
-                    {
-                        if (PiPj(i) < 0.001)
-                        {
-                            PiPj(i) = 0.001;
-                        }
-                    }
-                    W.block(m1 * n, m2 * n, n, n).diagonal() = -PiPj;
-                    W.block(m2 * n, m1 * n, n, n) = W.block(m1 * n, m2 * n, n, n);
-
-                    // cout << "W m1 m2: " << W.block(m1 * n, m2 * n, n, n) << endl;
-                }
-            }
-        }
-
-#ifdef TEST
-        std::cout << "primary_model_fit 7" << endl;
-#endif
-        // cout << "W: " << W << endl;
-
-        Eigen::MatrixXd XTWX(M * (p + 1), M * (p + 1));
-        Eigen::MatrixXd XTW(M * (p + 1), M * n);
-        for (int m1 = 0; m1 < M; m1++)
-        {
-            for (int m2 = m1; m2 < M; m2++)
-            {
-                XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) = X.transpose() * W.block(m1 * n, m2 * n, n, n);
-                XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1)) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) * X;
-                XTW.block(m2 * (p + 1), m1 * n, (p + 1), n) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n);
-                XTWX.block(m2 * (p + 1), m1 * (p + 1), (p + 1), (p + 1)) = XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1));
-            }
-        }
-
-#ifdef TEST
-        std::cout << "primary_model_fit 8" << endl;
-#endif
-
-        // Eigen::Matrix<Eigen::MatrixXd, -1, -1> res(M, 1);
-        Eigen::VectorXd res(M * n);
-        for (int m1 = 0; m1 < M; m1++)
-        {
-            res.segment(m1 * n, n) = y.col(m1).eval() - Pi.col(m1).eval();
-        }
-
-#ifdef TEST
-        std::cout << "primary_model_fit 9" << endl;
-        cout << "res: " << res << endl;
-#endif
-
-        Eigen::VectorXd Xbeta(M * n);
-        for (int m1 = 0; m1 < M; m1++)
-        {
-            Xbeta.segment(m1 * n, n) = X * beta0.col(m1).eval();
-        }
-
-#ifdef TEST
-        std::cout << "primary_model_fit 10" << endl;
-        cout << "Xbeta: " << Xbeta << endl;
-#endif
+        Eigen::MatrixXd XTWX;
+        Eigen::VectorXd XTWz, no_center;
+        multinomial_irls(X, y, Pi, beta0, 0., XTWX, XTWz, no_center);
 
-        Eigen::VectorXd Z = Xbeta + W.ldlt().solve(res);
-#ifdef TEST
-        std::cout << "primary_model_fit 11" << endl;
-#endif
-
-#ifdef TEST
-        std::cout << "primary_model_fit 2" << endl;
-#endif
-
-        Eigen::MatrixXd beta1;
         Eigen::VectorXd beta0_tmp;
         for (j = 0; j < primary_model_fit_max_iter; j++)
         {
 #ifdef TEST
             std::cout << "primary_model_fit 3: " << j << endl;
 #endif
-            beta0_tmp = XTWX.ldlt().solve(XTW * Z);
+            beta0_tmp = XTWX.ldlt().solve(XTWz);
             for (int m1 = 0; m1 < M; m1++)
             {
                 beta0.col(m1) = beta0_tmp.segment(m1 * (p + 1), (p + 1)) - beta0_tmp.segment((M - 1) * (p + 1), (p + 1));
@@ -358,65 +325,7 @@ void multinomial_fit(T4 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen:
             }
             loglik0 = loglik1;
 
-            for (int m1 = 0; m1 < M; m1++)
-            {
-                for (int m2 = m1; m2 < M; m2++)
-                {
-                    if (m1 == m2)
-                    {
-                        // W(m1, m2) = Eigen::MatrixXd::Zero(n, n);
-                        // W(m1, m2).diagonal() = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-
-                        W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-                        Eigen::VectorXd PiPj = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-                        for (int i = 0; i < PiPj.size(); i++)
-                        {
-                            if (PiPj(i) < 0.001)
-                            {
-                                PiPj(i) = 0.001;
-                            }
-                        }
-                        W.block(m1 * n, m2 * n, n, n).diagonal() = PiPj;
-                    }
-                    else
-                    {
-                        W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-                        Eigen::VectorXd PiPj = Pi.col(m1).array() * Pi.col(m2).array();
-                        for (int i = 0; i < PiPj.size(); i++)
-                        {
-                            if (PiPj(i) < 0.001)
-                            {
-                                PiPj(i) = 0.001;
-                            }
-                        }
-                        W.block(m1 * n, m2 * n, n, n).diagonal() = -PiPj;
-                        W.block(m2 * n, m1 * n, n, n) = W.block(m1 * n, m2 * n, n, n);
-                    }
-                }
-            }
-
-            for (int m1 = 0; m1 < M; m1++)
-            {
-                for (int m2 = m1; m2 < M; m2++)
-                {
-                    XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) = X.transpose() * W.block(m1 * n, m2 * n, n, n);
-                    XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1)) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) * X;
-                    XTW.block(m2 * (p + 1), m1 * n, (p + 1), n) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n);
-                    XTWX.block(m2 * (p + 1), m1 * (p + 1), (p + 1), (p + 1)) = XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1));
-                }
-            }
-
-            for (int m1 = 0; m1 < M; m1++)
-            {
-                res.segment(m1 * n, n) = y.col(m1).eval() - Pi.col(m1).eval();
-            }
-
-            for (int m1 = 0; m1 < M; m1++)
-            {
-                Xbeta.segment(m1 * n, n) = X * beta0.col(m1).eval();
-            }
-
-            Z = Xbeta + W.ldlt().solve(res);
+            multinomial_irls(X, y, Pi, beta0, 0., XTWX, XTWz, no_center);
         }
     }
 
@@ -484,8 +393,6 @@ void logistic_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::Ve
 
     add_constant_column(X);
 
-    T4 X_new(X);
-
 #ifdef TEST
     clock_t t2 = clock();
     std::cout << "primary fit init time: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
@@ -517,12 +424,11 @@ void logistic_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::Ve
     Eigen::VectorXd beta1;
     for (j = 0; j < primary_model_fit_max_iter; j++)
     {
-        for (int i = 0; i < p + 1; i++)
-        {
-            X_new.col(i) = X.col(i).cwiseProduct(W).cwiseProduct(weights);
-        }
-
-        overload_ldlt(X_new, X, Z, beta0);
+        Eigen::VectorXd w = W.cwiseProduct(weights);
+        Eigen::MatrixXd XTX;
+        Eigen::VectorXd XTZ;
+        weighted_gram(X, w, Z, XTX, XTZ);
+        beta0 = XTX.ldlt().solve(XTZ);
 
         Pi = pi(X, y, beta0);
         log_Pi = Pi.array().log();
@@ -593,8 +499,6 @@ void poisson_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::Vec
     X.rightCols(p) = x;
     add_constant_column(X);
 
-    // Eigen::MatrixXd X_trans = X.transpose();
-    T4 X_new(n, p + 1);
     Eigen::VectorXd beta0 = Eigen::VectorXd::Zero(p + 1);
     beta0.tail(p) = beta;
     beta0(0) = coef0;
@@ -607,14 +511,12 @@ void poisson_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::Vec
     int j;
     for (j = 0; j < primary_model_fit_max_iter; j++)
     {
-        for (int i = 0; i < p + 1; i++)
-        {
-            // temp.col(i) = X_trans.col(i) * expeta(i) * weights(i);
-            X_new.col(i) = X.col(i).cwiseProduct(expeta).cwiseProduct(weights);
-        }
+        Eigen::VectorXd w = expeta.cwiseProduct(weights);
         z = eta + (y - expeta).cwiseQuotient(expeta);
-        Eigen::MatrixXd XTX = X_new.transpose() * X;
-        beta0 = (XTX).ldlt().solve(X_new.transpose() * z);
+        Eigen::MatrixXd XTX;
+        Eigen::VectorXd XTz;
+        weighted_gram(X, w, z, XTX, XTz);
+        beta0 = (XTX).ldlt().solve(XTz);
         eta = X * beta0;
         for (int i = 0; i <= n - 1; i++)
         {
@@ -647,8 +549,39 @@ void poisson_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::Vec
     coef0 = beta0(0);
 }
 
+// The tie blocks of sorted Cox samples. For each sample, next is 2 if the following sample
+// has the same time, 1 if it is later in the same stratum and 0 at the end of a stratum;
+// start holds the first sample of each stratum and n. Without keys there are no ties and
+// one stratum.
+void cox_blocks(Eigen::VectorXi &key, int n, Eigen::VectorXi &next, Eigen::VectorXi &start);
+
+// The order that sorts the samples by stratum and time, and the key of each sorted sample:
+// samples with the same stratum and time share a key, keys grow with the time within a
+// stratum and those of a later stratum are smaller than all of an earlier one.
+void cox_risk_sets(Eigen::VectorXd &time, Eigen::VectorXi &strata, Eigen::VectorXi &order, Eigen::VectorXi &key);
+
+// The Cox information in the linear predictor, with the samples sorted by time, is
+//   H = diag(d) - sum_k sum_l a_l(k) v_lk v_lk^T,  v_lk = u_k - f_l e_k,
+// where u_k(i) = eta(i) for the samples i at risk at the tie block k, e_k(i) = eta(i) for
+// its events and f_l = l / (number of events) under the Efron approximation (f_l = 0 for
+// Breslow). a keeps the sums of a_l, f_l a_l and f_l^2 a_l at the first sample of each block.
+struct CoxHessian
+{
+    Eigen::VectorXd eta;
+    Eigen::VectorXd d;
+    Eigen::MatrixXd a;
+    Eigen::VectorXd event;
+    Eigen::VectorXi next;
+    Eigen::VectorXi start;
+};
+
+void cox_scan(CoxHessian &h, Eigen::VectorXd &y, Eigen::VectorXd &weight, int begin, int end, bool efron);
+
+void cox_log_ratio(Eigen::VectorXd &eta, Eigen::VectorXd &expeta, Eigen::VectorXd &status, Eigen::VectorXi &next, int begin, int end, bool efron, Eigen::VectorXd &ratio);
+
+// ties: 0 for Breslow and 1 for Efron.
 template <class T4>
-double loglik_cox(T4 &X, Eigen::VectorXd &status, Eigen::VectorXd &beta, Eigen::VectorXd &weights)
+double loglik_cox(T4 &X, Eigen::VectorXd &status, Eigen::VectorXd &beta, Eigen::VectorXd &weights, Eigen::VectorXi &key, int ties = 0)
 {
     int n = X.rows();
     Eigen::VectorXd eta = X * beta;
@@ -664,18 +597,83 @@ double loglik_cox(T4 &X, Eigen::VectorXd &status, Eigen::VectorXd &beta, Eigen::
         }
     }
     Eigen::VectorXd expeta = eta.array().exp();
-    Eigen::VectorXd cum_expeta(n);
-    cum_expeta(n - 1) = expeta(n - 1);
-    for (int i = n - 2; i >= 0; i--)
+    Eigen::VectorXi next, start;
+    cox_blocks(key, n, next, start);
+    Eigen::VectorXd ratio(n);
+    int strata = start.size() - 1;
+#pragma omp parallel for if (strata > 1)
+    for (int s = 0; s < strata; s++)
     {
-        cum_expeta(i) = cum_expeta(i + 1) + expeta(i);
+        cox_log_ratio(eta, expeta, status, next, start(s), start(s + 1), ties == 1, ratio);
     }
-    Eigen::VectorXd ratio = (expeta.cwiseQuotient(cum_expeta)).array().log();
     return (ratio.cwiseProduct(status)).dot(weights);
 }
 
+// g is the gradient in the linear predictor.
 template <class T4>
-void cox_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd &beta, double &coef0, double loss0, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon, double tau, double lambda)
+void cox_derivatives(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd &beta, Eigen::VectorXi &key, int ties, CoxHessian &h, Eigen::VectorXd &g)
+{
+    int n = x.rows();
+    Eigen::VectorXd eta = x * beta;
+    for (int i = 0; i < n; i++)
+    {
+        if (eta(i) < -30.0)
+            eta(i) = -30.0;
+        if (eta(i) > 30.0)
+            eta(i) = 30.0;
+    }
+    bool efron = ties == 1;
+    h.eta = weight.array() * eta.array().exp();
+    cox_blocks(key, n, h.next, h.start);
+    h.d.resize(n);
+    h.a = Eigen::MatrixXd::Zero(n, efron ? 3 : 1);
+    h.event.resize(efron ? n : 0);
+    int strata = h.start.size() - 1;
+#pragma omp parallel for if (strata > 1)
+    for (int s = 0; s < strata; s++)
+    {
+        cox_scan(h, y, weight, h.start(s), h.start(s + 1), efron);
+    }
+    g = weight.cwiseProduct(y) - h.d;
+}
+
+// X^T H X for the h of cox_derivatives(), in O(n p^2): u_k^T X and e_k^T X are the suffix
+// sums of the rows of diag(eta) X within a stratum and of its events within a block.
+template <class T4>
+Eigen::MatrixXd cox_XTHX(T4 &X, CoxHessian &h)
+{
+    int n = X.rows();
+    Eigen::MatrixXd Z = h.eta.asDiagonal() * X;
+    for (int j = 0; j < Z.cols(); j++)
+    {
+        for (int i = n - 2; i >= 0; i--)
+        {
+            if (h.next(i) != 0)
+                Z(i, j) += Z(i + 1, j);
+        }
+    }
+    Eigen::MatrixXd XTHX = X.transpose() * (h.d.asDiagonal() * X);
+    XTHX.noalias() -= Z.transpose() * h.a.col(0).asDiagonal() * Z;
+    if (h.a.cols() == 3)
+    {
+        Eigen::MatrixXd Y = h.event.asDiagonal() * X;
+        for (int j = 0; j < Y.cols(); j++)
+        {
+            for (int i = n - 2; i >= 0; i--)
+            {
+                if (h.next(i) == 2)
+                    Y(i, j) += Y(i + 1, j);
+            }
+        }
+        Eigen::MatrixXd ZY = Z.transpose() * h.a.col(1).asDiagonal() * Y;
+        XTHX += ZY + ZY.transpose();
+        XTHX.noalias() -= Y.transpose() * h.a.col(2).asDiagonal() * Y;
+    }
+    return XTHX;
+}
+
+template <class T4>
+void cox_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXi &key, Eigen::VectorXd &beta, double &coef0, double loss0, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon, double tau, double lambda)
 {
 #ifdef TEST
     clock_t t1 = clock();
@@ -687,133 +685,40 @@ void cox_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd
     }
 
     // cout << "primary_fit-----------" << endl;
-    int n = x.rows();
     int p = x.cols();
-    Eigen::VectorXd theta(n);
-    Eigen::MatrixXd one = (Eigen::MatrixXd::Ones(n, n)).triangularView<Eigen::Upper>();
-    Eigen::MatrixXd x_theta(n, p);
-    Eigen::VectorXd xij_theta(n);
-    Eigen::VectorXd cum_theta(n);
-    Eigen::VectorXd g(p);
+    Eigen::VectorXd g;
     Eigen::VectorXd beta0 = beta, beta1;
-    Eigen::VectorXd cum_eta(n);
-    Eigen::VectorXd cum_eta2(n);
-    Eigen::VectorXd cum_eta3(n);
-    Eigen::MatrixXd h(p, p);
-    Eigen::VectorXd eta;
+    CoxHessian h;
 
     Eigen::VectorXd d(p);
-    double loglik1, loglik0 = loglik_cox(x, y, beta0, weight);
+    double loglik1, loglik0 = loglik_cox(x, y, beta0, weight, key);
     // beta = Eigen::VectorXd::Zero(p);
 
     double step = 1.0;
     int l;
     for (l = 1; l <= primary_model_fit_max_iter; l++)
     {
-
-        eta = x * beta0;
-        for (int i = 0; i <= n - 1; i++)
-        {
-            if (eta(i) < -30.0)
-                eta(i) = -30.0;
-            if (eta(i) > 30.0)
-                eta(i) = 30.0;
-        }
-        eta = weight.array() * eta.array().exp();
-        cum_eta(n - 1) = eta(n - 1);
-        for (int k = n - 2; k >= 0; k--)
-        {
-            cum_eta(k) = cum_eta(k + 1) + eta(k);
-        }
-        cum_eta2(0) = (y(0) * weight(0)) / cum_eta(0);
-        for (int k = 1; k <= n - 1; k++)
-        {
-            cum_eta2(k) = (y(k) * weight(k)) / cum_eta(k) + cum_eta2(k - 1);
-        }
-        cum_eta3(0) = (y(0) * weight(0)) / pow(cum_eta(0), 2);
-        for (int k = 1; k <= n - 1; k++)
-        {
-            cum_eta3(k) = (y(k) * weight(k)) / pow(cum_eta(k), 2) + cum_eta3(k - 1);
-        }
-        h = -cum_eta3.replicate(1, n);
-        h = h.cwiseProduct(eta.replicate(1, n));
-        h = h.cwiseProduct(eta.replicate(1, n).transpose());
-        for (int i = 0; i < n; i++)
-        {
-            for (int j = i + 1; j < n; j++)
-            {
-                h(j, i) = h(i, j);
-            }
-        }
-        h.diagonal() = cum_eta2.cwiseProduct(eta) + h.diagonal();
-        g = weight.cwiseProduct(y) - cum_eta2.cwiseProduct(eta);
+        cox_derivatives(x, y, weight, beta0, key, 0, h, g);
+        Eigen::MatrixXd XTHX = cox_XTHX(x, h);
 
         if (approximate_Newton)
         {
-            d = (x.transpose() * g).cwiseQuotient((x.transpose() * h * x).diagonal());
+            d = (x.transpose() * g).cwiseQuotient(XTHX.diagonal());
         }
         else
         {
-            d = (x.transpose() * h * x).ldlt().solve(x.transpose() * g);
-        }
-
-        // theta = x * beta0;
-        // for (int i = 0; i < n; i++)
-        // {
-        //   if (theta(i) > 30)
-        //     theta(i) = 30;
-        //   else if (theta(i) < -30)
-        //     theta(i) = -30;
-        // }
-        // theta = theta.array().exp();
-        // cum_theta = one * theta;
-        // x_theta = x.array().colwise() * theta.array();
-        // x_theta = one * x_theta;
-        // x_theta = x_theta.array().colwise() / cum_theta.array();
-        // g = (x - x_theta).transpose() * (weights.cwiseProduct(y));
-
-        // if (approximate_Newton)
-        // {
-        //   Eigen::VectorXd h(p);
-        //   for (int k1 = 0; k1 < p; k1++)
-        //   {
-        //     xij_theta = (theta.cwiseProduct(x.col(k1))).cwiseProduct(x.col(k1));
-        //     for (int j = n - 2; j >= 0; j--)
-        //     {
-        //       xij_theta(j) = xij_theta(j + 1) + xij_theta(j);
-        //     }
-        //     h(k1) = -(xij_theta.cwiseQuotient(cum_theta) - x_theta.col(k1).cwiseProduct(x_theta.col(k1))).dot(weights.cwiseProduct(y));
-        //   }
-        //   d = g.cwiseQuotient(h);
-        // }
-        // else
-        // {
-        //   Eigen::MatrixXd h(p, p);
-        //   for (int k1 = 0; k1 < p; k1++)
-        //   {
-        //     for (int k2 = k1; k2 < p; k2++)
-        //     {
-        //       xij_theta = (theta.cwiseProduct(x.col(k1))).cwiseProduct(x.col(k2));
-        //       for (int j = n - 2; j >= 0; j--)
-        //       {
-        //         xij_theta(j) = xij_theta(j + 1) + xij_theta(j);
-        //       }
-        //       h(k1, k2) = -(xij_theta.cwiseQuotient(cum_theta) - x_theta.col(k1).cwiseProduct(x_theta.col(k2))).dot(weights.cwiseProduct(y));
-        //       h(k2, k1) = h(k1, k2);
-        //     }
-        //   }
-        //   d = h.ldlt().solve(g);
-        // }
+            d = XTHX.ldlt().solve(x.transpose() * g);
+        }
 
         beta1 = beta0 + step * d;
 
-        loglik1 = loglik_cox(x, y, beta1, weight);
+        loglik1 = loglik_cox(x, y, beta1, weight, key);
 
         while (loglik1 < loglik0 && step > primary_model_fit_epsilon)
         {
             step = step / 2;
             beta1 = beta0 + step * d;
-            loglik1 = loglik_cox(x, y, beta1, weight);
+            loglik1 = loglik_cox(x, y, beta1, weight, key);
         }
 
         bool condition1 = -(loglik1 + (primary_model_fit_max_iter - l - 1) * (loglik1 - loglik0)) + tau > loss0;
@@ -868,4 +773,305 @@ double loglik_poiss(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &coef, int n, Eig
     return (y.cwiseProduct(eta) - expeta).dot(weights);
 }
 
+// The curvature pairs (s, y) of the last steps of an L-BFGS fit, as the columns of s and y. A coefficient vector
+// is a (q x M) matrix by column, whose row k is on the column col(k) of x, or on the intercept for col(k) = -1.
+struct LbfgsMemory
+{
+    Eigen::MatrixXd s;
+    Eigen::MatrixXd y;
+    Eigen::VectorXi col;
+};
+
+// Keeps the pairs of memory on the rows whose column is in col, with 0 on the others, and drops the pairs
+// with no positive curvature left. Both col and memory.col are increasing.
+void lbfgs_restrict(LbfgsMemory &memory, Eigen::VectorXi &col, int M);
+
+// The columns of x in a fit on the groups A: the intercept, -1, then those of each group.
+Eigen::VectorXi fit_columns(Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size);
+
+// The centering of the columns of X after the constant first one, in the objectives below
+struct CenteredColumns
+{
+    // center with 0 for the first column, empty if the columns are not centered
+    Eigen::VectorXd all;
+
+    CenteredColumns(Eigen::VectorXd &center)
+    {
+        if (center.size() != 0)
+        {
+            all.resize(center.size() + 1);
+            all << 0, center;
+        }
+    };
+
+    // X coef -> X_c coef
+    void eta(Eigen::VectorXd &eta, Eigen::VectorXd &coef)
+    {
+        if (all.size() != 0)
+            eta.array() -= all.dot(coef);
+    };
+
+    // h(j) = X.col(j)^2 . W -> the same for the centered columns
+    template <class T4>
+    void hessian_diagonal(T4 &X, Eigen::VectorXd &W, Eigen::VectorXd &h)
+    {
+        if (all.size() != 0)
+        {
+            Eigen::VectorXd XTW = X.transpose() * W;
+            h.array() += all.array().square() * W.sum() - 2 * all.array() * XTW.array();
+        }
+    };
+};
+
+// The objectives of the diagonal Newton and L-BFGS fits on X, whose first column is the constant one:
+// the negative log-likelihood plus lambda ||coef||^2 without the intercept row. f(coef, g, h) returns it,
+// and sets its gradient g and the diagonal h of its Hessian when they are not NULL.
+// The other columns of X are centered by center, see Data::x_center, unless it is empty.
+template <class T4>
+struct LogisticObjective
+{
+    T4 &X;
+    Eigen::VectorXd &y;
+    Eigen::VectorXd &weights;
+    double lambda;
+    CenteredColumns center;
+
+    LogisticObjective(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, double lambda, Eigen::VectorXd &center) : X(X), y(y), weights(weights), lambda(lambda), center(center){};
+
+    double operator()(Eigen::VectorXd &coef, Eigen::VectorXd *g, Eigen::VectorXd *h)
+    {
+        int n = X.rows();
+        Eigen::VectorXd eta = X * coef;
+        center.eta(eta, coef);
+        double f = lambda * coef.tail(coef.size() - 1).squaredNorm();
+        Eigen::VectorXd Pi(n);
+        for (int i = 0; i < n; i++)
+        {
+            f += weights(i) * (std::max(eta(i), 0.) + log1p(exp(-std::fabs(eta(i)))) - y(i) * eta(i));
+            Pi(i) = 1 / (1 + exp(-eta(i)));
+        }
+        if (g != NULL)
+        {
+            Eigen::VectorXd r = (Pi - y).cwiseProduct(weights);
+            *g = XTr(X, r, center.all);
+            g->tail(coef.size() - 1) += 2 * lambda * coef.tail(coef.size() - 1);
+        }
+        if (h != NULL)
+        {
+            Eigen::VectorXd W = Pi.cwiseProduct(Eigen::VectorXd::Ones(n) - Pi).cwiseMax(0.001).cwiseProduct(weights);
+            h->resize(coef.size());
+            for (int j = 0; j < coef.size(); j++)
+                (*h)(j) = X.col(j).cwiseAbs2().dot(W) + (j == 0 ? 0 : 2 * lambda);
+            center.hessian_diagonal(X, W, *h);
+        }
+        return f;
+    }
+};
+
+template <class T4>
+struct PoissonObjective
+{
+    T4 &X;
+    Eigen::VectorXd &y;
+    Eigen::VectorXd &weights;
+    double lambda;
+    CenteredColumns center;
+
+    PoissonObjective(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, double lambda, Eigen::VectorXd &center) : X(X), y(y), weights(weights), lambda(lambda), center(center){};
+
+    double operator()(Eigen::VectorXd &coef, Eigen::VectorXd *g, Eigen::VectorXd *h)
+    {
+        Eigen::VectorXd eta = X * coef;
+        center.eta(eta, coef);
+        eta = eta.cwiseMax(-30.0).cwiseMin(30.0);
+        Eigen::VectorXd expeta = eta.array().exp();
+        double f = (expeta - y.cwiseProduct(eta)).dot(weights) + lambda * coef.tail(coef.size() - 1).squaredNorm();
+        if (g != NULL)
+        {
+            Eigen::VectorXd r = (expeta - y).cwiseProduct(weights);
+            *g = XTr(X, r, center.all);
+            g->tail(coef.size() - 1) += 2 * lambda * coef.tail(coef.size() - 1);
+        }
+        if (h != NULL)
+        {
+            Eigen::VectorXd W = expeta.cwiseProduct(weights);
+            h->resize(coef.size());
+            for (int j = 0; j < coef.size(); j++)
+                (*h)(j) = X.col(j).cwiseAbs2().dot(W) + (j == 0 ? 0 : 2 * lambda);
+            center.hessian_diagonal(X, W, *h);
+        }
+        return f;
+    }
+};
+
+// coef is the (q x M) coefficient matrix by column
+template <class T4>
+struct MultinomialObjective
+{
+    T4 &X;
+    Eigen::MatrixXd &y;
+    Eigen::VectorXd &weights;
+    double lambda;
+    CenteredColumns center;
+
+    MultinomialObjective(T4 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, double lambda, Eigen::VectorXd &center) : X(X), y(y), weights(weights), lambda(lambda), center(center){};
+
+    double operator()(Eigen::VectorXd &coef, Eigen::VectorXd *g, Eigen::VectorXd *h)
+    {
+        int n = X.rows();
+        int q = X.cols();
+        int M = y.cols();
+        Eigen::Map<Eigen::MatrixXd> B(coef.data(), q, M);
+        Eigen::MatrixXd Pi = X * B;
+        if (center.all.size() != 0)
+            Pi.rowwise() -= (B.transpose() * center.all).transpose();
+        double f = lambda * B.bottomRows(q - 1).squaredNorm();
+        for (int i = 0; i < n; i++)
+        {
+            double eta_max = Pi.row(i).maxCoeff();
+            Pi.row(i) = (Pi.row(i).array() - eta_max).exp();
+            double sum = Pi.row(i).sum();
+            Pi.row(i) /= sum;
+            f -= weights(i) * (y.row(i).array() * Pi.row(i).array().log()).sum();
+        }
+        if (g != NULL)
+        {
+            Eigen::MatrixXd res = Pi - y;
+            array_product(res, weights, 1);
+            Eigen::MatrixXd G = XTr(X, res, center.all);
+            G.bottomRows(q - 1) += 2 * lambda * B.bottomRows(q - 1);
+            *g = Eigen::Map<Eigen::VectorXd>(G.data(), q * M);
+        }
+        if (h != NULL)
+        {
+            h->resize(q * M);
+            for (int m = 0; m < M; m++)
+            {
+                Eigen::VectorXd W = Pi.col(m).cwiseProduct(Eigen::VectorXd::Ones(n) - Pi.col(m)).cwiseMax(0.001).cwiseProduct(weights);
+                Eigen::VectorXd h_m(q);
+                for (int j = 0; j < q; j++)
+                    h_m(j) = X.col(j).cwiseAbs2().dot(W) + (j == 0 ? 0 : 2 * lambda);
+                center.hessian_diagonal(X, W, h_m);
+                h->segment(m * q, q) = h_m;
+            }
+        }
+        return f;
+    }
+};
+
+// The fit stops when the objective changes by less than epsilon relative to it, or when even keeping the
+// last decrease for the iterations left would not take it tau below loss0, as in the Newton fits.
+inline bool objective_stop(double f0, double f1, int iter, int max_iter, double epsilon, double loss0, double tau)
+{
+    bool hopeless = f1 - (max_iter - iter - 1) * (f0 - f1) + tau > loss0;
+    bool converged = std::fabs(f0 - f1) / (0.1 + std::fabs(f1)) < epsilon;
+    return hopeless || converged;
+}
+
+// Minimizes f from coef by Newton steps with the diagonal of the Hessian, halving a step until it decreases f.
+// Returns the number of iterations.
+template <class F>
+int diagonal_newton_fit(F &f, Eigen::VectorXd &coef, int max_iter, double epsilon, double loss0, double tau)
+{
+    Eigen::VectorXd g, h, coef1;
+    double f0 = f(coef, &g, &h), f1;
+    int j;
+    for (j = 0; j < max_iter; j++)
+    {
+        Eigen::VectorXd d = g.cwiseQuotient(h.cwiseMax(1e-12));
+        double step = 1.0;
+        coef1 = coef - d;
+        f1 = f(coef1, NULL, NULL);
+        while (!(f1 <= f0) && step > epsilon)
+        {
+            step /= 2;
+            coef1 = coef - step * d;
+            f1 = f(coef1, NULL, NULL);
+        }
+        if (!(f1 <= f0))
+            break;
+        coef.swap(coef1);
+        if (objective_stop(f0, f1, j, max_iter, epsilon, loss0, tau))
+        {
+            j++;
+            break;
+        }
+        f0 = f(coef, &g, &h);
+    }
+    return j;
+}
+
+// Minimizes f from coef by L-BFGS with at most m pairs, starting with those kept in memory, which it leaves with
+// the pairs of its last steps. The step is halved until it meets the Armijo condition. Returns the number of iterations.
+template <class F>
+int lbfgs_fit(F &f, Eigen::VectorXd &coef, LbfgsMemory &memory, int max_iter, double epsilon, double loss0, double tau, int m = 10)
+{
+    int dim = coef.size();
+    Eigen::VectorXd g, g1, coef1;
+    double f0 = f(coef, &g, NULL), f1;
+    int j;
+    for (j = 0; j < max_iter; j++)
+    {
+        // the two-loop recursion, from the oldest pair in column 0 to the newest
+        int k = memory.s.cols();
+        Eigen::VectorXd d = g, alpha(k), rho(k);
+        for (int i = k - 1; i >= 0; i--)
+        {
+            rho(i) = 1 / memory.y.col(i).dot(memory.s.col(i));
+            alpha(i) = rho(i) * memory.s.col(i).dot(d);
+            d -= alpha(i) * memory.y.col(i);
+        }
+        if (k > 0)
+            d *= memory.s.col(k - 1).dot(memory.y.col(k - 1)) / memory.y.col(k - 1).squaredNorm();
+        else
+            d /= std::max(g.norm(), 1.0);
+        for (int i = 0; i < k; i++)
+        {
+            double b = rho(i) * memory.y.col(i).dot(d);
+            d += (alpha(i) - b) * memory.s.col(i);
+        }
+
+        double slope = g.dot(d);
+        if (!(slope > 0))
+        {
+            d = g / std::max(g.norm(), 1.0);
+            slope = g.dot(d);
+        }
+        double step = 1.0;
+        coef1 = coef - d;
+        f1 = f(coef1, NULL, NULL);
+        while (!(f1 <= f0 - 1e-4 * step * slope) && step > epsilon)
+        {
+            step /= 2;
+            coef1 = coef - step * d;
+            f1 = f(coef1, NULL, NULL);
+        }
+        if (!(f1 <= f0))
+            break;
+        f(coef1, &g1, NULL);
+
+        Eigen::VectorXd s = coef1 - coef, y = g1 - g;
+        if (s.dot(y) > 1e-10 * s.norm() * y.norm())
+        {
+            int keep = std::min(k, m - 1);
+            memory.s.leftCols(keep) = memory.s.rightCols(keep).eval();
+            memory.y.leftCols(keep) = memory.y.rightCols(keep).eval();
+            memory.s.conservativeResize(dim, keep + 1);
+            memory.y.conservativeResize(dim, keep + 1);
+            memory.s.col(keep) = s;
+            memory.y.col(keep) = y;
+        }
+        coef.swap(coef1);
+        g.swap(g1);
+        bool stop = objective_stop(f0, f1, j, max_iter, epsilon, loss0, tau);
+        f0 = f1;
+        if (stop)
+        {
+            j++;
+            break;
+        }
+    }
+    return j;
+}
+
 #endif
\ No newline at end of file
@@ -14,115 +14,263 @@ using namespace Rcpp;
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include "normalize.h"
 
 using namespace std;
 
-void Normalize(Eigen::MatrixXd &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx)
+// Center (if asked) and scale each column in place, with its weighted mean and norm.
+// Each column is finished while it is still in cache, and the columns are split over threads.
+static void normalize_columns(Eigen::MatrixXd &X, Eigen::VectorXd &weights, bool center, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
 {
     int n = X.rows();
     int p = X.cols();
-    Eigen::VectorXd tmp(n);
+#pragma omp parallel for schedule(static)
     for (int i = 0; i < p; i++)
     {
-        meanx(i) = weights.dot(X.col(i)) / double(n);
+        Eigen::MatrixXd::ColXpr x = X.col(i);
+        if (center)
+        {
+            meanx(i) = weights.dot(x) / double(n);
+            x = x.array() - meanx(i);
+        }
+        normx(i) = sqrt(weights.dot(x.cwiseAbs2()));
+        x = sqrt(double(n)) * x / normx(i);
     }
+}
+
+void Normalize(Eigen::MatrixXd &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize(Eigen::MatrixXd &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize3(Eigen::MatrixXd &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+}
+
+void Normalize4(Eigen::MatrixXd &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx)
+{
+    Eigen::VectorXd meanx;
+    normalize_columns(X, weights, false, meanx, normx);
+}
+
+void Normalize_y(Eigen::VectorXd &y, Eigen::VectorXd &weights, double &meany)
+{
+    int n = y.rows();
     meany = (y.dot(weights)) / double(n);
-    for (int i = 0; i < p; i++)
-    {
-        X.col(i) = X.col(i).array() - meanx(i);
-    }
     y = y.array() - meany;
+}
 
-    for (int i = 0; i < p; i++)
-    {
-        tmp = X.col(i);
-        tmp = tmp.array().square();
-        normx(i) = sqrt(weights.dot(tmp));
-    }
-    for (int i = 0; i < p; i++)
+void Normalize_y(Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meany)
+{
+    int n = y.rows();
+    meany = y.transpose() * weights / double(n);
+    for (int i = 0; i < n; i++)
     {
-        X.col(i) = sqrt(double(n)) * X.col(i) / normx(i);
+        y.row(i) = y.row(i) - meany;
     }
 }
 
-void Normalize(Eigen::MatrixXd &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx)
+// The sparse columns are only scaled, to keep them sparse: meanx and normx are those of the
+// centered columns, and the centering is left to the callers (see Data::x_center).
+static void normalize_columns(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &weights, bool center, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
 {
-    // cout << "multigaussian normal" << endl;
     int n = X.rows();
     int p = X.cols();
-    Eigen::VectorXd tmp(n);
+    double weight_sum = weights.sum();
+#pragma omp parallel for schedule(static)
     for (int i = 0; i < p; i++)
     {
-        meanx(i) = weights.dot(X.col(i)) / double(n);
-    }
-    meany = y.transpose() * weights / double(n);
-    // cout << "meany: " << meany << endl;
-    for (int i = 0; i < p; i++)
-    {
-        X.col(i) = X.col(i).array() - meanx(i);
+        double wx = 0, wx2 = 0;
+        for (Eigen::SparseMatrix<double>::InnerIterator it(X, i); it; ++it)
+        {
+            wx += weights(it.row()) * it.value();
+            wx2 += weights(it.row()) * it.value() * it.value();
+        }
+        if (center)
+        {
+            meanx(i) = wx / double(n);
+            // sum of w * (x - mean)^2
+            wx2 = wx2 - 2 * meanx(i) * wx + meanx(i) * meanx(i) * weight_sum;
+        }
+        normx(i) = sqrt(wx2);
+        double scale = sqrt(double(n)) / normx(i);
+        for (Eigen::SparseMatrix<double>::InnerIterator it(X, i); it; ++it)
+        {
+            it.valueRef() *= scale;
+        }
     }
+}
 
-    for (int i = 0; i < n; i++)
-    {
-        y.row(i) = y.row(i) - meany;
-    }
-    // y = y.array() - meany;
+void Normalize(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
 
-    for (int i = 0; i < p; i++)
-    {
-        tmp = X.col(i);
-        tmp = tmp.array().square();
-        normx(i) = sqrt(weights.dot(tmp));
-    }
-    for (int i = 0; i < p; i++)
-    {
-        X.col(i) = sqrt(double(n)) * X.col(i) / normx(i);
-    }
+void Normalize(Eigen::SparseMatrix<double> &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
 }
 
-void Normalize3(Eigen::MatrixXd &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+void Normalize3(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+}
+
+void Normalize4(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx)
+{
+    Eigen::VectorXd meanx;
+    normalize_columns(X, weights, false, meanx, normx);
+}
+
+static void normalize_columns(Eigen::MatrixXf &X, Eigen::VectorXd &weights, bool center, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
 {
     int n = X.rows();
     int p = X.cols();
-    Eigen::VectorXd tmp(n);
-    for (int i = 0; i < p; i++)
-    {
-        meanx(i) = weights.dot(X.col(i)) / double(n);
-    }
-    for (int i = 0; i < p; i++)
-    {
-        X.col(i) = X.col(i).array() - meanx(i);
-    }
+#pragma omp parallel for schedule(static)
     for (int i = 0; i < p; i++)
     {
-        tmp = X.col(i);
-        tmp = tmp.array().square();
-        normx(i) = sqrt(weights.dot(tmp));
+        Eigen::VectorXd x = X.col(i).cast<double>();
+        if (center)
+        {
+            meanx(i) = weights.dot(x) / double(n);
+            x = x.array() - meanx(i);
+        }
+        normx(i) = sqrt(weights.dot(x.cwiseAbs2()));
+        X.col(i) = (sqrt(double(n)) * x / normx(i)).cast<float>();
     }
+}
+
+void Normalize(Eigen::MatrixXf &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize(Eigen::MatrixXf &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize3(Eigen::MatrixXf &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+}
+
+void Normalize4(Eigen::MatrixXf &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx)
+{
+    Eigen::VectorXd meanx;
+    normalize_columns(X, weights, false, meanx, normx);
+}
+
+// the weighted mean and norm of a column only depend on the weight of each code
+static void normalize_columns(GenotypeMatrix &X, Eigen::VectorXd &weights, bool center, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+{
+    int n = X.rows();
+    int p = X.cols();
+#pragma omp parallel for schedule(static)
     for (int i = 0; i < p; i++)
     {
-        X.col(i) = sqrt(double(n)) * X.col(i) / normx(i);
+        Eigen::Vector4d w;
+        X.code_sums(i, weights.data(), w.data());
+        Eigen::Matrix<double, 4, Eigen::Dynamic>::ColXpr v = X.values.col(i);
+        if (center)
+        {
+            meanx(i) = w.dot(v) / double(n);
+            v = v.array() - meanx(i);
+        }
+        normx(i) = sqrt(w.dot(v.cwiseAbs2()));
+        v = sqrt(double(n)) * v / normx(i);
     }
 }
 
-void Normalize4(Eigen::MatrixXd &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx)
+void Normalize(GenotypeMatrix &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize(GenotypeMatrix &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize3(GenotypeMatrix &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+}
+
+void Normalize4(GenotypeMatrix &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx)
+{
+    Eigen::VectorXd meanx;
+    normalize_columns(X, weights, false, meanx, normx);
+}
+
+// the columns are read once, in order; with unit weights the centered ones
+// take the statistics stored in the file instead
+static void normalize_columns(MappedDesign &X, Eigen::VectorXd &weights, bool center, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
 {
     int n = X.rows();
     int p = X.cols();
-    Eigen::VectorXd tmp(n);
-    for (int i = 0; i < p; i++)
+    if (!center || (weights.array() != 1).any() || !X.file_stats(meanx, normx))
     {
-        tmp = X.col(i);
-        tmp = tmp.array().square();
-        normx(i) = sqrt(weights.dot(tmp));
+        for (int start = 0; start < p; start += 256)
+        {
+            Eigen::MatrixXd x_block;
+            X.read_block(start, std::min(256, p - start), x_block);
+#pragma omp parallel for schedule(static)
+            for (int k = 0; k < x_block.cols(); k++)
+            {
+                int i = start + k;
+                if (center)
+                {
+                    meanx(i) = weights.dot(x_block.col(k)) / double(n);
+                    x_block.col(k) = x_block.col(k).array() - meanx(i);
+                }
+                normx(i) = sqrt(weights.dot(x_block.col(k).cwiseAbs2()));
+            }
+        }
     }
     for (int i = 0; i < p; i++)
     {
-        X.col(i) = sqrt(double(n)) * X.col(i) / normx(i);
+        double c = sqrt(double(n)) / normx(i);
+        if (center)
+            X.shift(i) -= meanx(i);
+        X.scale(i) *= c;
+        X.shift(i) *= c;
     }
 }
 
-void Normalize(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx) { return; }
-void Normalize(Eigen::SparseMatrix<double> &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx) { return; }
-void Normalize3(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &meanx, Eigen::VectorXd &normx) { return; }
-void Normalize4(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &normx) { return; }
\ No newline at end of file
+void Normalize(MappedDesign &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize(MappedDesign &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+    Normalize_y(y, weights, meany);
+}
+
+void Normalize3(MappedDesign &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx)
+{
+    normalize_columns(X, weights, true, meanx, normx);
+}
+
+void Normalize4(MappedDesign &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx)
+{
+    Eigen::VectorXd meanx;
+    normalize_columns(X, weights, false, meanx, normx);
+}
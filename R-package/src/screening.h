@@ -27,18 +27,41 @@ using namespace Rcpp;
 using namespace std;
 using namespace Eigen;
 
-template <class T4>
-Eigen::VectorXi screening(Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &data, int model_type, int screening_size, Eigen::VectorXi &always_select, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+// the coefficients of a fit on the columns x_tmp alone
+template <class T5>
+Eigen::VectorXd marginal_beta(T5 &x_tmp, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXi &status, int model_type, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
 {
-    // int n = data.x.rows();
-    int p = data.x.cols();
-    int M = data.y.cols();
-    Eigen::VectorXi screening_A(screening_size);
-
-    int g_num = data.g_num;
-    Eigen::VectorXi g_size = data.g_size;
-    Eigen::VectorXi g_index = data.g_index;
+    Eigen::VectorXd beta;
+    double coef0;
+    coef_set_zero(x_tmp.cols(), y.cols(), beta, coef0);
+    // if (model_type == 2)
+    // {
+    //     logistic_fit(x_tmp, y, weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    // }
+    if (model_type == 1)
+    {
+        lm_fit(x_tmp, y, weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    }
+    else if (model_type == 2)
+    {
+        logistic_fit(x_tmp, y, weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    }
+    else if (model_type == 3)
+    {
+        poisson_fit(x_tmp, y, weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    }
+    else if (model_type == 4)
+    {
+        cox_fit(x_tmp, y, weight, status, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    }
+    return beta;
+}
 
+// fit each group alone and measure its coefficients, x_center as in Data
+template <class T4>
+Eigen::VectorXd marginal_coef_norm(T4 &x, Eigen::VectorXd &x_center, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXi &status, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int model_type, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+{
+    int g_num = g_index.size();
     Eigen::VectorXd coef_norm = Eigen::VectorXd::Zero(g_num);
 
     for (int i = 0; i < g_num; i++)
@@ -47,29 +70,18 @@ Eigen::VectorXi screening(Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &da
         cout << "i = " << i;
         cout << "g_index(i)" << g_index(i) << " g_size(i): " << g_size(i) << endl;
 #endif
-        T4 x_tmp = data.x.middleCols(g_index(i), g_size(i));
+        typename ActiveDesign<T4>::type x_tmp = X_cols(x, g_index(i), g_size(i));
         Eigen::VectorXd beta;
-        double coef0;
-        coef_set_zero(g_size(i), M, beta, coef0);
-        // if (model_type == 2)
-        // {
-        //     logistic_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
-        // }
-        if (model_type == 1)
-        {
-            lm_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
-        }
-        else if (model_type == 2)
-        {
-            logistic_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
-        }
-        else if (model_type == 3)
+        if (x_center.size() != 0)
         {
-            poisson_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+            // the centered columns are dense, and are fitted as such
+            Eigen::MatrixXd x_dense = x_tmp;
+            x_dense.rowwise() -= x_center.segment(g_index(i), g_size(i)).transpose();
+            beta = marginal_beta(x_dense, y, weight, status, model_type, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
         }
-        else if (model_type == 4)
+        else
         {
-            cox_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+            beta = marginal_beta(x_tmp, y, weight, status, model_type, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
         }
         coef_norm(i) = beta.squaredNorm() / g_size(i);
 #ifdef TEST
@@ -77,6 +89,21 @@ Eigen::VectorXi screening(Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &da
         cout << "coef_norm(i): " << coef_norm(i) << endl;
 #endif
     }
+    return coef_norm;
+}
+
+template <class T4>
+Eigen::VectorXi screening(Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &data, Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &screened_data, int model_type, int screening_size, Eigen::VectorXi &always_select, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+{
+    // int n = data.x.rows();
+    int p = data.x.cols();
+    Eigen::VectorXi screening_A(screening_size);
+
+    int g_num = data.g_num;
+    Eigen::VectorXi g_size = data.g_size;
+    Eigen::VectorXi g_index = data.g_index;
+
+    Eigen::VectorXd coef_norm = marginal_coef_norm(data.x, data.x_center, data.y, data.weight, data.status, g_index, g_size, model_type, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
 #ifdef TEST
     cout << "x_tmp" << data.x.middleCols(0, 1) << endl;
     cout << "data.y" << data.y << endl;
@@ -119,14 +146,16 @@ Eigen::VectorXi screening(Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &da
     Eigen::VectorXd new_x_mean, new_x_norm;
     slice(data.x_mean, screening_A_ind, new_x_mean);
     slice(data.x_norm, screening_A_ind, new_x_norm);
+    if (data.x_center.size() != 0)
+        slice(data.x_center, screening_A_ind, screened_data.x_center);
 
-    data.x = x_A;
-    data.x_mean = new_x_mean;
-    data.x_norm = new_x_norm;
-    data.p = new_p;
-    data.g_num = screening_size;
-    data.g_index = new_g_index;
-    data.g_size = new_g_size;
+    screened_data.x = x_A;
+    screened_data.x_mean = new_x_mean;
+    screened_data.x_norm = new_x_norm;
+    screened_data.p = new_p;
+    screened_data.g_num = screening_size;
+    screened_data.g_index = new_g_index;
+    screened_data.g_size = new_g_size;
 
     if (always_select.size() != 0)
     {
@@ -144,36 +173,60 @@ Eigen::VectorXi screening(Data<Eigen::VectorXd, Eigen::VectorXd, double, T4> &da
     return screening_A_ind;
 }
 
-template <class T4>
-Eigen::VectorXi screening(Data<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4> &data, int model_type, int screening_size, Eigen::VectorXi &always_select, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+template <class T5>
+Eigen::MatrixXd marginal_beta(T5 &x_tmp, Eigen::MatrixXd &y, Eigen::VectorXd &weight, int model_type, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
 {
-    // int n = data.x.rows();
-    int p = data.x.cols();
-    int M = data.y.cols();
-    Eigen::VectorXi screening_A(screening_size);
-
-    int g_num = data.g_num;
-    Eigen::VectorXi g_size = data.g_size;
-    Eigen::VectorXi g_index = data.g_index;
+    Eigen::MatrixXd beta;
+    Eigen::VectorXd coef0;
+    coef_set_zero(x_tmp.cols(), y.cols(), beta, coef0);
+    if (model_type == 5)
+    {
+        multigaussian_fit(x_tmp, y, weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    }
+    else if (model_type == 6)
+    {
+        multinomial_fit(x_tmp, y, weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+    }
+    return beta;
+}
 
+template <class T4>
+Eigen::VectorXd marginal_coef_norm(T4 &x, Eigen::VectorXd &x_center, Eigen::MatrixXd &y, Eigen::VectorXd &weight, Eigen::VectorXi &status, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int model_type, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+{
+    int g_num = g_index.size();
     Eigen::VectorXd coef_norm = Eigen::VectorXd::Zero(g_num);
 
     for (int i = 0; i < g_num; i++)
     {
-        T4 x_tmp = data.x.middleCols(g_index(i), g_size(i));
+        typename ActiveDesign<T4>::type x_tmp = X_cols(x, g_index(i), g_size(i));
         Eigen::MatrixXd beta;
-        Eigen::VectorXd coef0;
-        coef_set_zero(g_size(i), M, beta, coef0);
-        if (model_type == 5)
+        if (x_center.size() != 0)
         {
-            multigaussian_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+            Eigen::MatrixXd x_dense = x_tmp;
+            x_dense.rowwise() -= x_center.segment(g_index(i), g_size(i)).transpose();
+            beta = marginal_beta(x_dense, y, weight, model_type, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
         }
-        else if (model_type == 6)
+        else
         {
-            multinomial_fit(x_tmp, data.y, data.weight, beta, coef0, DBL_MAX, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon, 0., 0.);
+            beta = marginal_beta(x_tmp, y, weight, model_type, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
         }
         coef_norm(i) = beta.squaredNorm() / g_size(i);
     }
+    return coef_norm;
+}
+
+template <class T4>
+Eigen::VectorXi screening(Data<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4> &data, Data<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4> &screened_data, int model_type, int screening_size, Eigen::VectorXi &always_select, bool approximate_Newton, int primary_model_fit_max_iter, double primary_model_fit_epsilon)
+{
+    // int n = data.x.rows();
+    int p = data.x.cols();
+    Eigen::VectorXi screening_A(screening_size);
+
+    int g_num = data.g_num;
+    Eigen::VectorXi g_size = data.g_size;
+    Eigen::VectorXi g_index = data.g_index;
+
+    Eigen::VectorXd coef_norm = marginal_coef_norm(data.x, data.x_center, data.y, data.weight, data.status, g_index, g_size, model_type, approximate_Newton, primary_model_fit_max_iter, primary_model_fit_epsilon);
 
     // keep always_select in active_set
     slice_assignment(coef_norm, always_select, DBL_MAX);
@@ -203,14 +256,16 @@ Eigen::VectorXi screening(Data<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd
     Eigen::VectorXd new_x_mean, new_x_norm;
     slice(data.x_mean, screening_A_ind, new_x_mean);
     slice(data.x_norm, screening_A_ind, new_x_norm);
-
-    data.x = x_A;
-    data.x_mean = new_x_mean;
-    data.x_norm = new_x_norm;
-    data.p = new_p;
-    data.g_num = screening_size;
-    data.g_index = new_g_index;
-    data.g_size = new_g_size;
+    if (data.x_center.size() != 0)
+        slice(data.x_center, screening_A_ind, screened_data.x_center);
+
+    screened_data.x = x_A;
+    screened_data.x_mean = new_x_mean;
+    screened_data.x_norm = new_x_norm;
+    screened_data.p = new_p;
+    screened_data.g_num = screening_size;
+    screened_data.g_index = new_g_index;
+    screened_data.g_size = new_g_size;
 
     return screening_A_ind;
 }
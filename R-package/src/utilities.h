@@ -16,6 +16,8 @@
 
 #include <iostream>
 #include <vector>
+#include "GenotypeMatrix.h"
+#include "MappedDesign.h"
 using namespace std;
 using namespace Eigen;
 
@@ -42,6 +44,32 @@ struct FIT_ARG
     FIT_ARG(){};
 };
 
+// The type the active columns of a design T4 are gathered into. A float design
+// halves the memory of X, its active columns are fitted in double.
+template <class T4>
+struct ActiveDesign
+{
+    typedef T4 type;
+};
+
+template <>
+struct ActiveDesign<Eigen::MatrixXf>
+{
+    typedef Eigen::MatrixXd type;
+};
+
+template <>
+struct ActiveDesign<GenotypeMatrix>
+{
+    typedef Eigen::MatrixXd type;
+};
+
+template <>
+struct ActiveDesign<MappedDesign>
+{
+    typedef Eigen::MatrixXd type;
+};
+
 Eigen::MatrixXd Pointer2MatrixXd(double *x, int x_row, int x_col);
 // Eigen::MatrixXi Pointer2MatrixXi(int *x, int x_row, int x_col);
 Eigen::VectorXd Pointer2VectorXd(double *x, int x_len);
@@ -50,22 +78,95 @@ void MatrixXd2Pointer(Eigen::MatrixXd x_matrix, double *x);
 // void MatrixXi2Pointer(Eigen::MatrixXi x_matrix, int *x);
 void VectorXd2Pointer(Eigen::VectorXd x_vector, double *x);
 // void VectorXi2Pointer(Eigen::VectorXi x_vector, int *x);
+void sparse_to_csc(int n, int p, int nnz, double *val, int *idx, int *ptr, int sparse_format, Eigen::VectorXi &outer, Eigen::VectorXi &inner, Eigen::VectorXd &value);
 
 Eigen::VectorXi find_ind(Eigen::VectorXi &L, Eigen::VectorXi &index, Eigen::VectorXi &gsize, int p, int N);
 
+// x = src with its rows taken in row_order if it is not empty, in the storage of x
+template <class T4, class T5>
+void copy_design(T4 &x, T5 &src, Eigen::VectorXi &row_order)
+{
+    if (row_order.size() == 0)
+    {
+        x = src.template cast<typename T4::Scalar>();
+        return;
+    }
+    x.resize(src.rows(), src.cols());
+    for (int j = 0; j < src.cols(); j++)
+    {
+        for (int i = 0; i < src.rows(); i++)
+        {
+            x(i, j) = src(row_order(i), j);
+        }
+    }
+};
+
+template <class T5>
+void copy_design(Eigen::SparseMatrix<double> &x, T5 &src, Eigen::VectorXi &row_order)
+{
+    if (row_order.size() == 0)
+    {
+        x = src;
+        return;
+    }
+    // row i of order^T * src is row row_order(i) of src
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> order(row_order);
+    x = order.transpose() * src;
+};
+
+inline void copy_design(GenotypeMatrix &x, GenotypeMatrix &src, Eigen::VectorXi &row_order)
+{
+    if (row_order.size() == 0)
+        x = src;
+    else
+        src.slice(row_order, x, 0);
+};
+
+// the file is shared, only the indices of the rows are copied
+inline void copy_design(MappedDesign &x, MappedDesign &src, Eigen::VectorXi &row_order)
+{
+    if (row_order.size() == 0)
+        x = src;
+    else
+        src.slice(row_order, x, 0);
+};
+
+// the columns [start, start + size) of X
 template <class T4>
-T4 X_seg(T4 &X, int n, Eigen::VectorXi &ind)
+typename ActiveDesign<T4>::type X_cols(T4 &X, int start, int size)
+{
+    return X.middleCols(start, size).template cast<double>();
+};
+
+Eigen::MatrixXd X_cols(GenotypeMatrix &X, int start, int size);
+Eigen::MatrixXd X_cols(MappedDesign &X, int start, int size);
+
+// the same, into X_new
+template <class T4>
+void X_cols(T4 &X, int start, int size, typename ActiveDesign<T4>::type &X_new)
+{
+    X_new = X.middleCols(start, size).template cast<double>();
+};
+
+void X_cols(GenotypeMatrix &X, int start, int size, Eigen::MatrixXd &X_new);
+void X_cols(MappedDesign &X, int start, int size, Eigen::MatrixXd &X_new);
+
+Eigen::MatrixXd X_seg(GenotypeMatrix &X, int n, Eigen::VectorXi &ind);
+Eigen::MatrixXd X_seg(MappedDesign &X, int n, Eigen::VectorXi &ind);
+
+template <class T4>
+typename ActiveDesign<T4>::type X_seg(T4 &X, int n, Eigen::VectorXi &ind)
 {
     if (ind.size() == X.cols())
     {
-        return X;
+        return X.template cast<double>();
     }
     else
     {
-        T4 X_new(n, ind.size());
+        typename ActiveDesign<T4>::type X_new(n, ind.size());
         for (int k = 0; k < ind.size(); k++)
         {
-            X_new.col(k) = X.col(ind(k));
+            X_new.col(k) = X.col(ind(k)).template cast<double>();
         }
         return X_new;
     }
@@ -88,23 +189,9 @@ void X_seg(T4 &X, int n, Eigen::VectorXi &ind, T4 &X_seg)
     }
 };
 
-template <class T4>
-Eigen::Matrix<T4, -1, -1> group_XTX(T4 &X, Eigen::VectorXi index, Eigen::VectorXi gsize, int n, int p, int N, int model_type)
-{
-    Eigen::Matrix<T4, -1, -1> XTX(N, 1);
-    if (model_type == 1 || model_type == 5)
-    {
-        for (int i = 0; i < N; i++)
-        {
-            T4 X_ind = X.block(0, index(i), n, gsize(i));
-            XTX(i, 0) = X_ind.transpose() * X_ind;
-        }
-    }
-    return XTX;
-}
 
-template <class T4>
-Eigen::Matrix<Eigen::MatrixXd, -1, -1> Phi(T4 &X, Eigen::VectorXi index, Eigen::VectorXi gsize, int n, int p, int N, double lambda, Eigen::Matrix<T4, -1, -1> group_XTX)
+template <class T4, class T5>
+Eigen::Matrix<Eigen::MatrixXd, -1, -1> Phi(T4 &X, Eigen::VectorXi index, Eigen::VectorXi gsize, int n, int p, int N, double lambda, Eigen::Matrix<T5, -1, -1> group_XTX)
 {
     Eigen::Matrix<Eigen::MatrixXd, -1, -1> phi(N, 1);
     for (int i = 0; i < N; i++)
@@ -133,14 +220,71 @@ Eigen::VectorXi max_k(Eigen::VectorXd &nums, int k, bool sort_by_value = false);
 
 Eigen::VectorXi max_k_2(Eigen::VectorXd &vec, int k);
 
+// The same, with order as the workspace of the selection instead of a new p-vector.
+Eigen::VectorXi min_k(Eigen::VectorXd &vec, int k, bool sort_by_value, Eigen::VectorXi &order);
+Eigen::VectorXi max_k(Eigen::VectorXd &vec, int k, bool sort_by_value, Eigen::VectorXi &order);
+
+// A sorted subset A of {0, ..., N - 1} and its sorted complement I, with a bitset of A.
+// exchange() gives (A \ B) U C by merging, and update() keeps I along with A from the entries
+// that changed, instead of searching A or going through all of {0, ..., N - 1}.
+class IndexSet
+{
+public:
+    Eigen::VectorXi A;
+    Eigen::VectorXi I;
+
+    void assign(const Eigen::VectorXi &A, int N);
+
+    bool contains(int i) const { return this->bits[i]; };
+
+    // (A \ B) U C, sorted, for B in A and C in I
+    Eigen::VectorXi exchange(const Eigen::VectorXi &B, const Eigen::VectorXi &C) const;
+
+    // A = A_new, with I along with it
+    void update(const Eigen::VectorXi &A_new);
+
+    uint64_t hash() const;
+
+private:
+    int N = 0;
+    std::vector<bool> bits;
+    Eigen::VectorXi I_new;
+};
+
+// The active sets met by a fit, to tell when it goes back to one: only those with the same hash are compared.
+class IndexSetHistory
+{
+public:
+    void clear();
+
+    // whether A was met before, then A is kept
+    bool seen(const IndexSet &A);
+
+private:
+    std::vector<uint64_t> hashes;
+    std::vector<Eigen::VectorXi> sets;
+};
+
 // to do
 void slice(Eigen::VectorXd &nums, Eigen::VectorXi &ind, Eigen::VectorXd &A, int axis = 0);
 void slice(Eigen::MatrixXd &nums, Eigen::VectorXi &ind, Eigen::MatrixXd &A, int axis = 0);
+void slice(Eigen::MatrixXf &nums, Eigen::VectorXi &ind, Eigen::MatrixXf &A, int axis = 0);
 void slice(Eigen::SparseMatrix<double> &nums, Eigen::VectorXi &ind, Eigen::SparseMatrix<double> &A, int axis = 0);
+void slice(GenotypeMatrix &nums, Eigen::VectorXi &ind, GenotypeMatrix &A, int axis = 0);
+void slice(MappedDesign &nums, Eigen::VectorXi &ind, MappedDesign &A, int axis = 0);
 
 void slice_restore(Eigen::VectorXd &A, Eigen::VectorXi &ind, Eigen::VectorXd &nums, int axis = 0);
 void slice_restore(Eigen::MatrixXd &A, Eigen::VectorXi &ind, Eigen::MatrixXd &nums, int axis = 0);
 
+// The same for nums that is zero outside the entries (rows) in support: only those are cleared,
+// so that it takes O(|support| + |ind|) instead of the length of nums.
+void slice_restore(Eigen::VectorXd &A, Eigen::VectorXi &ind, Eigen::VectorXd &nums, Eigen::VectorXi &support);
+void slice_restore(Eigen::MatrixXd &A, Eigen::VectorXi &ind, Eigen::MatrixXd &nums, Eigen::VectorXi &support);
+
+// the entries (rows) of nums that are not zero
+Eigen::VectorXi nonzero_ind(Eigen::VectorXd &nums);
+Eigen::VectorXi nonzero_ind(Eigen::MatrixXd &nums);
+
 void coef_set_zero(int p, int M, Eigen::VectorXd &beta, double &coef0);
 void coef_set_zero(int p, int M, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0);
 
@@ -156,6 +300,9 @@ Eigen::VectorXd matrix_dot(Eigen::MatrixXd &A, Eigen::VectorXd &B);
 void matrix_sqrt(Eigen::MatrixXd &A, Eigen::MatrixXd &B);
 void matrix_sqrt(Eigen::SparseMatrix<double> &A, Eigen::MatrixXd &B);
 
+// B = A^(1/2) and C = B^-1 for a symmetric positive semi-definite A, without the Schur decomposition for a 1 x 1 A
+void matrix_sqrt_inverse(Eigen::MatrixXd &A, Eigen::MatrixXd &B, Eigen::MatrixXd &C);
+
 void add_constant_column(Eigen::MatrixXd &X);
 void add_constant_column(Eigen::SparseMatrix<double> &X);
 
@@ -167,4 +314,188 @@ void overload_ldlt(Eigen::MatrixXd &X_new, Eigen::MatrixXd &X, Eigen::VectorXd &
 
 void overload_ldlt(Eigen::SparseMatrix<double> &X_new, Eigen::SparseMatrix<double> &X, Eigen::MatrixXd &Z, Eigen::MatrixXd &beta);
 void overload_ldlt(Eigen::MatrixXd &X_new, Eigen::MatrixXd &X, Eigen::MatrixXd &Z, Eigen::MatrixXd &beta);
+
+// XTWX = X^T diag(w) X and, if z has a row of X each, XTWz = X^T diag(w) z, without forming diag(w) X.
+// A dense X is read once in row blocks, each a symmetric rank update of a partial Gram; the partial
+// Grams of a fixed split of the rows are computed in parallel and summed in order, so the result does not
+// depend on the number of threads.
+// A sparse X keeps the sparse product.
+void weighted_gram(Eigen::MatrixXd &X, Eigen::VectorXd &w, Eigen::VectorXd &z, Eigen::MatrixXd &XTWX, Eigen::VectorXd &XTWz);
+void weighted_gram(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &w, Eigen::VectorXd &z, Eigen::MatrixXd &XTWX, Eigen::VectorXd &XTWz);
+// A sparse x is kept uncentered (see Data::x_center), and so are its columns gathered by X_seg().
+// These work on the centered columns x - 1 * center^T without forming them, an empty center leaves x as it is.
+
+// center^T beta, by which X beta is lowered on the centered columns, so that
+// X_c beta + coef0 = X beta + coef0 - center_shift(center, beta)
+double center_shift(Eigen::VectorXd &center, Eigen::VectorXd &beta);
+Eigen::VectorXd center_shift(Eigen::VectorXd &center, Eigen::MatrixXd &beta);
+
+// L is the lower Cholesky factor of a matrix G = L L^T.
+// cholesky_delete() makes it the factor of G without row and column j,
+// cholesky_append() the factor of [G g; g^T g_mm] for g = col.head(m), g_mm = col(m),
+// and returns false, leaving L as it is, if that is not positive definite.
+void cholesky_delete(Eigen::MatrixXd &L, int j);
+bool cholesky_append(Eigen::MatrixXd &L, const Eigen::VectorXd &col);
+
+// XTHX = x^T diag(h) x -> the same for the centered columns, given XTh = x^T h
+void center_XTHX(Eigen::MatrixXd &XTHX, Eigen::VectorXd &XTh, double h_sum, Eigen::VectorXd &center);
+// XTHZ = x^T diag(h) z -> the same for the centered columns of x and z, given XTh = x^T h and ZTh = z^T h
+void center_XTHZ(Eigen::MatrixXd &XTHZ, Eigen::VectorXd &XTh, Eigen::VectorXd &ZTh, double h_sum, Eigen::VectorXd &x_center, Eigen::VectorXd &z_center);
+
+// The rows of X a fit uses are given by rows, all of them if it is empty: a fold of the cross validation
+// is fitted on the full design through its train rows, see Algorithm::train_mask.
+
+// the rows in rows of the columns in ind
+template <class T4>
+typename ActiveDesign<T4>::type X_seg(T4 &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind)
+{
+    if (rows.size() == 0)
+        return X_seg(X, X.rows(), ind);
+    typename ActiveDesign<T4>::type X_new(rows.size(), ind.size());
+    for (int k = 0; k < ind.size(); k++)
+    {
+        for (int i = 0; i < rows.size(); i++)
+        {
+            X_new(i, k) = X(rows(i), ind(k));
+        }
+    }
+    return X_new;
+};
+
+Eigen::SparseMatrix<double> X_seg(Eigen::SparseMatrix<double> &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind);
+Eigen::MatrixXd X_seg(GenotypeMatrix &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind);
+Eigen::MatrixXd X_seg(MappedDesign &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind);
+
+// the columns [start, start + size) of the rows in rows, into X_new
+template <class T4>
+void X_cols(T4 &X, Eigen::VectorXi &rows, int start, int size, typename ActiveDesign<T4>::type &X_new)
+{
+    if (rows.size() == 0)
+    {
+        X_cols(X, start, size, X_new);
+        return;
+    }
+    Eigen::VectorXi ind = Eigen::VectorXi::LinSpaced(size, start, start + size - 1);
+    X_new = X_seg(X, rows, ind);
+};
+
+// X_new.col(j) is X_A.col(from(j)), or the next column of X_read where from(j) < 0; X_new may be X_A
+void move_columns(Eigen::MatrixXd &X_A, Eigen::VectorXi &from, Eigen::MatrixXd &X_read, Eigen::MatrixXd &X_new);
+void move_columns(Eigen::SparseMatrix<double> &X_A, Eigen::VectorXi &from, Eigen::SparseMatrix<double> &X_read, Eigen::SparseMatrix<double> &X_new);
+
+// X_new = X_seg(X, rows, new_ind), given X_A = X_seg(X, rows, A_ind): the columns in both are
+// taken from X_A, and only the others are read from X. A_ind and new_ind are sorted, X_new may be X_A.
+template <class T4>
+void X_seg_update(T4 &X, Eigen::VectorXi &rows, Eigen::VectorXi &new_ind, Eigen::VectorXi &A_ind, typename ActiveDesign<T4>::type &X_A, typename ActiveDesign<T4>::type &X_new)
+{
+    Eigen::VectorXi from = Eigen::VectorXi::Constant(new_ind.size(), -1);
+    int read_num = 0;
+    for (int i = 0, j = 0; j < new_ind.size(); j++)
+    {
+        while (i < A_ind.size() && A_ind(i) < new_ind(j))
+            i++;
+        if (i < A_ind.size() && A_ind(i) == new_ind(j))
+            from(j) = i;
+        else
+            read_num++;
+    }
+    Eigen::VectorXi read_ind(read_num);
+    for (int j = 0, r = 0; j < new_ind.size(); j++)
+    {
+        if (from(j) < 0)
+            read_ind(r++) = new_ind(j);
+    }
+    typename ActiveDesign<T4>::type X_read = X_seg(X, rows, read_ind);
+    move_columns(X_A, from, X_read, X_new);
+};
+
+template <class T4>
+Eigen::VectorXd XTr(T4 &X, const Eigen::VectorXd &r, Eigen::VectorXd &center)
+{
+    Eigen::VectorXd result = X.transpose() * r;
+    if (center.size() != 0)
+        result -= r.sum() * center;
+    return result;
+};
+
+template <class T4>
+Eigen::MatrixXd XTr(T4 &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center)
+{
+    Eigen::MatrixXd result = X.transpose() * r;
+    if (center.size() != 0)
+        result -= center * r.colwise().sum();
+    return result;
+};
+
+// a float X is multiplied in double, as for X^T r
+Eigen::VectorXd XTr(Eigen::MatrixXf &X, const Eigen::VectorXd &r, Eigen::VectorXd &center);
+Eigen::MatrixXd XTr(Eigen::MatrixXf &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center);
+
+// the genotypes are unpacked and multiplied in one pass, center is empty for them
+Eigen::VectorXd XTr(GenotypeMatrix &X, const Eigen::VectorXd &r, Eigen::VectorXd &center);
+Eigen::MatrixXd XTr(GenotypeMatrix &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center);
+
+// the columns on disk are read once, in order, see MappedDesign::read_block(); center is empty for them
+Eigen::VectorXd XTr(MappedDesign &X, const Eigen::VectorXd &r, Eigen::VectorXd &center);
+Eigen::MatrixXd XTr(MappedDesign &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center);
+
+// X^T r for the r of the rows in rows, which is zero on the others
+template <class T4>
+Eigen::VectorXd XTr(T4 &X, Eigen::VectorXi &rows, const Eigen::VectorXd &r, Eigen::VectorXd &center)
+{
+    if (rows.size() == 0)
+        return XTr(X, r, center);
+    Eigen::VectorXd r_full = Eigen::VectorXd::Zero(X.rows());
+    for (int i = 0; i < rows.size(); i++)
+    {
+        r_full(rows(i)) = r(i);
+    }
+    return XTr(X, r_full, center);
+};
+
+template <class T4>
+Eigen::MatrixXd XTr(T4 &X, Eigen::VectorXi &rows, const Eigen::MatrixXd &r, Eigen::VectorXd &center)
+{
+    if (rows.size() == 0)
+        return XTr(X, r, center);
+    Eigen::MatrixXd r_full = Eigen::MatrixXd::Zero(X.rows(), r.cols());
+    for (int i = 0; i < rows.size(); i++)
+    {
+        r_full.row(rows(i)) = r.row(i);
+    }
+    return XTr(X, r_full, center);
+};
+
+template <class T4>
+Eigen::MatrixXd XTX_full(T4 &X)
+{
+    return (X.transpose() * X).template cast<double>();
+};
+
+Eigen::MatrixXd XTX_full(GenotypeMatrix &X);
+Eigen::MatrixXd XTX_full(MappedDesign &X);
+
+// the Gram matrices of the centered columns of each group, on the n rows in rows
+template <class T4>
+Eigen::Matrix<Eigen::MatrixXd, -1, -1> group_XTX(T4 &X, Eigen::VectorXi &rows, Eigen::VectorXi index, Eigen::VectorXi gsize, int n, int p, int N, int model_type, Eigen::VectorXd &center)
+{
+    Eigen::Matrix<Eigen::MatrixXd, -1, -1> XTX(N, 1);
+    if (model_type == 1 || model_type == 5)
+    {
+        Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
+        typename ActiveDesign<T4>::type X_ind;
+        for (int i = 0; i < N; i++)
+        {
+            X_cols(X, rows, index(i), gsize(i), X_ind);
+            XTX(i, 0) = X_ind.transpose() * X_ind;
+            if (center.size() != 0)
+            {
+                Eigen::VectorXd XTone = X_ind.transpose() * one;
+                Eigen::VectorXd center_ind = center.segment(index(i), gsize(i));
+                center_XTHX(XTX(i, 0), XTone, n, center_ind);
+            }
+        }
+    }
+    return XTX;
+}
 #endif //BESS_UTILITIES_H
@@ -8,3 +8,5 @@
 # from abess.linear import PdasLm, PdasLogistic, PdasPoisson, PdasCox, L0L2Lm, L0L2Logistic, L0L2Poisson, L0L2Cox, GroupPdasLm, GroupPdasLogistic, GroupPdasPoisson, GroupPdasCox, abessLogistic
 from abess.linear import abessLogistic, abessLm, abessCox, abessPoisson, abessMultigaussian, abessMultinomial, abessPCA
 from abess.gen_data import gen_data, gen_data_splicing
+from abess.mapped import MappedDesign, save_design
+from abess.genotype import GenotypeDesign
@@ -62,7 +62,42 @@ class _SwigNonDynamicMeta(type):
 
 
 
-def pywrap_abess(arg1, arg2, n, p, data_type, arg6, arg7, is_normal, algorithm_type, model_type, max_iter, exchange_num, path_type, is_warm_start, ic_type, ic_coef, is_cv, K, arg19, arg20, arg21, arg22, s_min, s_max, K_max, epsilon, lambda_min, lambda_max, n_lambda, is_screening, screening_size, powell_path, arg33, tau, primary_model_fit_max_iter, primary_model_fit_epsilon, early_stop, approximate_Newton, thread, covariance_update, sparse_matrix, splicing_type, arg43, arg44, arg45, arg46, arg47, arg48, arg49, arg50):
-    return _cabess.pywrap_abess(arg1, arg2, n, p, data_type, arg6, arg7, is_normal, algorithm_type, model_type, max_iter, exchange_num, path_type, is_warm_start, ic_type, ic_coef, is_cv, K, arg19, arg20, arg21, arg22, s_min, s_max, K_max, epsilon, lambda_min, lambda_max, n_lambda, is_screening, screening_size, powell_path, arg33, tau, primary_model_fit_max_iter, primary_model_fit_epsilon, early_stop, approximate_Newton, thread, covariance_update, sparse_matrix, splicing_type, arg43, arg44, arg45, arg46, arg47, arg48, arg49, arg50)
+def pywrap_abess(arg1, arg2, n, p, x_layout, arg6, arg7, arg8, sparse_format, arg10, data_type, arg12, arg13, is_normal, algorithm_type, model_type, max_iter, exchange_num, path_type, is_warm_start, ic_type, ic_coef, is_cv, K, arg25, arg26, arg27, arg28, s_min, s_max, K_max, epsilon, lambda_min, lambda_max, n_lambda, is_screening, screening_size, powell_path, arg39, tau, primary_model_fit_max_iter, primary_model_fit_epsilon, early_stop, approximate_Newton, thread, covariance_update, sparse_matrix, splicing_type, important_search, strong_rule, active_warm_start, cox_ties, primary_solver, parallel_exchange, arg55, arg56, arg57, arg58, arg59, arg60, arg61, arg62, arg63, arg64, arg65, arg66, arg67, arg68):
+    return _cabess.pywrap_abess(arg1, arg2, n, p, x_layout, arg6, arg7, arg8, sparse_format, arg10, data_type, arg12, arg13, is_normal, algorithm_type, model_type, max_iter, exchange_num, path_type, is_warm_start, ic_type, ic_coef, is_cv, K, arg25, arg26, arg27, arg28, s_min, s_max, K_max, epsilon, lambda_min, lambda_max, n_lambda, is_screening, screening_size, powell_path, arg39, tau, primary_model_fit_max_iter, primary_model_fit_epsilon, early_stop, approximate_Newton, thread, covariance_update, sparse_matrix, splicing_type, important_search, strong_rule, active_warm_start, cox_ties, primary_solver, parallel_exchange, arg55, arg56, arg57, arg58, arg59, arg60, arg61, arg62, arg63, arg64, arg65, arg66, arg67, arg68)
 
+def pywrap_session_new(arg1, arg2, n, p, x_layout, arg6, arg7, arg8, sparse_format, arg10, data_type, arg12, is_normal, arg14, arg15, sparse_matrix):
+    return _cabess.pywrap_session_new(arg1, arg2, n, p, x_layout, arg6, arg7, arg8, sparse_format, arg10, data_type, arg12, is_normal, arg14, arg15, sparse_matrix)
+
+def pywrap_session_fit(session, arg2, arg3, algorithm_type, model_type, max_iter, exchange_num, path_type, is_warm_start, ic_type, ic_coef, is_cv, K, arg14, arg15, arg16, s_min, s_max, K_max, epsilon, lambda_min, lambda_max, n_lambda, is_screening, screening_size, powell_path, arg27, tau, primary_model_fit_max_iter, primary_model_fit_epsilon, early_stop, approximate_Newton, thread, covariance_update, splicing_type, important_search, strong_rule, active_warm_start, cox_ties, primary_solver, parallel_exchange, arg42, arg43, arg44, arg45, arg46, arg47, arg48, arg49, arg50, arg51, arg52, arg53, arg54, arg55):
+    return _cabess.pywrap_session_fit(session, arg2, arg3, algorithm_type, model_type, max_iter, exchange_num, path_type, is_warm_start, ic_type, ic_coef, is_cv, K, arg14, arg15, arg16, s_min, s_max, K_max, epsilon, lambda_min, lambda_max, n_lambda, is_screening, screening_size, powell_path, arg27, tau, primary_model_fit_max_iter, primary_model_fit_epsilon, early_stop, approximate_Newton, thread, covariance_update, splicing_type, important_search, strong_rule, active_warm_start, cox_ties, primary_solver, parallel_exchange, arg42, arg43, arg44, arg45, arg46, arg47, arg48, arg49, arg50, arg51, arg52, arg53, arg54, arg55)
+
+def pywrap_session_free(session):
+    return _cabess.pywrap_session_free(session)
+
+def pywrap_mapped_open(path):
+    return _cabess.pywrap_mapped_open(path)
+
+def pywrap_mapped_rows(design):
+    return _cabess.pywrap_mapped_rows(design)
+
+def pywrap_mapped_cols(design):
+    return _cabess.pywrap_mapped_cols(design)
+
+def pywrap_mapped_gather(design, arg2, arg3):
+    return _cabess.pywrap_mapped_gather(design, arg2, arg3)
+
+def pywrap_mapped_close(design):
+    return _cabess.pywrap_mapped_close(design)
+
+def pywrap_session_new_float(arg1, arg2, x_layout, arg4, data_type, arg6, is_normal, arg8, arg9):
+    return _cabess.pywrap_session_new_float(arg1, arg2, x_layout, arg4, data_type, arg6, is_normal, arg8, arg9)
+
+def pywrap_session_new_genotype(arg1, n, arg3, arg4, data_type, arg6, is_normal, arg8, arg9):
+    return _cabess.pywrap_session_new_genotype(arg1, n, arg3, arg4, data_type, arg6, is_normal, arg8, arg9)
+
+def pywrap_session_new_mapped(design, arg2, arg3, data_type, arg5, is_normal, arg7, arg8):
+    return _cabess.pywrap_session_new_mapped(design, arg2, arg3, data_type, arg5, is_normal, arg7, arg8)
+
+def pywrap_cox_risk_sets(arg1, arg2, arg3, arg4):
+    return _cabess.pywrap_cox_risk_sets(arg1, arg2, arg3, arg4)
 
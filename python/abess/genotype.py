@@ -0,0 +1,44 @@
+import numpy as np
+
+
+class GenotypeDesign:
+    """
+    A design of SNP genotypes in {0, 1, 2}, packed 4 to a byte.
+
+    It can be passed to `fit` as X, for all the models but PCA. The fit works on the
+    packed codes, which take 1/32 of the memory of a float64 X. A missing genotype
+    (NaN or a negative value) is read as the mean of the observed ones in its column.
+    `coef_` is given on the scale of the genotypes.
+
+    Parameters
+    ----------
+    G : array-like of shape (n_samples, n_features)
+        The genotypes. It is packed `chunk_cols` columns at a time,
+        so a `numpy.memmap` larger than the memory can be given.
+    chunk_cols : int, optional
+        The number of columns packed at a time.
+        Default: chunk_cols = 1024.
+
+    Examples
+    --------
+    >>> G = np.random.binomial(2, 0.3, size=(500, 10000))
+    >>> model = abessLm(support_size=range(0, 20))
+    >>> model.fit(GenotypeDesign(G), y)
+    """
+
+    def __init__(self, G, chunk_cols=1024):
+        n, p = G.shape
+        stride = (n + 3) // 4
+        # column j is codes[j], sample i in the bits 2 * (i % 4) of codes[j, i // 4]
+        self.codes = np.zeros((p, stride), dtype=np.uint8)
+        for start in range(0, p, chunk_cols):
+            chunk = np.asarray(G[:, start:start + chunk_cols], dtype=np.float64)
+            missing = np.isnan(chunk) | (chunk < 0)
+            if np.any(~missing & (chunk != 0) & (chunk != 1) & (chunk != 2)):
+                raise ValueError("G should only have the values 0, 1, 2, or NaN for missing.")
+            code = np.zeros((4 * stride, chunk.shape[1]), dtype=np.uint8)
+            code[:n] = np.where(missing, 3, chunk)
+            code = code.T.reshape(chunk.shape[1], stride, 4)
+            self.codes[start:start + chunk.shape[1]] = (code[:, :, 0] | (code[:, :, 1] << 2)
+                                                        | (code[:, :, 2] << 4) | (code[:, :, 3] << 6))
+        self.shape = (n, p)
@@ -1,8 +1,10 @@
-from abess.cabess import pywrap_abess
+from abess.cabess import pywrap_abess, pywrap_session_new, pywrap_session_new_float, pywrap_session_new_genotype, pywrap_session_new_mapped, pywrap_session_fit, pywrap_session_free, pywrap_cox_risk_sets
+from abess.mapped import MappedDesign
+from abess.genotype import GenotypeDesign
 import numpy as np
 import math
 import types
-from scipy.sparse import coo_matrix
+from scipy.sparse import csc_matrix, issparse
 import numbers
 
 from sklearn.base import BaseEstimator
@@ -82,13 +84,67 @@ class bess_base(BaseEstimator):
         Default: K = 5.
     thread: int optional
         Max number of multithreads. If thread = 0, the program will use the maximum number supported by the device.
+        The threads fit the cross validation folds, or with parallel_exchange, the exchanges tried in each splicing step.
         Default: thread = 1. 
+    parallel_exchange : bool, optional
+        Without cross validation, fit the exchanges tried in each splicing step on the threads at once.
+        The support and the coefficients are the same as with one thread.
+        Default: parallel_exchange = False.
+    important_search : int, optional
+        The number of inactive groups, those with the largest sacrifices, that each splicing step exchanges
+        with the active ones. Once the splicing settles, the sacrifices of all the groups are computed again
+        and it goes on if better ones were left out, so that it ends only where splicing all of them would.
+        It saves most of the work when p is much larger than the support size.
+        If important_search = 0, all the inactive groups are used.
+        Default: important_search = 0.
+    strong_rule : float, optional
+        On the path, the inactive groups whose sacrifice at the previous support size is below strong_rule
+        times the smallest active one are left out of the splicing at the next one. They are checked the same
+        way as for important_search once the splicing settles, and taken back if they would be exchanged.
+        If strong_rule = 0, no group is left out.
+        Default: strong_rule = 0.
+    active_warm_start : bool, optional
+        With is_warm_start = True, the active set of each support size on the path starts from that of the
+        previous one, with the inactive groups of the largest sacrifices added or the active ones of the
+        smallest removed, instead of the groups of the largest sacrifices.
+        Default: active_warm_start = False.
+    ties : {"breslow", "efron"}, optional
+        Only for Cox. The approximation of the partial likelihood for the events at tied times.
+        Default: ties = "breslow".
+    primary_solver : {"newton", "diagonal", "lbfgs"}, optional
+        Only for Logistic, Poisson and Multinomial. The solver of the fits on the active set:
+        Newton's method, Newton's method with the diagonal of the Hessian, or L-BFGS, whose curvature
+        pairs are carried from one fit to the next. The last two avoid forming the Hessian, which pays
+        off for large support sizes.
+        Default: primary_solver = "newton".
+    dtype : {numpy.float64, numpy.float32}, optional
+        The type X is stored in during the fit. With numpy.float32 a dense X takes half the memory,
+        while the fits on the active set and the loss are still computed in double.
+        Not available for a sparse X or for PCA.
+        Default: dtype = numpy.float64.
 
 
     Atrributes
     ----------
     beta : array of shape (n_features, ) or (n_targets, n_features)
         Estimated coefficients for the best subset selection problem.
+    coef_path_ : array of shape (n_sizes, n_alphas, n_features) or (n_sizes, n_alphas, n_features, n_targets)
+        Estimated coefficients for every support size and alpha on the path, on the scale of the input X.
+        For path_type = "pgs", n_alphas is 1 and the support sizes are those visited by golden section.
+    intercept_path_ : array of shape (n_sizes, n_alphas) or (n_sizes, n_alphas, n_targets)
+        Intercepts on the path.
+    train_loss_path_, ic_path_, test_loss_path_ : array of shape (n_sizes, n_alphas)
+        Training loss, information criterion and (for is_cv = True) cross-validation loss on the path.
+    support_size_path_ : array of shape (n_sizes, )
+        The support sizes on the path.
+    pruned_size_path_ : array of shape (n_sizes, n_alphas)
+        The number of groups left out of the splicing by important_search and strong_rule on the path,
+        summed over the folds for is_cv = True.
+    n_iter_path_ : array of shape (n_sizes, n_alphas)
+        The number of splicing iterations on the path, summed over the folds for is_cv = True.
+    n_primary_iter_path_, primary_time_path_ : array of shape (n_sizes, n_alphas)
+        The iterations and seconds spent in the fits on the active set on the path, summed over the folds
+        for is_cv = True. Only counted for Logistic, Poisson and Multinomial.
 
 
     References
@@ -106,9 +162,16 @@ class bess_base(BaseEstimator):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1,
+                 parallel_exchange=False,
                  covariance_update=False,
                  sparse_matrix=False,
-                 splicing_type=0):
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False,
+                 ties="breslow",
+                 primary_solver="newton",
+                 dtype=np.float64):
         self.algorithm_type = algorithm_type
         self.model_type = model_type
         self.data_type = data_type
@@ -148,9 +211,16 @@ class bess_base(BaseEstimator):
         self.early_stop = early_stop
         self.approximate_Newton = approximate_Newton
         self.thread = thread
+        self.parallel_exchange = parallel_exchange
         self.covariance_update = covariance_update
         self.sparse_matrix = sparse_matrix
         self.splicing_type = splicing_type
+        self.important_search = important_search
+        self.strong_rule = strong_rule
+        self.active_warm_start = active_warm_start
+        self.ties = ties
+        self.primary_solver = primary_solver
+        self.dtype = dtype
         self.input_type = 0
 
     def _arg_check(self):
@@ -225,19 +295,23 @@ class bess_base(BaseEstimator):
         #     raise ValueError(
         #         "ic_type should be \"aic\", \"bic\", \"ebic\" or \"gic\"")
 
-    def fit(self, X=None, y=None, is_weight=False, is_normal=True, weight=None, state=None, group=None, always_select=None, Sigma=None, number=1):
+    def fit(self, X=None, y=None, is_weight=False, is_normal=True, weight=None, state=None, group=None, always_select=None, Sigma=None, number=1, keep_session=False):
         """
         The fit function is used to transfer the information of data and return the fit result.
 
         Parameters
         ----------
-        X : array-like of shape (n_samples, n_features)
-            Training data
+        X : array-like of shape (n_samples, n_features), MappedDesign, or GenotypeDesign
+            Training data. A `MappedDesign` is fitted from its file on disk,
+            and only the columns in use are loaded into memory.
+            A `GenotypeDesign` is fitted on its packed codes.
         y :  array-like of shape (n_samples,) or (n_samples, n_targets)
             Target values. Will be cast to X's dtype if necessary.
             For linear regression problem, y should be a n time 1 numpy array with type \code{double}.
             For classification problem, \code{y} should be a $n \time 1$ numpy array with values \code{0} or \code{1}.
             For count data, \code{y} should be a $n \time 1$ numpy array of non-negative integer.
+            For Cox, \code{y} holds the time and the status of each sample, and optionally a third column of integer strata,
+            each with its own baseline hazard. Samples of a stratum with the same time are tied.
         is_weight : bool
             whether to weight sample yourself.
             Default: is$\_$weight = False.
@@ -260,16 +334,55 @@ class bess_base(BaseEstimator):
         number : int, optional 
             Only for PCA. Indicates the number of PCs returned. 
             Default: 1
+        keep_session : bool, optional
+            Whether to keep the normalized X and the quantities derived from it (Gram blocks, screening)
+            for the next fit. A later fit with keep_session=True on the same X object reuses them,
+            and only recomputes the parts that depend on what changed (e.g. y or support_size).
+            X should not be modified in place between such fits.
+            Default: False
 
         """
         # self._arg_check()
 
 
-        if X is not None:   # input_type=0
-            X = np.array(X)
+        sparse_matrix = self.sparse_matrix
+        X_origin = X
+        mapped = isinstance(X, MappedDesign)
+        genotype = isinstance(X, GenotypeDesign)
+        if genotype:
+            if self.model_type == "PCA":
+                raise ValueError("A GenotypeDesign can not be fitted for PCA.")
+            n, p = X.shape
+            y = check_array(y, ensure_2d=False, dtype=np.float64)
+            if y.shape[0] != n:
+                raise ValueError("y should have the same number of rows as X.")
+            sparse_matrix = False
+            Sigma = np.matrix(-1)
+            self.n_features_in_ = p
+            self.input_type = 0
+        elif mapped:
+            if self.model_type == "PCA":
+                raise ValueError("A MappedDesign can not be fitted for PCA.")
+            n, p = X.shape
+            y = check_array(y, ensure_2d=False, dtype=np.float64)
+            if y.shape[0] != n:
+                raise ValueError("y should have the same number of rows as X.")
+            sparse_matrix = False
+            Sigma = np.matrix(-1)
+            self.n_features_in_ = p
+            self.input_type = 0
+        elif X is not None:   # input_type=0
+            if issparse(X):
+                # scipy sparse input is always fitted as sparse
+                sparse_matrix = True
+                if (self.model_type == "PCA"):
+                    X = X.toarray()
+                    sparse_matrix = False
+            else:
+                X = np.asarray(X)
 
             # print(X)
-            if (X.dtype != 'int' and X.dtype != 'float'):
+            if (X.dtype != 'int' and X.dtype != 'float' and X.dtype != 'float32'):
                 raise ValueError("X should be numeric matrix.")
             elif len(X.shape) != 2:
                 raise ValueError("X should be 2-dimension matrix.")
@@ -285,7 +398,7 @@ class bess_base(BaseEstimator):
             # Check that X and y have correct shape
             # accept_sparse
             X, y = check_X_y(X, y, ensure_2d=True,
-                            accept_sparse=False, multi_output=True, y_numeric=True)
+                            accept_sparse=["csc", "csr", "coo"], multi_output=True, y_numeric=True)
             
             if (self.model_type == "PCA"):
                 X = X - X.mean(axis = 0)
@@ -394,9 +507,24 @@ class bess_base(BaseEstimator):
             raise ValueError(
                 "ic_type should be \"aic\", \"bic\", \"ebic\" or \"gic\"")
 
+        if model_type_int == 4 and self.ties not in ("breslow", "efron"):
+            raise ValueError("ties should be \"breslow\" or \"efron\".")
+        cox_ties = 1 if model_type_int == 4 and self.ties == "efron" else 0
+        primary_solvers = {"newton": 0, "diagonal": 1, "lbfgs": 2}
+        if self.primary_solver not in primary_solvers:
+            raise ValueError("primary_solver should be \"newton\", \"diagonal\" or \"lbfgs\".")
+        primary_solver = primary_solvers[self.primary_solver] if model_type_int in (2, 3, 6) else 0
+
+        sort_index = None
         if model_type_int == 4:
-            X = X[y[:, 0].argsort()]
-            y = y[y[:, 0].argsort()]
+            if issparse(X):
+                X = X.tocsc()
+            # y holds the time, the status and optionally the stratum of each sample;
+            # the samples are sorted by stratum and time, and state gets the tie blocks
+            strata = y[:, 2].astype(np.int32) if y.shape[1] > 2 else np.zeros(0, dtype=np.int32)
+            # the rows of X are taken in this order when it is copied on the C++ side
+            sort_index, state = pywrap_cox_risk_sets(np.asarray(y[:, 0], dtype=np.float64), strata, n, n)
+            y = y[sort_index]
             y = y[:, 1].reshape(-1)
 
         if y.ndim == 1:
@@ -441,6 +569,9 @@ class bess_base(BaseEstimator):
                     "X.shape(0) should be equal to weight.size")
         else:
             weight = np.ones(n)
+        if sort_index is not None:
+            weight = np.asarray(weight, dtype=np.float64)[sort_index]
+        row_order = np.zeros(0, dtype=np.int32) if sort_index is None else sort_index.astype(np.int32)
 
         # To do
         if state is None:
@@ -480,7 +611,7 @@ class bess_base(BaseEstimator):
             new_K_max = 0
             new_lambda_min = 0
             new_lambda_max = 0
-            path_len = int(len(support_sizes))
+            path_len = int(len(support_sizes)) * int(len(alphas))
         else:
             support_sizes = [0]
             alphas = [0]
@@ -513,7 +644,8 @@ class bess_base(BaseEstimator):
             else:
                 new_lambda_max = self.lambda_max
 
-            path_len = new_K_max + 2
+            # the golden-section path keeps at most s_max - s_min + 5 fits
+            path_len = new_s_max - new_s_min + 5
         
         # exchange_num
         if (not isinstance(self.exchange_num, int) or self.exchange_num <= 0):
@@ -550,6 +682,14 @@ class bess_base(BaseEstimator):
         # splicing type
         if (self.splicing_type != 0 and self.splicing_type !=1):
             raise ValueError("splicing type should be 0 or 1.")
+
+        # important search
+        if (not isinstance(self.important_search, int) or self.important_search < 0):
+            raise ValueError("important_search should be a non-negative integer.")
+
+        # strong rule
+        if (self.strong_rule < 0 or self.strong_rule > 1):
+            raise ValueError("strong_rule should be in [0, 1].")
         
         # number
         if (not isinstance(number, int) or number <= 0 or number > p):
@@ -589,46 +729,142 @@ class bess_base(BaseEstimator):
 
         
 
+        float_x = np.dtype(self.dtype) == np.float32
+        if float_x and (sparse_matrix or genotype or mapped or model_type_int == 7):
+            raise ValueError("dtype = float32 is only available for a dense X, and not for PCA.")
+        elif not float_x and np.dtype(self.dtype) != np.float64:
+            raise ValueError("dtype should be numpy.float64 or numpy.float32.")
+
         # start = time()
-        if self.sparse_matrix:
-            # print(type(X))
-            if type(X) != type(coo_matrix((1, 1))):
-                # print("sparse matrix 1")
-                nonzero = 0
-                tmp = np.zeros([X.shape[0] * X.shape[1], 3])
-                for j in range(X.shape[1]):
-                    for i in range(X.shape[0]):
-                        if X[i, j] != 0.:
-                            tmp[nonzero, :] = np.array([X[i, j], i, j])
-                            nonzero += 1
-                X = tmp[:nonzero, :]
-
-                # print("nonzeros num: " + str(nonzero))
-                # coo = coo_matrix(X)
-                # X = np.zeros([len(coo.data), 3])
-                # print(X[:, 0])
-                # print(coo.data)
-                # X[:, 0] = coo.data.reshape(-1)
-                # X[:, 1] = coo.row.reshape(-1)
-                # X[:, 2] = coo.col.reshape(-1)
-                # print(X)
+        # sparse X is passed as CSC/CSR/COO buffers (sparse_format 0/1/2)
+        # and converted to CSC on the C++ side.
+        sparse_format = 0
+        if sparse_matrix:
+            if not issparse(X):
+                X = csc_matrix(X)
+            elif X.format == "csr":
+                sparse_format = 1
+            elif X.format == "coo":
+                sparse_format = 2
+            elif X.format != "csc":
+                X = X.tocsc()
+            # CSC buffers are mapped as they are, so their row indices must be sorted and unique
+            if sparse_format == 0 and not X.has_canonical_format:
+                X = X.copy()
+                X.sum_duplicates()
+            if X.nnz > np.iinfo(np.int32).max:
+                raise ValueError("A sparse X can have at most 2^31 - 1 nonzero entries.")
+
+            sparse_x_val = np.asarray(X.data, dtype=np.float64)
+            if sparse_format == 2:
+                sparse_x_idx = np.asarray(X.row, dtype=np.int32)
+                sparse_x_ptr = np.asarray(X.col, dtype=np.int32)
             else:
-                # print("sparse matrix 2")
-                tmp = np.zeros([len(X.data), 3])
-                tmp[:, 1] = X.row
-                tmp[:, 2] = X.col
-                tmp[:, 0] = X.data
-
-                X = tmp
-                # print(X)
+                sparse_x_idx = np.asarray(X.indices, dtype=np.int32)
+                sparse_x_ptr = np.asarray(X.indptr, dtype=np.int32)
+        else:
+            sparse_x_val = np.zeros(0)
+            sparse_x_idx = np.zeros(0, dtype=np.int32)
+            sparse_x_ptr = np.zeros(1, dtype=np.int32)
 
         # stop = time()
         # print("sparse x time : " + str(stop-start))
         # print("linear.py fit")
         # print(y.shape)
 
-        
-        result = pywrap_abess(X, y, n, p, self.data_type, weight, Sigma,
+        # A Fortran-ordered X is passed as its (C-contiguous) transpose,
+        # so that the C++ side can map it without copying.
+        if sparse_matrix or genotype or mapped:
+            x_layout = 0
+            X_buffer = np.zeros((1, 1))
+        elif X.flags.f_contiguous and not X.flags.c_contiguous:
+            x_layout = 1
+            X_buffer = X.T
+        else:
+            x_layout = 0
+            X_buffer = X
+        if float_x:
+            X_buffer = np.asarray(X_buffer, dtype=np.float32)
+
+        # a float32 X, genotypes or a design on disk are only fitted through a session
+        if keep_session or float_x or genotype or mapped:
+            # the design is reused as long as it is the same X with the same preprocessing
+            session_key = (n, p, M, x_layout, sparse_matrix, float_x, is_normal, self.data_type,
+                           list(g_index), np.asarray(weight).tolist(),
+                           None if sort_index is None else sort_index.tolist())
+            if (getattr(self, "_session", None) is not None
+                    and (self._session_X is not X_origin or self._session_key != session_key)):
+                self._free_session()
+            if getattr(self, "_session", None) is not None and not keep_session:
+                self._free_session()
+            if getattr(self, "_session", None) is None and genotype:
+                self._session = pywrap_session_new_genotype(X.codes, n, y, row_order,
+                            self.data_type, weight,
+                            is_normal,
+                            g_index,
+                            state)
+                self._session_X = X_origin
+                self._session_key = session_key
+            elif getattr(self, "_session", None) is None and mapped:
+                self._session = pywrap_session_new_mapped(X._handle, y, row_order,
+                            self.data_type, weight,
+                            is_normal,
+                            g_index,
+                            state)
+                self._session_X = X_origin
+                self._session_key = session_key
+            elif getattr(self, "_session", None) is None and float_x:
+                self._session = pywrap_session_new_float(X_buffer, y, x_layout, row_order,
+                            self.data_type, weight,
+                            is_normal,
+                            g_index,
+                            state)
+                self._session_X = X_origin
+                self._session_key = session_key
+            elif getattr(self, "_session", None) is None:
+                self._session = pywrap_session_new(X_buffer, y, n, p, x_layout,
+                            sparse_x_val, sparse_x_idx, sparse_x_ptr, sparse_format, row_order,
+                            self.data_type, weight,
+                            is_normal,
+                            g_index,
+                            state,
+                            sparse_matrix)
+                self._session_X = X_origin
+                self._session_key = session_key
+
+            result = pywrap_session_fit(self._session, y, Sigma,
+                            algorithm_type_int, model_type_int, self.max_iter, self.exchange_num,
+                            path_type_int, self.is_warm_start,
+                            ic_type_int, self.ic_coef, self.is_cv, self.K,
+                            state,
+                            support_sizes,
+                            alphas,
+                            new_s_min, new_s_max, new_K_max, self.epsilon,
+                            new_lambda_min, new_lambda_max, self.n_lambda,
+                            self.is_screening, new_screening_size, self.powell_path,
+                            self.always_select, self.tau,
+                            self.primary_model_fit_max_iter, self.primary_model_fit_epsilon,
+                            self.early_stop, self.approximate_Newton,
+                            self.thread,
+                            self.covariance_update,
+                            self.splicing_type,
+                            self.important_search,
+                            self.strong_rule,
+                            self.active_warm_start,
+                            cox_ties,
+                            primary_solver,
+                            self.parallel_exchange,
+                            p * M,
+                            1 * M, 1, 1,
+                            path_len * p * M, path_len * M, path_len, path_len, path_len, path_len, path_len, path_len, path_len, path_len
+                            )
+            if not keep_session:
+                self._free_session()
+        else:
+            self._free_session()
+            result = pywrap_abess(X_buffer, y, n, p, x_layout,
+                            sparse_x_val, sparse_x_idx, sparse_x_ptr, sparse_format, row_order,
+                            self.data_type, weight, Sigma,
                             is_normal,
                             algorithm_type_int, model_type_int, self.max_iter, self.exchange_num,
                             path_type_int, self.is_warm_start,
@@ -645,10 +881,17 @@ class bess_base(BaseEstimator):
                             self.early_stop, self.approximate_Newton,
                             self.thread,
                             self.covariance_update,
-                            self.sparse_matrix,
+                            sparse_matrix,
                             self.splicing_type,
+                            self.important_search,
+                            self.strong_rule,
+                            self.active_warm_start,
+                            cox_ties,
+                            primary_solver,
+                            self.parallel_exchange,
                             p * M,
-                            1 * M, 1, 1, 1, 1, 1, p
+                            1 * M, 1, 1,
+                            path_len * p * M, path_len * M, path_len, path_len, path_len, path_len, path_len, path_len, path_len, path_len
                             )
 
         # print("linear fit end")
@@ -662,17 +905,34 @@ class bess_base(BaseEstimator):
 
         self.train_loss_ = result[2]
         self.ic_ = result[3]
+
+        # the whole path comes back as (support size, alpha) cells
+        n_path = result[15]
+        n_alpha = len(alphas) if path_type_int == 1 else 1
+        path_index = np.arange(n_path // n_alpha)
+        support_size_path = result[10][:n_path // n_alpha]
+        if path_type_int == 2:
+            # keep the last fit of each visited support size, in increasing order
+            _, last = np.unique(support_size_path[::-1], return_index=True)
+            path_index = len(support_size_path) - 1 - last
+        self.support_size_path_ = support_size_path[path_index]
+        self.coef_path_ = result[5][:n_path * p * M].reshape(-1, n_alpha, p, M)[path_index]
+        self.intercept_path_ = result[6][:n_path * M].reshape(-1, n_alpha, M)[path_index]
+        if M == 1:
+            self.coef_path_ = self.coef_path_[:, :, :, 0]
+            self.intercept_path_ = self.intercept_path_[:, :, 0]
+        self.train_loss_path_ = result[7][:n_path].reshape(-1, n_alpha)[path_index]
+        self.ic_path_ = result[8][:n_path].reshape(-1, n_alpha)[path_index]
+        self.test_loss_path_ = result[9][:n_path].reshape(-1, n_alpha)[path_index]
+        self.pruned_size_path_ = result[11][:n_path].reshape(-1, n_alpha)[path_index]
+        self.n_iter_path_ = result[12][:n_path].reshape(-1, n_alpha)[path_index]
+        self.n_primary_iter_path_ = result[13][:n_path].reshape(-1, n_alpha)[path_index]
+        self.primary_time_path_ = result[14][:n_path].reshape(-1, n_alpha)[path_index]
         # print(self.coef_)
         # print(self.intercept_)
         # print(self.train_loss)
         # print(self.ic)
         # print("linear fit end")
-        # self.nullloss_out = result[3]
-        # self.aic_sequence = result[4]
-        # self.bic_sequence = result[5]
-        # self.gic_sequence = result[6]
-        # self.A_out = result[7]
-        # self.l_out = result[8]
         
         # for PCA, "number" indicates the number of PCs returned
         if (model_type_int == 7 and number > 1):
@@ -685,7 +945,9 @@ class bess_base(BaseEstimator):
                 temp = v.dot(v.T).dot(Sigma)
                 Sigma = Sigma + temp.dot(v).dot(v.T) - temp - temp.T
 
-                result = pywrap_abess(X, y, n, p, self.data_type, weight, Sigma,
+                result = pywrap_abess(X_buffer, y, n, p, x_layout,
+                            sparse_x_val, sparse_x_idx, sparse_x_ptr, sparse_format, row_order,
+                            self.data_type, weight, Sigma,
                                     is_normal,
                                     algorithm_type_int, model_type_int, self.max_iter, self.exchange_num,
                                     path_type_int, self.is_warm_start,
@@ -702,10 +964,17 @@ class bess_base(BaseEstimator):
                                     self.early_stop, self.approximate_Newton,
                                     self.thread,
                                     self.covariance_update,
-                                    self.sparse_matrix,
+                                    sparse_matrix,
                                     self.splicing_type,
+                                    self.important_search,
+                                    self.strong_rule,
+                                    self.active_warm_start,
+                                    cox_ties,
+                                    primary_solver,
+                                    self.parallel_exchange,
                                     p * M,
-                                    1 * M, 1, 1, 1, 1, 1, p
+                                    1 * M, 1, 1,
+                                    path_len * p * M, path_len * M, path_len, path_len, path_len, path_len, path_len, path_len, path_len, path_len
                                     )
                 v = result[0]
                 v = v.reshape(len(v), 1)
@@ -718,6 +987,23 @@ class bess_base(BaseEstimator):
 
         return self
 
+    def _free_session(self):
+        if getattr(self, "_session", None) is not None:
+            pywrap_session_free(self._session)
+        self._session = None
+        self._session_X = None
+        self._session_key = None
+
+    def __del__(self):
+        self._free_session()
+
+    def __getstate__(self):
+        # the session is a raw pointer and stays with this object
+        state = self.__dict__.copy()
+        for key in ["_session", "_session_X", "_session_key"]:
+            state.pop(key, None)
+        return state
+
     def predict(self, X):
         """
         The predict function is used to give prediction for new data.
@@ -884,8 +1170,14 @@ class abessLogistic(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1,
+                 parallel_exchange=False,
                  sparse_matrix=False,
-                 splicing_type=0
+                 dtype=np.float64,
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False,
+                 primary_solver="newton"
                  ):
         super(abessLogistic, self).__init__(
             algorithm_type="abess", model_type="Logistic", data_type=2, path_type=path_type, max_iter=max_iter, exchange_num=exchange_num,
@@ -895,8 +1187,14 @@ class abessLogistic(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
-            splicing_type=splicing_type
+            dtype=dtype,
+            splicing_type=splicing_type,
+            important_search=important_search,
+            strong_rule=strong_rule,
+            active_warm_start=active_warm_start,
+            primary_solver=primary_solver
         )
 
 
@@ -940,8 +1238,13 @@ class abessLm(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1, covariance_update=False,
+                 parallel_exchange=False,
                  sparse_matrix=False,
-                 splicing_type=0
+                 dtype=np.float64,
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False
                  ):
         super(abessLm, self).__init__(
             algorithm_type="abess", model_type="Lm", data_type=1, path_type=path_type, max_iter=max_iter, exchange_num=exchange_num,
@@ -951,8 +1254,13 @@ class abessLm(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread, covariance_update=covariance_update,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
-            splicing_type=splicing_type
+            dtype=dtype,
+            splicing_type=splicing_type,
+            important_search=important_search,
+            strong_rule=strong_rule,
+            active_warm_start=active_warm_start
         )
 
 
@@ -996,8 +1304,14 @@ class abessCox(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1,
+                 parallel_exchange=False,
                  sparse_matrix=False,
-                 splicing_type=0
+                 dtype=np.float64,
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False,
+                 ties="breslow"
                  ):
         super(abessCox, self).__init__(
             algorithm_type="abess", model_type="Cox", data_type=3, path_type=path_type, max_iter=max_iter, exchange_num=exchange_num,
@@ -1007,8 +1321,14 @@ class abessCox(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
-            splicing_type=splicing_type
+            dtype=dtype,
+            splicing_type=splicing_type,
+            important_search=important_search,
+            strong_rule=strong_rule,
+            active_warm_start=active_warm_start,
+            ties=ties
         )
 
 
@@ -1053,8 +1373,14 @@ class abessPoisson(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1,
+                 parallel_exchange=False,
                  sparse_matrix=False,
-                 splicing_type=0
+                 dtype=np.float64,
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False,
+                 primary_solver="newton"
                  ):
         super(abessPoisson, self).__init__(
             algorithm_type="abess", model_type="Poisson", data_type=2, path_type=path_type, max_iter=max_iter, exchange_num=exchange_num,
@@ -1064,8 +1390,14 @@ class abessPoisson(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
-            splicing_type=splicing_type
+            dtype=dtype,
+            splicing_type=splicing_type,
+            important_search=important_search,
+            strong_rule=strong_rule,
+            active_warm_start=active_warm_start,
+            primary_solver=primary_solver
         )
 
 
@@ -1109,8 +1441,13 @@ class abessMultigaussian(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1, covariance_update=False,
+                 parallel_exchange=False,
                  sparse_matrix=False,
-                 splicing_type=0
+                 dtype=np.float64,
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False
                  ):
         super(abessMultigaussian, self).__init__(
             algorithm_type="abess", model_type="Multigaussian", data_type=1, path_type=path_type, max_iter=max_iter, exchange_num=exchange_num,
@@ -1120,8 +1457,13 @@ class abessMultigaussian(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread, covariance_update=covariance_update,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
-            splicing_type=splicing_type
+            dtype=dtype,
+            splicing_type=splicing_type,
+            important_search=important_search,
+            strong_rule=strong_rule,
+            active_warm_start=active_warm_start
         )
         self.data_type = 1
 
@@ -1167,8 +1509,14 @@ class abessMultinomial(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1,
+                 parallel_exchange=False,
                  sparse_matrix=False,
-                 splicing_type=0
+                 dtype=np.float64,
+                 splicing_type=0,
+                 important_search=0,
+                 strong_rule=0.,
+                 active_warm_start=False,
+                 primary_solver="newton"
                  ):
         super(abessMultinomial, self).__init__(
             algorithm_type="abess", model_type="Multinomial", data_type=2, path_type=path_type, max_iter=max_iter, exchange_num=exchange_num,
@@ -1178,8 +1526,14 @@ class abessMultinomial(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
-            splicing_type=splicing_type
+            dtype=dtype,
+            splicing_type=splicing_type,
+            important_search=important_search,
+            strong_rule=strong_rule,
+            active_warm_start=active_warm_start,
+            primary_solver=primary_solver
         )
 
         
@@ -1223,6 +1577,7 @@ class abessPCA(bess_base):
                  primary_model_fit_max_iter=30, primary_model_fit_epsilon=1e-8,
                  early_stop=False, approximate_Newton=False,
                  thread=1,
+                 parallel_exchange=False,
                  sparse_matrix=False,
                  splicing_type=1
                  ):
@@ -1234,6 +1589,7 @@ class abessPCA(bess_base):
             primary_model_fit_max_iter=primary_model_fit_max_iter,  primary_model_fit_epsilon=primary_model_fit_epsilon,
             early_stop=early_stop, approximate_Newton=approximate_Newton,
             thread=thread,
+            parallel_exchange=parallel_exchange,
             sparse_matrix=sparse_matrix,
             splicing_type=splicing_type
         )
@@ -0,0 +1,86 @@
+import struct
+import numpy as np
+from abess.cabess import pywrap_mapped_open, pywrap_mapped_rows, pywrap_mapped_cols, pywrap_mapped_gather, pywrap_mapped_close
+
+# see MappedDesignHeader in src/MappedDesign.h
+_HEADER = struct.Struct("<8siiqqq24x")
+_MAGIC = b"ABESSX01"
+_PAGE = 4096
+
+
+def save_design(path, X, chunk_cols=256):
+    """
+    Write a design matrix to the binary file read by `MappedDesign`.
+
+    The columns are stored one after another (column-major) in float64, after a header
+    with the shape and the mean and centered norm of each column.
+
+    Parameters
+    ----------
+    path : str
+        The file to write.
+    X : array-like of shape (n_samples, n_features)
+        The design matrix. It is read `chunk_cols` columns at a time,
+        so a `numpy.memmap` larger than the memory can be converted.
+    chunk_cols : int, optional
+        The number of columns converted at a time.
+        Default: chunk_cols = 256.
+    """
+    n, p = X.shape
+    data_offset = (_HEADER.size + 16 * p + _PAGE - 1) // _PAGE * _PAGE
+    x_mean = np.zeros(p)
+    x_norm = np.zeros(p)
+    with open(path, "wb") as f:
+        f.seek(data_offset)
+        for start in range(0, p, chunk_cols):
+            chunk = np.asarray(X[:, start:start + chunk_cols], dtype=np.float64)
+            x_mean[start:start + chunk.shape[1]] = chunk.mean(axis=0)
+            x_norm[start:start + chunk.shape[1]] = np.sqrt(
+                ((chunk - chunk.mean(axis=0)) ** 2).sum(axis=0))
+            f.write(np.ascontiguousarray(chunk.T).tobytes())
+        f.seek(0)
+        f.write(_HEADER.pack(_MAGIC, 1, 0, n, p, data_offset))
+        f.write(x_mean.tobytes())
+        f.write(x_norm.tobytes())
+
+
+class MappedDesign:
+    """
+    A design matrix written by `save_design`, opened with mmap.
+
+    It can be passed to `fit` as X, and the model is fitted from the file: the sacrifices
+    X^T r are computed over the file block by block, and only the columns in use, such as
+    the active ones, are loaded into memory. `is_screening=True` further narrows the fit
+    to the screened columns, which stay on disk as well. PCA is not available.
+
+    Parameters
+    ----------
+    path : str
+        The file written by `save_design`.
+
+    Examples
+    --------
+    >>> save_design("X.bin", X)
+    >>> model = abessLm(support_size=range(0, 20))
+    >>> model.fit(MappedDesign("X.bin"), y)
+    """
+
+    def __init__(self, path):
+        self._handle = pywrap_mapped_open(str(path))
+        if self._handle is None:
+            raise ValueError("%s is not a design matrix written by save_design." % path)
+        self.shape = (pywrap_mapped_rows(self._handle), pywrap_mapped_cols(self._handle))
+
+    def gather(self, ind):
+        """Read the columns in `ind` (sorted) into a Fortran-ordered array."""
+        ind = np.asarray(ind, dtype=np.int32)
+        x = pywrap_mapped_gather(self._handle, ind, self.shape[0] * len(ind))
+        return x.reshape(len(ind), self.shape[0]).T
+
+    def close(self):
+        if getattr(self, "_handle", None) is not None:
+            pywrap_mapped_close(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
@@ -1,11 +1,16 @@
 import numpy as np
 from abess.linear import *
 from abess.gen_data import gen_data, gen_data_splicing
+from abess.mapped import MappedDesign, save_design
+from abess.genotype import GenotypeDesign
 import pandas as pd
 from pytest import approx
 import sys
+import os
+import tempfile
 from sklearn.model_selection import KFold
 from sklearn.model_selection import GridSearchCV
+from scipy.sparse import coo_matrix, csr_matrix, csc_matrix
 
 from sklearn.linear_model import LinearRegression
 from sklearn.linear_model import LogisticRegression
@@ -57,6 +62,113 @@ class TestClass:
                          primary_model_fit_max_iter=10, primary_model_fit_epsilon=1e-6, early_stop=False, approximate_Newton=True, ic_coef=1., thread=0, covariance_update=True)
         model4.fit(data.x, data.y)
 
+        # Fortran-ordered X is mapped without copy and should give the same fit
+        model5 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_screening=True, screening_size=20,
+                         K_max=10, epsilon=10, powell_path=2, s_min=1, s_max=p, lambda_min=0.01, lambda_max=100, is_cv=False, K=5,
+                         exchange_num=2, tau=0.1 * np.log(n*p) / n,
+                         primary_model_fit_max_iter=10, primary_model_fit_epsilon=1e-6, early_stop=False, approximate_Newton=True, ic_coef=1., thread=0, covariance_update=True)
+        model5.fit(np.asfortranarray(data.x), data.y)
+        assert model5.coef_ == approx(model4.coef_, rel=1e-10, abs=1e-10)
+
+        # scipy CSC, CSR and COO input should all give the same sparse fit
+        model6 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', sparse_matrix=True)
+        model6.fit(coo_matrix(data.x), data.y)
+        coef_coo = model6.coef_
+        model6.fit(csr_matrix(data.x), data.y)
+        assert model6.coef_ == approx(coef_coo, rel=1e-10, abs=1e-10)
+        model6.fit(csc_matrix(data.x), data.y)
+        assert model6.coef_ == approx(coef_coo, rel=1e-10, abs=1e-10)
+        # and so should a CSC with unsorted and duplicated row indices
+        x_csc = csc_matrix(data.x)
+        indices, values = [], []
+        for j in range(p):
+            rows = x_csc.indices[x_csc.indptr[j]:x_csc.indptr[j + 1]][::-1]
+            vals = x_csc.data[x_csc.indptr[j]:x_csc.indptr[j + 1]][::-1]
+            indices.append(np.repeat(rows, 2))
+            values.append(np.repeat(vals / 2, 2))
+        x_messy = csc_matrix((np.concatenate(values), np.concatenate(indices), 2 * x_csc.indptr), shape=data.x.shape)
+        assert not x_messy.has_canonical_format
+        model6.fit(x_messy, data.y)
+        assert model6.coef_ == approx(coef_coo, rel=1e-10, abs=1e-10)
+
+        model7 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5)
+        model7.fit(data.x, data.y, keep_session=True)
+        y2 = data.y + np.random.normal(0, 1, data.y.shape)
+        model7.set_params(support_size=range(0, s_max - 1))
+        model7.fit(data.x, y2, keep_session=True)
+        model8 = abessLm(path_type="seq", support_size=range(0, s_max - 1), ic_type='ebic', is_cv=True, K=5)
+        model8.fit(data.x, y2)
+        assert model7.coef_ == approx(model8.coef_, rel=1e-10, abs=1e-10)
+        assert model8.coef_path_.shape == (s_max - 1, 1, p)
+        best = np.argmin(model8.test_loss_path_[:, 0])
+        assert model8.coef_path_[best, 0] == approx(model8.coef_, rel=1e-10, abs=1e-10)
+        assert model8.intercept_path_[best] == approx(model8.intercept_, rel=1e-10, abs=1e-10)
+
+        # a design on disk is fitted out of core and gives the in-memory fit
+        model9 = abessLm(path_type="seq", support_size=range(0, 8), ic_type='ebic', is_screening=True, screening_size=10)
+        model9.fit(data.x, data.y)
+        model9_cv = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5)
+        model9_cv.fit(data.x, data.y)
+        with tempfile.TemporaryDirectory() as tmp:
+            save_design(os.path.join(tmp, "x.bin"), data.x, chunk_cols=7)
+            design = MappedDesign(os.path.join(tmp, "x.bin"))
+            model10 = abessLm(path_type="seq", support_size=range(0, 8), ic_type='ebic', is_screening=True, screening_size=10)
+            model10.fit(design, data.y)
+            model10_cv = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5)
+            model10_cv.fit(design, data.y)
+            design.close()
+        assert model10.coef_ == approx(model9.coef_, rel=1e-6, abs=1e-6)
+        assert model10.coef_path_.shape == (8, 1, p)
+        assert model10_cv.coef_ == approx(model9_cv.coef_, rel=1e-6, abs=1e-6)
+        assert model10_cv.intercept_ == approx(model9_cv.intercept_, rel=1e-6, abs=1e-6)
+
+        # a sparse X is normalized as the dense one, centering included
+        model11 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5, covariance_update=True)
+        model11.fit(data3.x, data3.y)
+        model12 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5, covariance_update=True, sparse_matrix=True)
+        model12.fit(csc_matrix(data3.x), data3.y)
+        assert model12.coef_ == approx(model11.coef_, rel=1e-6, abs=1e-6)
+        assert model12.intercept_ == approx(model11.intercept_, rel=1e-6, abs=1e-6)
+
+        # a float32 X is fitted in double on the active set
+        x_float = data.x.astype(np.float32)
+        model13 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5)
+        model13.fit(x_float.astype(np.float64), data.y)
+        model14 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5, dtype=np.float32)
+        model14.fit(x_float, data.y)
+        assert model14.coef_ == approx(model13.coef_, rel=1e-4, abs=1e-4)
+        assert model14.intercept_ == approx(model13.intercept_, rel=1e-4, abs=1e-4)
+
+        # packed genotypes are fitted as the same dense X, missing ones as the column mean
+        np.random.seed(2)
+        G = np.random.binomial(2, 0.3, size=(n, p)).astype(np.float64)
+        G[np.random.rand(n, p) < 0.01] = np.nan
+        G_dense = np.where(np.isnan(G), np.nanmean(G, axis=0), G)
+        y_geno = G_dense[:, :k].dot(np.ones(k)) + np.random.randn(n)
+        model15 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5)
+        model15.fit(G_dense, y_geno)
+        model16 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', is_cv=True, K=5)
+        model16.fit(GenotypeDesign(G, chunk_cols=7), y_geno)
+        assert model16.coef_ == approx(model15.coef_, rel=1e-8, abs=1e-8)
+        assert model16.intercept_ == approx(model15.intercept_, rel=1e-8, abs=1e-8)
+
+        # splicing within the groups of largest sacrifices finds the same support
+        model17 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', important_search=5)
+        model17.fit(data.x, data.y)
+        assert (np.nonzero(model17.coef_)[0] == np.nonzero(model4.coef_)[0]).all()
+
+        # groups far below the threshold at the previous support size are left out at the next one
+        model18 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', strong_rule=0.5)
+        model18.fit(data.x, data.y)
+        assert (np.nonzero(model18.coef_)[0] == np.nonzero(model4.coef_)[0]).all()
+        assert model18.pruned_size_path_.shape == (s_max, 1)
+        assert model18.pruned_size_path_.sum() > 0
+
+        model19 = abessLm(path_type="seq", support_size=range(0, s_max), ic_type='ebic', active_warm_start=True)
+        model19.fit(data.x, data.y)
+        assert (np.nonzero(model19.coef_)[0] == np.nonzero(model4.coef_)[0]).all()
+        assert model19.n_iter_path_.shape == (s_max, 1)
+
         nonzero_true = np.nonzero(data.coef_)[0]
         nonzero_fit = np.nonzero(model.coef_)[0]
         print(nonzero_true)
@@ -95,6 +207,32 @@ class TestClass:
         model2.fit(data.x, data.y, group=group)
         model2.predict(data.x)
 
+        model3 = abessLogistic(path_type="seq", support_size=support_size, ic_type='ebic', is_screening=True, screening_size=20,
+                               primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-6, approximate_Newton=False)
+        model3.fit(data.x, data.y)
+        model4 = abessLogistic(path_type="seq", support_size=support_size, ic_type='ebic', is_screening=True, screening_size=20,
+                               primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-6, approximate_Newton=False, sparse_matrix=True)
+        model4.fit(data.x, data.y)
+        assert model4.coef_ == approx(model3.coef_, rel=1e-4, abs=1e-4)
+
+        # the primary solvers reach the same fit
+        model5 = abessLogistic(support_size=[k], primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-10)
+        model5.fit(data.x, data.y)
+        for solver in ["diagonal", "lbfgs"]:
+            model6 = abessLogistic(support_size=[k], primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-10,
+                                   primary_solver=solver)
+            model6.fit(data.x, data.y)
+            assert model6.coef_ == approx(model5.coef_, rel=1e-2, abs=1e-2)
+            assert model6.n_primary_iter_path_.sum() > 0
+
+        # the exchanges fitted on the threads at once give the same fit
+        model7 = abessLogistic(support_size=support_size, thread=1)
+        model7.fit(data.x, data.y)
+        model8 = abessLogistic(support_size=support_size, thread=4, parallel_exchange=True)
+        model8.fit(data.x, data.y)
+        assert (np.nonzero(model8.coef_)[0] == np.nonzero(model7.coef_)[0]).all()
+        assert (model8.coef_ == model7.coef_).all()
+
         nonzero_true = np.nonzero(data.coef_)[0]
         nonzero_fit = np.nonzero(model2.coef_)[0]
         print(nonzero_true)
@@ -159,6 +297,52 @@ class TestClass:
             assert model2.coef_[nonzero_fit] == approx(
                 cph.params_.values, rel=5e-1, abs=5e-1)
 
+        # tied times, with the Efron approximation as in lifelines
+        y_tied = data.y.copy()
+        y_tied[:, 0] = np.ceil(y_tied[:, 0] * 4 / y_tied[:, 0].max())
+        model3 = abessCox(support_size=[k], ties="efron", primary_model_fit_epsilon=1e-10)
+        model3.fit(data.x, y_tied)
+        nonzero_fit = np.nonzero(model3.coef_)[0]
+        assert (nonzero_true == nonzero_fit).all()
+
+        # a single stratum is the unstratified model
+        model4 = abessCox(support_size=[k], ties="efron", primary_model_fit_epsilon=1e-10)
+        model4.fit(data.x, np.hstack((y_tied, np.zeros((n, 1)))))
+        assert model4.coef_ == approx(model3.coef_)
+
+        if sys.version_info[1] >= 6:
+            new_x = data.x[:, nonzero_fit]
+            survival = pd.DataFrame()
+            for i in range(new_x.shape[1]):
+                survival["Var" + str(i)] = new_x[:, i]
+            survival["T"] = y_tied[:, 0]
+            survival["E"] = y_tied[:, 1]
+            cph = CoxPHFitter(penalizer=0, l1_ratio=0)
+            cph.fit(survival, 'T', event_col='E')
+
+            assert model3.coef_[nonzero_fit] == approx(
+                cph.params_.values, rel=1e-4, abs=1e-4)
+
+            # two strata
+            strata = np.arange(n) % 2
+            model5 = abessCox(support_size=[k], ties="efron", primary_model_fit_epsilon=1e-10)
+            model5.fit(data.x, np.hstack((y_tied, strata.reshape(-1, 1))))
+            assert (nonzero_true == np.nonzero(model5.coef_)[0]).all()
+            survival["S"] = strata
+            cph = CoxPHFitter(penalizer=0, l1_ratio=0)
+            cph.fit(survival, 'T', event_col='E', strata=["S"])
+
+            assert model5.coef_[nonzero_fit] == approx(
+                cph.params_.values, rel=1e-4, abs=1e-4)
+
+        # the exchanges fitted on the threads at once give the same fit
+        model6 = abessCox(support_size=support_size, thread=1)
+        model6.fit(data.x, data.y)
+        model7 = abessCox(support_size=support_size, thread=4, parallel_exchange=True)
+        model7.fit(data.x, data.y)
+        assert (np.nonzero(model7.coef_)[0] == np.nonzero(model6.coef_)[0]).all()
+        assert (model7.coef_ == model6.coef_).all()
+
     def test_poisson(self):
         # to do
         n = 100
@@ -195,6 +379,20 @@ class TestClass:
         print(nonzero_fit)
         assert (nonzero_true == nonzero_fit).all()
 
+        # the primary solvers reach the same fit
+        model3 = abessPoisson(support_size=[k], primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-10)
+        model3.fit(data.x, data.y)
+        model4 = abessPoisson(support_size=[k], primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-10,
+                              primary_solver="lbfgs")
+        model4.fit(data.x, data.y)
+        assert model4.coef_ == approx(model3.coef_, rel=1e-2, abs=1e-2)
+        # the exchanges fitted in parallel keep the same L-BFGS memory
+        model5 = abessPoisson(support_size=[k], primary_solver="lbfgs", thread=4, parallel_exchange=True)
+        model5.fit(data.x, data.y)
+        model6 = abessPoisson(support_size=[k], primary_solver="lbfgs", thread=1)
+        model6.fit(data.x, data.y)
+        assert (model5.coef_ == model6.coef_).all()
+
         if sys.version_info[1] >= 6:
             new_x = data.x[:, nonzero_fit]
             reg = PoissonRegressor(
@@ -241,6 +439,14 @@ class TestClass:
         # assert model.coef_[nonzero_fit] == approx(reg.coef_, rel=1e-5, abs=1e-5)
         assert (nonzero_true == nonzero_fit).all()
 
+        # the sparse X is centered inside the fit, without a dense copy
+        model3 = abessMultigaussian(path_type="seq", support_size=support_size, ic_type='ebic', covariance_update=False)
+        model3.fit(data.x, data.y)
+        model4 = abessMultigaussian(path_type="seq", support_size=support_size, ic_type='ebic', covariance_update=False, sparse_matrix=True)
+        model4.fit(csc_matrix(data.x), data.y)
+        assert model4.coef_ == approx(model3.coef_, rel=1e-6, abs=1e-6)
+        assert model4.intercept_ == approx(model3.intercept_, rel=1e-6, abs=1e-6)
+
     def test_mulnomial(self):
         n = 100
         p = 20
@@ -274,6 +480,14 @@ class TestClass:
         group = np.linspace(1, p, p)
         model3.fit(data.x, data.y, group=group)
 
+        # the coefficients are only determined up to a shift of the classes, so compare the losses
+        model4 = abessMultinomial(support_size=[k], primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-10)
+        model4.fit(data.x, data.y)
+        model5 = abessMultinomial(support_size=[k], primary_model_fit_max_iter=80, primary_model_fit_epsilon=1e-10,
+                                  primary_solver="lbfgs")
+        model5.fit(data.x, data.y)
+        assert model5.train_loss_ == approx(model4.train_loss_, rel=1e-2, abs=1e-2)
+
         nonzero_true = np.nonzero(data.coef_)[0]
         nonzero_fit = np.nonzero(model.coef_)[0]
         print(nonzero_true)
@@ -20,7 +20,8 @@ if sys.platform.startswith('win32'):
                                        CURRENT_DIR + '/src/normalize.cpp', CURRENT_DIR + '/src/abess.i',
                                        CURRENT_DIR + '/src/Algorithm.cpp', CURRENT_DIR + '/src/Data.cpp',
                                        CURRENT_DIR + '/src/Metric.cpp', CURRENT_DIR + '/src/path.cpp',
-                                       CURRENT_DIR + '/src/screening.cpp', CURRENT_DIR + '/src/model_fit.cpp'],
+                                       CURRENT_DIR + '/src/screening.cpp', CURRENT_DIR + '/src/model_fit.cpp',
+                                       CURRENT_DIR + '/src/MappedDesign.cpp', CURRENT_DIR + '/src/GenotypeMatrix.cpp'],
                               language='c++',
                               extra_compile_args=["-DNDEBUG", "-fopenmp", "-O2", "-Wall", "-mavx", "-mfma", "-march=native",
                                                   "-std=c++11", "-mtune=generic", "-D%s" % os_type, path1, path2],
@@ -39,7 +40,8 @@ elif sys.platform.startswith('darwin'):
                                        CURRENT_DIR + '/src/normalize.cpp', CURRENT_DIR + '/src/abess.i',
                                        CURRENT_DIR + '/src/Algorithm.cpp', CURRENT_DIR + '/src/Data.cpp',
                                        CURRENT_DIR + '/src/Metric.cpp', CURRENT_DIR + '/src/path.cpp',
-                                       CURRENT_DIR + '/src/screening.cpp', CURRENT_DIR + '/src/model_fit.cpp'],
+                                       CURRENT_DIR + '/src/screening.cpp', CURRENT_DIR + '/src/model_fit.cpp',
+                                       CURRENT_DIR + '/src/MappedDesign.cpp', CURRENT_DIR + '/src/GenotypeMatrix.cpp'],
                               language='c++',
                               extra_compile_args=[
                                   "-DNDEBUG", "-O2", "-Wall", "-std=c++11", "-mavx", "-mfma", "-march=native"],
@@ -55,7 +57,8 @@ else:
                                        CURRENT_DIR + '/src/normalize.cpp', CURRENT_DIR + '/src/abess.i',
                                        CURRENT_DIR + '/src/Algorithm.cpp', CURRENT_DIR + '/src/Data.cpp',
                                        CURRENT_DIR + '/src/Metric.cpp', CURRENT_DIR + '/src/path.cpp',
-                                       CURRENT_DIR + '/src/screening.cpp', CURRENT_DIR + '/src/model_fit.cpp'],
+                                       CURRENT_DIR + '/src/screening.cpp', CURRENT_DIR + '/src/model_fit.cpp',
+                                       CURRENT_DIR + '/src/MappedDesign.cpp', CURRENT_DIR + '/src/GenotypeMatrix.cpp'],
                               language='c++',
                               extra_compile_args=[
                                   "-DNDEBUG", "-fopenmp", "-O2", "-Wall", "-std=c++11", "-mavx", "-mfma", "-march=native"],
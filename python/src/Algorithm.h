@@ -17,6 +17,7 @@
 #include "model_fit.h"
 #include <iostream>
 
+#include <chrono>
 #include <time.h>
 #include <cfloat>
 
@@ -25,10 +26,44 @@ using namespace Spectra;
 
 bool quick_sort_pair_max(std::pair<int, double> x, std::pair<int, double> y);
 
+// The buffers of the primary fits and sacrifice(), kept by an Algorithm and reused through the splicing loop.
+// They are resized to what each use needs, which does not allocate when the size is the one of the last use,
+// as is the case while the support size stays the same.
+template <class T2, class T5>
+struct Workspace
+{
+  // the active columns with the constant column
+  T5 X;
+  Eigen::VectorXd one;
+  Eigen::VectorXd W;
+  Eigen::VectorXd Z;
+
+  Eigen::VectorXd &ones(int n)
+  {
+    if (this->one.size() != n)
+      this->one = Eigen::VectorXd::Ones(n);
+    return this->one;
+  }
+
+  // the columns of a group, those weighted, and the matrices of the group
+  T5 XG;
+  T5 XG_new;
+  Eigen::MatrixXd XGbar;
+  Eigen::MatrixXd phiG;
+  Eigen::MatrixXd invphiG;
+
+  T2 betabar;
+  T2 dbar;
+
+  // the iterations and seconds of the primary fits on this workspace, see Algorithm::primary_stats()
+  int primary_iter = 0;
+  double primary_time = 0;
+};
+
 //  T1 for y, XTy, XTone
 //  T2 for beta
 //  T3 for coef0
-//  T4 for X
+//  T4 for X, T5 for its active columns (see ActiveDesign)
 //  <Eigen::VectorXd, Eigen::VectorXd, double, Eigen::MatrixXd> for Univariate Dense
 //  <Eigen::VectorXd, Eigen::VectorXd, double, Eigen::SparseMatrix<double> > for Univariate Sparse
 //  <Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, Eigen::MatrixXd> for Multivariable Dense
@@ -37,7 +72,10 @@ template <class T1, class T2, class T3, class T4>
 class Algorithm
 {
 public:
-  int l;
+  typedef typename ActiveDesign<T4>::type T5;
+
+  // the splicing iterations of the last fit()
+  int l = 0;
   int model_fit_max;
   int model_type;
   int algorithm_type;
@@ -45,10 +83,15 @@ public:
   int group_df = 0;
   int sparsity_level = 0;
   double lambda_level = 0;
+  // the sorted rows of X that fit() uses, all of them if it is empty: a cross validation fold
+  // is fitted on the full design, and only the columns it needs are gathered from its rows
   Eigen::VectorXi train_mask;
   int max_iter;
   int exchange_num;
   bool warm_start;
+  // if true, a nonempty A_init is grown or shrunk to the support size by the sacrifices in bd_init,
+  // instead of taking the groups of the largest sacrifices, see inital_screening()
+  bool active_warm_start = false;
   T2 beta;
   Eigen::VectorXd bd;
   T3 coef0;
@@ -64,9 +107,12 @@ public:
 
   Eigen::Matrix<Eigen::MatrixXd, -1, -1> PhiG;
   Eigen::Matrix<Eigen::MatrixXd, -1, -1> invPhiG;
-  Eigen::Matrix<T4, -1, -1> group_XTX;
+  Eigen::Matrix<Eigen::MatrixXd, -1, -1> group_XTX;
   bool lambda_change;
 
+  // the centering of a sparse x, see Data::x_center
+  Eigen::VectorXd x_center;
+
   Eigen::VectorXi always_select;
   double tau;
   int primary_model_fit_max_iter;
@@ -76,24 +122,65 @@ public:
   T2 beta_warmstart;
   T3 coef0_warmstart;
 
+  // for cox, the keys of cox_risk_sets() of the sorted samples; without ties and strata it is not of length n
   Eigen::VectorXi status;
+  // for cox, 0 for the Breslow and 1 for the Efron approximation of tied times
+  int cox_ties = 0;
 
-  Eigen::MatrixXd cox_hessian;
+  // the h and g of cox_derivatives() at the last fit
+  CoxHessian cox_hessian;
   Eigen::VectorXd cox_g;
 
+  // the solver of the logistic, poisson and multinomial primary fits: 0 for Newton, 1 for Newton with
+  // the diagonal of the Hessian, 2 for L-BFGS
+  int primary_solver = 0;
+  // the curvature pairs the L-BFGS fits start from, and those of the exchanges fitted at once, by slot
+  LbfgsMemory lbfgs_memory;
+  std::vector<LbfgsMemory> exchange_lbfgs;
+
   bool covariance_update;
   Eigen::MatrixXd covariance;
   Eigen::VectorXi covariance_update_flag;
   T1 XTy;
   T1 XTone;
 
-  Eigen::VectorXi U1;
-
   double effective_number;
 
   int splicing_type;
   Eigen::MatrixXd Sigma;
 
+  // the active columns X_seg(X, train_mask, active_ind) of the design being fitted, kept through fit()
+  // and updated by moving the columns that stay and reading only the ones that enter
+  T5 active_X;
+  Eigen::VectorXi active_ind;
+
+  // the active set of fit() and its complement, and those it has met
+  IndexSet active_set;
+  IndexSetHistory active_history;
+  // the workspace of min_k() and max_k()
+  Eigen::VectorXi order;
+  // the entries (rows) of beta that may be nonzero in fit()
+  Eigen::VectorXi beta_support;
+
+  // the number of exchanges of get_A() that are fitted at once, each on its own thread
+  int splicing_threads = 1;
+
+  // the number of inactive groups get_A() splices from, all of them if it is 0, see SplicingAlgorithm::fit()
+  int important_search = 0;
+  // if positive, the inactive groups whose sacrifice is below strong_rule times the smallest active one
+  // are left out of the splicing as well; pruned_size is the number left out by either when fit() starts
+  double strong_rule = 0;
+  int pruned_size = 0;
+  // the active groups with the inactive ones of the largest sacrifices, and their
+  // columns X_seg(X, train_mask, working_ind) with the centering working_center; working_ind is empty out of it
+  IndexSet working_set;
+  Eigen::VectorXi working_ind;
+  T5 working_X;
+  Eigen::VectorXd working_center;
+
+  // one per exchange fitted at once, the first one is also that of the other fits
+  std::vector<Workspace<T2, T5>> workspaces;
+
   Algorithm() = default;
 
   virtual ~Algorithm(){};
@@ -146,9 +233,40 @@ public:
 
   void update_train_mask(Eigen::VectorXi &train_mask) { this->train_mask = train_mask; }
 
+  // the number of rows of X fitted, see train_mask
+  int train_rows(T4 &X) { return this->train_mask.size() == 0 ? X.rows() : this->train_mask.size(); }
+
   void update_exchange_num(int exchange_num) { this->exchange_num = exchange_num; }
 
-  void update_group_XTX(Eigen::Matrix<T4, -1, -1> &group_XTX) { this->group_XTX = group_XTX; }
+  void update_group_XTX(Eigen::Matrix<Eigen::MatrixXd, -1, -1> &group_XTX) { this->group_XTX = group_XTX; }
+
+  T5 &update_active_X(T4 &X, int n, Eigen::VectorXi &A_ind)
+  {
+    if (this->active_X.rows() != n || A_ind.size() != this->active_ind.size() || A_ind != this->active_ind)
+    {
+      X_seg_update(X, this->train_mask, A_ind, this->active_ind, this->active_X, this->active_X);
+      this->active_ind = A_ind;
+    }
+    return this->active_X;
+  }
+
+  // the centering of the columns ind of x, empty if they need none
+  Eigen::VectorXd center_of(Eigen::VectorXi &ind)
+  {
+    Eigen::VectorXd center;
+    if (this->x_center.size() != 0)
+      slice(this->x_center, ind, center);
+    return center;
+  }
+
+  // that of the columns of a fit on the groups A, X_seg(X, train_mask, find_ind(A, ...)), which are not centered themselves
+  Eigen::VectorXd fit_center(Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  {
+    if (this->x_center.size() == 0)
+      return Eigen::VectorXd();
+    Eigen::VectorXi ind = find_ind(A, g_index, g_size, this->x_center.size(), g_index.size());
+    return this->center_of(ind);
+  }
 
   bool get_warm_start() { return this->warm_start; }
 
@@ -172,10 +290,192 @@ public:
 
   int get_l() { return this->l; }
 
+  Workspace<T2, T5> &workspace(int slot = 0)
+  {
+    if (slot >= (int)this->workspaces.size())
+      this->workspaces.resize(slot + 1);
+    return this->workspaces[slot];
+  }
+
+  // the splicing for the current sparsity and lambda levels, see SplicingAlgorithm::fit()
+  virtual void fit(T4 &train_x, T1 &train_y, Eigen::VectorXd &train_weight, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int train_n, int p, int N, Eigen::VectorXi &status, Eigen::MatrixXd sigma) = 0;
+
+  // beta with the coefficients beta_A on A_ind and zero elsewhere, clearing only the previous support
+  void restore_beta(T2 &beta_A, Eigen::VectorXi &A_ind, T2 &beta)
+  {
+    slice_restore(beta_A, A_ind, beta, this->beta_support);
+    this->beta_support = A_ind;
+  }
+
+  // the iterations and seconds of the primary fits since the last call
+  void primary_stats(int &iter, double &time)
+  {
+    iter = 0;
+    time = 0;
+    for (unsigned int i = 0; i < this->workspaces.size(); i++)
+    {
+      iter += this->workspaces[i].primary_iter;
+      time += this->workspaces[i].primary_time;
+      this->workspaces[i].primary_iter = 0;
+      this->workspaces[i].primary_time = 0;
+    }
+  }
+
+  void count_primary_fit(int slot, int iter, std::chrono::steady_clock::time_point start)
+  {
+    Workspace<T2, T5> &ws = this->workspace(slot);
+    ws.primary_iter += iter;
+    ws.primary_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // fits coef, with M coefficients on each column of the groups A, by the primary_solver 1 or 2
+  template <class F>
+  int solver_fit(F &f, Eigen::VectorXd &coef, int M, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, LbfgsMemory &memory, double loss0)
+  {
+    if (this->primary_solver == 1)
+      return diagonal_newton_fit(f, coef, this->primary_model_fit_max_iter, this->primary_model_fit_epsilon, loss0, this->tau);
+
+    Eigen::VectorXi col = fit_columns(A, g_index, g_size);
+    if (col.size() * M != coef.size())
+    {
+      memory = LbfgsMemory();
+      col = Eigen::VectorXi::LinSpaced(coef.size() / M, -1, coef.size() / M - 2);
+    }
+    lbfgs_restrict(memory, col, M);
+    return lbfgs_fit(f, coef, memory, this->primary_model_fit_max_iter, this->primary_model_fit_epsilon, loss0, this->tau);
+  }
+
+  // a workspace for each exchange fitted at once, with the n-vectors sized
+  void reserve_workspaces(int n)
+  {
+    this->workspaces.resize(max(this->splicing_threads, 1));
+    for (unsigned int i = 0; i < this->workspaces.size(); i++)
+    {
+      Workspace<T2, T5> &ws = this->workspaces[i];
+      ws.ones(n);
+      ws.W.resize(n);
+      ws.Z.resize(n);
+    }
+  }
+
+  // X^T r for sacrifice(), only on the columns of the working set while there is one
+  Eigen::VectorXd XTr_working(T4 &X, const Eigen::VectorXd &r)
+  {
+    if (this->working_ind.size() == 0)
+      return XTr(X, this->train_mask, r, this->x_center);
+    Eigen::VectorXd result = Eigen::VectorXd::Zero(X.cols());
+    Eigen::VectorXd result_working = XTr(this->working_X, r, this->working_center);
+    for (int k = 0; k < this->working_ind.size(); k++)
+    {
+      result(this->working_ind(k)) = result_working(k);
+    }
+    return result;
+  }
+
+  Eigen::MatrixXd XTr_working(T4 &X, const Eigen::MatrixXd &r)
+  {
+    if (this->working_ind.size() == 0)
+      return XTr(X, this->train_mask, r, this->x_center);
+    Eigen::MatrixXd result = Eigen::MatrixXd::Zero(X.cols(), r.cols());
+    Eigen::MatrixXd result_working = XTr(this->working_X, r, this->working_center);
+    for (int k = 0; k < this->working_ind.size(); k++)
+    {
+      result.row(this->working_ind(k)) = result_working.row(k);
+    }
+    return result;
+  }
+
+  // betabar_G = phiG beta_G for the groups G in A and dbar_G = phiG^-1 d_G for those in I, in workspace(),
+  // with phiG = (X_G^T diag(h) X_G + 2 lambda I)^(1/2) for the centered columns X_G
+  void group_bar(T4 &X, Eigen::VectorXd &h, Eigen::VectorXd &beta, Eigen::VectorXd &d, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  {
+    Workspace<T2, T5> &ws = this->workspace();
+    ws.betabar.setZero(X.cols());
+    ws.dbar.setZero(X.cols());
+    double h_sum = h.sum();
+    int A_size = A.size();
+    for (int k = 0; k < A_size + I.size(); k++)
+    {
+      int i = k < A_size ? A(k) : I(k - A_size);
+      X_cols(X, this->train_mask, g_index(i), g_size(i), ws.XG);
+      ws.XG_new = ws.XG;
+      for (int j = 0; j < g_size(i); j++)
+      {
+        ws.XG_new.col(j) = ws.XG.col(j).cwiseProduct(h);
+      }
+      ws.XGbar = ws.XG_new.transpose() * ws.XG;
+      if (this->x_center.size() != 0)
+      {
+        Eigen::VectorXd XGTh = ws.XG.transpose() * h;
+        Eigen::VectorXd center = this->x_center.segment(g_index(i), g_size(i));
+        center_XTHX(ws.XGbar, XGTh, h_sum, center);
+      }
+      ws.XGbar += 2 * this->lambda_level * Eigen::MatrixXd::Identity(g_size(i), g_size(i));
+
+      matrix_sqrt_inverse(ws.XGbar, ws.phiG, ws.invphiG);
+      if (k < A_size)
+        ws.betabar.segment(g_index(i), g_size(i)).noalias() = ws.phiG * beta.segment(g_index(i), g_size(i));
+      else
+        ws.dbar.segment(g_index(i), g_size(i)).noalias() = ws.invphiG * d.segment(g_index(i), g_size(i));
+    }
+  }
+
+  virtual double neg_loglik_loss(T5 &X, T1 &y, Eigen::VectorXd &weights, T2 &beta, T3 &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size) = 0;
+
+  virtual void sacrifice(T4 &X, T5 &XA, T1 &y, T2 &beta, T2 &beta_A, T3 &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd) = 0;
+
+  virtual void primary_model_fit(T5 &X, T1 &y, Eigen::VectorXd &weights, T2 &beta, T3 &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size) = 0;
+
+  virtual double effective_number_of_parameter(T4 &X, T5 &XA, T1 &y, Eigen::VectorXd &weights, T2 &beta, T2 &beta_A, T3 &coef0) = 0;
+
+  // A model can fit the exchanges of get_A() by updating what it has for the active set A_ind,
+  // instead of gathering their columns and refitting: splicing_base() is called once with the active set,
+  // and returns false if it is not done, then splicing_trial() gives the fit and loss of each exchange,
+  // or returns false to have it refitted.
+  virtual bool splicing_base(T4 &X, T5 &XA, T1 &y, Eigen::VectorXi &A_ind) { return false; };
+
+  virtual bool splicing_trial(T4 &X, T5 &XA, T1 &y, Eigen::VectorXi &A_ind, Eigen::VectorXi &A_ind_exchange, T2 &beta_A, T3 &coef0, double &loss) { return false; };
+
+  // The exchanges of get_A() are fitted in slots 0, 1, ..., slots - 1 (one at a time when sequential), and exchange_fit() is
+  // the primary_model_fit() of one of them, which may use workspace(slot). A model that keeps state from its fits sets it aside by slot,
+  // and exchange_keep() takes that of the accepted slot, or of the last slot the sequential get_A() would have fitted.
+  // By default that is the L-BFGS memory, kept only from an accepted exchange, so that every exchange of a splicing step
+  // starts from the same lbfgs_memory whatever splicing_threads is.
+  virtual void exchange_slots(int slots)
+  {
+    this->exchange_lbfgs.assign(slots, this->lbfgs_memory);
+  };
+
+  virtual void exchange_fit(T5 &X, T1 &y, Eigen::VectorXd &weights, T2 &beta, T3 &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot)
+  {
+    this->primary_model_fit(X, y, weights, beta, coef0, loss0, A, g_index, g_size);
+  };
+
+  virtual void exchange_keep(int slot, bool accepted)
+  {
+    if (accepted)
+      std::swap(this->lbfgs_memory, this->exchange_lbfgs[slot]);
+  };
+};
+
+// The splicing of Algorithm for the model Derived, which is called without virtual dispatch:
+// Derived is the final class of the model, so that the calls through model() are resolved at compile time
+// and only fit() is virtual, for the path and the metric that hold an Algorithm.
+template <class Derived, class T1, class T2, class T3, class T4>
+class SplicingAlgorithm : public Algorithm<T1, T2, T3, T4>
+{
+public:
+  typedef typename ActiveDesign<T4>::type T5;
+
+  using Algorithm<T1, T2, T3, T4>::Algorithm;
+
+  Derived &model() { return static_cast<Derived &>(*this); }
+
   void fit(T4 &train_x, T1 &train_y, Eigen::VectorXd &train_weight, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int train_n, int p, int N, Eigen::VectorXi &status, Eigen::MatrixXd sigma)
   {
     // std::cout << "fit" << endl;
     int T0 = this->sparsity_level;
+    this->reserve_workspaces(train_n);
     this->status = status;
     this->cox_g = Eigen::VectorXd::Zero(0);
 
@@ -184,11 +484,20 @@ public:
     this->beta = this->beta_init;
     this->coef0 = this->coef0_init;
     this->bd = this->bd_init;
+    this->beta_support = nonzero_ind(this->beta);
+    this->pruned_size = 0;
+    this->l = 0;
 
     if (this->model_type == 7)
     {
-      if (sigma.cols() == 1 && sigma(0, 0) == -1)
-        this->Sigma = train_x.transpose() * train_x;
+      if (sigma.cols() == 1 && sigma(0, 0) == -1 && this->train_mask.size() != 0)
+      {
+        Eigen::VectorXi all_ind = Eigen::VectorXi::LinSpaced(p, 0, p - 1);
+        T5 X = X_seg(train_x, this->train_mask, all_ind);
+        this->Sigma = XTX_full(X);
+      }
+      else if (sigma.cols() == 1 && sigma(0, 0) == -1)
+        this->Sigma = XTX_full(train_x);
       else
         this->Sigma = sigma;
     }
@@ -196,8 +505,11 @@ public:
     if (N == T0)
     {
       this->A_out = Eigen::VectorXi::LinSpaced(N, 0, N - 1);
-      this->primary_model_fit(train_x, train_y, train_weight, this->beta, this->coef0, DBL_MAX, this->A_out, g_index, g_size);
-      this->train_loss = neg_loglik_loss(train_x, train_y, train_weight, this->beta, this->coef0, this->A_out, g_index, g_size);
+      this->active_set.assign(this->A_out, N);
+      Eigen::VectorXi all_ind = Eigen::VectorXi::LinSpaced(p, 0, p - 1);
+      T5 X = X_seg(train_x, this->train_mask, all_ind);
+      this->model().primary_model_fit(X, train_y, train_weight, this->beta, this->coef0, DBL_MAX, this->A_out, g_index, g_size);
+      this->train_loss = this->model().neg_loglik_loss(X, train_y, train_weight, this->beta, this->coef0, this->A_out, g_index, g_size);
       return;
     }
 
@@ -211,7 +523,7 @@ public:
       if ((this->algorithm_type == 6 && this->PhiG.rows() == 0) || this->lambda_change)
       {
         this->PhiG = Phi(train_x, g_index, g_size, train_n, p, N, this->lambda_level, this->group_XTX);
-        this->invPhiG = invPhi(PhiG, N);
+        this->invPhiG = invPhi(this->PhiG, N);
       }
     }
 
@@ -228,18 +540,21 @@ public:
     // input: this->beta_init, this->coef0_init, this->A_init, this->I_init
     // for splicing get A;for the others 0;
     // std::cout << "fit 2" << endl;
-    Eigen::VectorXi A = inital_screening(train_x, train_y, this->beta, this->coef0, this->A_init, this->I_init, this->bd, train_weight, g_index, g_size, N);
+    this->active_ind = Eigen::VectorXi::Zero(0);
+    this->active_X.resize(0, 0);
+    IndexSet &active = this->active_set;
+    active.assign(inital_screening(train_x, train_y, this->beta, this->coef0, this->A_init, this->I_init, this->bd, train_weight, g_index, g_size, N), N);
+    Eigen::VectorXi &A = active.A;
 #ifdef TEST
     t2 = clock();
     std::cout << "init screening time" << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
 #endif
 
     // std::cout << "fit 3" << endl;
-    Eigen::VectorXi I = Ac(A, N);
-    Eigen::MatrixXi A_list(T0, max_iter + 2);
-    A_list.col(0) = A;
+    this->active_history.clear();
+    this->active_history.seen(active);
+    Eigen::VectorXi A_last;
 
-    T4 X_A;
     T2 beta_A;
     Eigen::VectorXi A_ind;
 
@@ -250,10 +565,10 @@ public:
     if (this->algorithm_type == 6)
     {
       A_ind = find_ind(A, g_index, g_size, p, N);
-      X_A = X_seg(train_x, train_n, A_ind);
+      T5 &X_A = this->update_active_X(train_x, train_n, A_ind);
       slice(this->beta, A_ind, beta_A);
-      this->primary_model_fit(X_A, train_y, train_weight, beta_A, this->coef0, DBL_MAX, A, g_index, g_size);
-      slice_restore(beta_A, A_ind, this->beta);
+      this->model().primary_model_fit(X_A, train_y, train_weight, beta_A, this->coef0, DBL_MAX, A, g_index, g_size);
+      this->restore_beta(beta_A, A_ind, this->beta);
     }
 
     this->beta_warmstart = this->beta;
@@ -267,44 +582,53 @@ public:
     // std::cout << "fit 6" << endl;
     int C_max = min(min(T0, N - T0), this->exchange_num);
 
-    for (this->l = 1; this->l <= this->max_iter; l++)
+    // get_A() splices within the working set, which is checked against all the groups once it settles
+    int U_size = this->working_size(active, C_max);
+    if (T0 + U_size < N)
+    {
+      this->update_working_set(train_x, active, U_size, g_index, g_size, N);
+      this->pruned_size = N - T0 - U_size;
+    }
+
+    for (this->l = 1; this->l <= this->max_iter; this->l++)
     {
 #ifdef TEST
       std::cout << "fit 7" << endl;
 #endif
-      this->get_A(train_x, train_y, A, I, C_max, this->beta, this->coef0, this->bd, T0, train_weight, g_index, g_size, N, this->tau, this->train_loss);
+      A_last = A;
+      this->get_A(train_x, train_y, active, C_max, this->beta, this->coef0, this->bd, T0, train_weight, g_index, g_size, N, this->tau, this->train_loss);
 #ifdef TEST
       t2 = clock();
       std::cout << "get A" << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
 #endif
 
-      A_list.col(this->l) = A;
       // std::cout << "fit 8" << endl;
 
       if (this->algorithm_type != 6)
       {
         A_ind = find_ind(A, g_index, g_size, p, N);
-        X_A = X_seg(train_x, train_n, A_ind);
+        T5 &X_A = this->update_active_X(train_x, train_n, A_ind);
         slice(this->beta, A_ind, beta_A);
-        this->primary_model_fit(X_A, train_y, train_weight, beta_A, this->coef0, DBL_MAX, A, g_index, g_size);
-        slice_restore(beta_A, A_ind, this->beta);
-        for (int ll = 0; ll < this->l; ll++)
+        this->model().primary_model_fit(X_A, train_y, train_weight, beta_A, this->coef0, DBL_MAX, A, g_index, g_size);
+        this->restore_beta(beta_A, A_ind, this->beta);
+        if (this->active_history.seen(active))
         {
-          if (A == A_list.col(ll))
+          if (this->working_ind.size() != 0 && this->extend_working_set(train_x, train_y, active, C_max, train_weight, g_index, g_size, N))
+            continue;
+          this->group_df = 0;
+          for (unsigned int i = 0; i < A.size(); i++)
           {
-            this->group_df = 0;
-            for (unsigned int i = 0; i < A.size(); i++)
-            {
-              this->group_df = this->group_df + g_size(A(i));
-            }
-            return;
+            this->group_df = this->group_df + g_size(A(i));
           }
+          return;
         }
       }
       else
       {
-        if (A == A_list.col(this->l - 1))
+        if (A == A_last)
         {
+          if (this->working_ind.size() != 0 && this->extend_working_set(train_x, train_y, active, C_max, train_weight, g_index, g_size, N))
+            continue;
 #ifdef TEST
           std::cout << "------------iter time: ----------" << this->l << endl;
           t2 = clock();
@@ -316,13 +640,13 @@ public:
           this->A_out = A;
 
           A_ind = find_ind(A, g_index, g_size, p, N);
-          X_A = X_seg(train_x, train_n, A_ind);
+          T5 &X_A = this->update_active_X(train_x, train_n, A_ind);
           slice(this->beta, A_ind, beta_A);
           // cout << "A: " << endl;
           // cout << A << endl;
           // cout << "beta" << endl;
           // cout << beta_A << endl;
-          this->effective_number = effective_number_of_parameter(train_x, X_A, train_y, train_weight, this->beta, beta_A, this->coef0);
+          this->effective_number = this->model().effective_number_of_parameter(train_x, X_A, train_y, train_weight, this->beta, beta_A, this->coef0);
 
           this->group_df = A_ind.size();
           // for (unsigned int i = 0; i < A.size(); i++)
@@ -337,13 +661,124 @@ public:
         }
       }
     }
+
+    this->l = this->max_iter;
+    if (this->working_ind.size() != 0)
+    {
+      this->leave_working_set(train_x, train_y, active, train_weight, g_index, g_size, N);
+    }
   };
 
-  void get_A(T4 &X, T1 &y, Eigen::VectorXi &A, Eigen::VectorXi &I, int &C_max, T2 &beta, T3 &coef0, Eigen::VectorXd &bd, int T0, Eigen::VectorXd &weights,
+  // the number of inactive groups of the working set, N - T0 for all of them
+  int working_size(IndexSet &active, int C_max)
+  {
+    Eigen::VectorXi &A = active.A;
+    Eigen::VectorXi &I = active.I;
+    int U_size = I.size();
+    // the sacrifices at the last support size of the path rank the groups at this one
+    if (this->strong_rule > 0 && A.size() > 0)
+    {
+      double threshold = DBL_MAX;
+      for (int i = 0; i < A.size(); i++)
+      {
+        threshold = min(threshold, this->bd(A(i)));
+      }
+      threshold *= this->strong_rule;
+      U_size = 0;
+      for (int i = 0; i < I.size(); i++)
+      {
+        if (this->bd(I(i)) >= threshold)
+          U_size++;
+      }
+    }
+    if (this->important_search > 0)
+      U_size = min(U_size, this->important_search);
+    return min(max(U_size, C_max), (int)I.size());
+  }
+
+  // the working set of A and the U_size inactive groups with the largest sacrifices in bd
+  void update_working_set(T4 &X, IndexSet &active, int U_size, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N)
+  {
+    Eigen::VectorXi &I = active.I;
+    Eigen::VectorXd bd_I(I.size());
+    for (int i = 0; i < I.size(); i++)
+    {
+      bd_I(i) = this->bd(I(i));
+    }
+    Eigen::VectorXi I_max_k = max_k(bd_I, U_size, false, this->order);
+    Eigen::VectorXi U(active.A.size() + U_size);
+    U << active.A, vector_slice(I, I_max_k);
+    std::sort(U.data(), U.data() + U.size());
+    this->working_set.assign(U, N);
+
+    this->working_ind = find_ind(U, g_index, g_size, X.cols(), N);
+    this->working_X = X_seg(X, this->train_mask, this->working_ind);
+    this->working_center = this->center_of(this->working_ind);
+  }
+
+  // bd of all the groups, out of the working set
+  void leave_working_set(T4 &X, T1 &y, IndexSet &active, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N)
+  {
+    this->working_ind.resize(0);
+    this->working_X.resize(0, 0);
+    Eigen::VectorXi A_ind = find_ind(active.A, g_index, g_size, X.cols(), N);
+    T5 &X_A = this->update_active_X(X, this->train_rows(X), A_ind);
+    T2 beta_A;
+    slice(this->beta, A_ind, beta_A);
+    this->bd = Eigen::VectorXd::Zero(N);
+    this->model().sacrifice(X, X_A, y, this->beta, beta_A, this->coef0, active.A, active.I, weights, g_index, g_size, N, A_ind, this->bd);
+  }
+
+  // Once the splicing settles in the working set, it is done if the C_max inactive groups of the largest
+  // sacrifices among all are in the working set: get_A() would try the same exchanges without it.
+  // Otherwise the working set is taken again from all the groups, unless it would hold them all, and the splicing goes on.
+  bool extend_working_set(T4 &X, T1 &y, IndexSet &active, int C_max, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N)
+  {
+    this->leave_working_set(X, y, active, weights, g_index, g_size, N);
+
+    Eigen::VectorXi &I = active.I;
+    Eigen::VectorXd bd_I(I.size());
+    for (int i = 0; i < I.size(); i++)
+    {
+      bd_I(i) = this->bd(I(i));
+    }
+    Eigen::VectorXi I_max_k = max_k(bd_I, C_max, false, this->order);
+    bool settled = true;
+    for (int i = 0; i < I_max_k.size(); i++)
+    {
+      if (!this->working_set.contains(I(I_max_k(i))))
+        settled = false;
+    }
+    if (settled)
+      return false;
+
+    int U_size = this->working_size(active, C_max);
+    if (active.A.size() + U_size < N)
+      this->update_working_set(X, active, U_size, g_index, g_size, N);
+    this->active_history.clear();
+    this->active_history.seen(active);
+    return true;
+  }
+
+  void get_A(T4 &X, T1 &y, IndexSet &active, int &C_max, T2 &beta, T3 &coef0, Eigen::VectorXd &bd, int T0, Eigen::VectorXd &weights,
              Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, double tau, double &train_loss)
   {
     int p = X.cols();
-    int n = X.rows();
+    int n = this->train_rows(X);
+    Eigen::VectorXi &A = active.A;
+    Eigen::VectorXi I_working;
+    if (this->working_ind.size() != 0)
+    {
+      // the inactive groups of the working set
+      Eigen::VectorXi &U = this->working_set.A;
+      I_working.resize(U.size() - A.size());
+      for (int i = 0, k = 0; i < U.size(); i++)
+      {
+        if (!active.contains(U(i)))
+          I_working(k++) = U(i);
+      }
+    }
+    Eigen::VectorXi &I = this->working_ind.size() != 0 ? I_working : active.I;
 #ifdef TEST
     clock_t t0, t1, t2;
     t1 = clock();
@@ -351,7 +786,7 @@ public:
 
     // calculate beta & d & h
     Eigen::VectorXi A_ind = find_ind(A, g_index, g_size, p, N);
-    T4 X_A = X_seg(X, n, A_ind);
+    T5 &X_A = this->update_active_X(X, n, A_ind);
     T2 beta_A;
     slice(beta, A_ind, beta_A);
 
@@ -361,7 +796,7 @@ public:
     t1 = clock();
 #endif
 
-    double L1, L0 = neg_loglik_loss(X_A, y, weights, beta_A, coef0, A, g_index, g_size);
+    double L1, L0 = this->model().neg_loglik_loss(X_A, y, weights, beta_A, coef0, A, g_index, g_size);
     train_loss = L0;
 
 #ifdef TEST
@@ -371,7 +806,7 @@ public:
 #endif
 
     bd = Eigen::VectorXd::Zero(N);
-    this->sacrifice(X, X_A, y, beta, beta_A, coef0, A, I, weights, g_index, g_size, N, A_ind, bd);
+    this->model().sacrifice(X, X_A, y, beta, beta_A, coef0, A, I, weights, g_index, g_size, N, A_ind, bd);
 
 #ifdef TEST
     t2 = clock();
@@ -393,8 +828,8 @@ public:
       d_I_group(i) = bd(I[i]);
     }
 
-    Eigen::VectorXi A_min_k = min_k(beta_A_group, C_max, true);
-    Eigen::VectorXi I_max_k = max_k(d_I_group, C_max, true);
+    Eigen::VectorXi A_min_k = min_k(beta_A_group, C_max, true, this->order);
+    Eigen::VectorXi I_max_k = max_k(d_I_group, C_max, true, this->order);
     Eigen::VectorXi s1 = vector_slice(A, A_min_k);
     Eigen::VectorXi s2 = vector_slice(I, I_max_k);
 #ifdef TEST
@@ -406,29 +841,48 @@ public:
     // cout << "get A 5" << endl;
     Eigen::VectorXi A_exchange(A_size);
     Eigen::VectorXi A_ind_exchage;
-    T4 X_A_exchage;
+    T5 X_A_exchage;
     T2 beta_A_exchange;
     T3 coef0_A_exchange;
 
+    bool splicing_updates = this->model().splicing_base(X, X_A, y, A_ind);
+    if (!splicing_updates && this->splicing_threads > 1 && C_max > 1)
+    {
+      this->get_A_parallel(X, y, active, C_max, beta, coef0, weights, g_index, g_size, N, tau, train_loss, L0, A_ind, X_A, s1, s2);
+#ifdef TEST
+      t2 = clock();
+      std::cout << "splicing time: " << ((double)(t2 - t0) / CLOCKS_PER_SEC) << endl;
+#endif
+      return;
+    }
     for (int k = C_max; k >= 1;)
     {
-      A_exchange = diff_union(A, s1, s2);
+      A_exchange = active.exchange(s1, s2);
       A_ind_exchage = find_ind(A_exchange, g_index, g_size, p, N);
-      X_A_exchage = X_seg(X, n, A_ind_exchage);
       slice(this->beta_warmstart, A_ind_exchage, beta_A_exchange);
       coef0_A_exchange = this->coef0_warmstart;
 
-      primary_model_fit(X_A_exchage, y, weights, beta_A_exchange, coef0_A_exchange, L0, A_exchange, g_index, g_size);
-
-      L1 = neg_loglik_loss(X_A_exchage, y, weights, beta_A_exchange, coef0_A_exchange, A_exchange, g_index, g_size);
+      bool refit = !splicing_updates || !this->model().splicing_trial(X, X_A, y, A_ind, A_ind_exchage, beta_A_exchange, coef0_A_exchange, L1);
+      if (refit)
+      {
+        X_seg_update(X, this->train_mask, A_ind_exchage, A_ind, X_A, X_A_exchage);
+        this->model().exchange_slots(1);
+        this->model().exchange_fit(X_A_exchage, y, weights, beta_A_exchange, coef0_A_exchange, L0, A_exchange, g_index, g_size, 0);
+        L1 = this->model().neg_loglik_loss(X_A_exchage, y, weights, beta_A_exchange, coef0_A_exchange, A_exchange, g_index, g_size);
+        this->model().exchange_keep(0, L0 - L1 > tau);
+      }
 
       // cout << "L0: " << L0 << " L1: " << L1 << endl;
       if (L0 - L1 > tau)
       {
         train_loss = L1;
-        A = A_exchange;
-        I = Ac(A_exchange, N);
-        slice_restore(beta_A_exchange, A_ind_exchage, beta);
+        active.update(A_exchange);
+        if (refit)
+        {
+          this->active_X.swap(X_A_exchage);
+          this->active_ind = A_ind_exchage;
+        }
+        this->restore_beta(beta_A_exchange, A_ind_exchage, beta);
         coef0 = coef0_A_exchange;
 #ifdef TEST
         std::cout << "C_max: " << C_max << " k: " << k << endl;
@@ -460,6 +914,66 @@ public:
 #endif
   };
 
+  // The exchanges of get_A(), fitted splicing_threads at a time, each with its own columns and coefficients.
+  // The first one in the sequential order that lowers the loss by more than tau is taken, as get_A() would.
+  void get_A_parallel(T4 &X, T1 &y, IndexSet &active, int &C_max, T2 &beta, T3 &coef0, Eigen::VectorXd &weights,
+                      Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, double tau, double &train_loss, double L0,
+                      Eigen::VectorXi &A_ind, T5 &X_A, Eigen::VectorXi &s1, Eigen::VectorXi &s2)
+  {
+    int p = X.cols();
+    std::vector<int> k_list;
+    for (int k = C_max; k >= 1; k = this->splicing_type == 1 ? k - 1 : k / 2)
+    {
+      k_list.push_back(k);
+    }
+    int k_num = k_list.size();
+    int slots = this->splicing_threads;
+
+    std::vector<Eigen::VectorXi> A_exchange(slots), A_ind_exchage(slots);
+    std::vector<T5> X_A_exchage(slots);
+    std::vector<T2> beta_A_exchange(slots);
+    std::vector<T3> coef0_A_exchange(slots);
+    Eigen::VectorXd L1(slots);
+
+    for (int start = 0; start < k_num; start += slots)
+    {
+      int end = min(start + slots, k_num);
+      this->model().exchange_slots(end - start);
+#pragma omp parallel for num_threads(slots) schedule(dynamic)
+      for (int c = start; c < end; c++)
+      {
+        int i = c - start;
+        Eigen::VectorXi s1_k = s1.head(k_list[c]);
+        Eigen::VectorXi s2_k = s2.head(k_list[c]);
+        A_exchange[i] = active.exchange(s1_k, s2_k);
+        A_ind_exchage[i] = find_ind(A_exchange[i], g_index, g_size, p, N);
+        slice(this->beta_warmstart, A_ind_exchage[i], beta_A_exchange[i]);
+        coef0_A_exchange[i] = this->coef0_warmstart;
+
+        X_seg_update(X, this->train_mask, A_ind_exchage[i], A_ind, X_A, X_A_exchage[i]);
+        this->model().exchange_fit(X_A_exchage[i], y, weights, beta_A_exchange[i], coef0_A_exchange[i], L0, A_exchange[i], g_index, g_size, i);
+        L1(i) = this->model().neg_loglik_loss(X_A_exchage[i], y, weights, beta_A_exchange[i], coef0_A_exchange[i], A_exchange[i], g_index, g_size);
+      }
+
+      for (int i = 0; i < end - start; i++)
+      {
+        if (L0 - L1(i) > tau)
+        {
+          this->model().exchange_keep(i, true);
+          train_loss = L1(i);
+          active.update(A_exchange[i]);
+          this->active_X.swap(X_A_exchage[i]);
+          this->active_ind = A_ind_exchage[i];
+          this->restore_beta(beta_A_exchange[i], A_ind_exchage[i], beta);
+          coef0 = coef0_A_exchange[i];
+          C_max = k_list[start + i];
+          return;
+        }
+      }
+      this->model().exchange_keep(end - start - 1, false);
+    }
+  };
+
   Eigen::VectorXi inital_screening(T4 &X, T1 &y, T2 &beta, T3 &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &bd, Eigen::VectorXd &weights,
                                    Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int &N)
   {
@@ -472,17 +986,17 @@ public:
     if (bd.size() == 0)
     {
       // variable initialization
-      int n = X.rows();
+      int n = this->train_rows(X);
       int p = X.cols();
       bd = Eigen::VectorXd::Zero(N);
 
       // calculate beta & d & h
       Eigen::VectorXi A_ind = find_ind(A, g_index, g_size, p, N);
-      T4 X_A = X_seg(X, n, A_ind);
+      T5 &X_A = this->update_active_X(X, n, A_ind);
       T2 beta_A;
       slice(beta, A_ind, beta_A);
 
-      this->sacrifice(X, X_A, y, beta, beta_A, coef0, A, I, weights, g_index, g_size, N, A_ind, bd);
+      this->model().sacrifice(X, X_A, y, beta, beta_A, coef0, A, I, weights, g_index, g_size, N, A_ind, bd);
     }
 
 #ifdef TEST
@@ -492,36 +1006,64 @@ public:
 #endif
 
     // get Active-set A according to max_k bd
-    Eigen::VectorXi A_new = max_k_2(bd, this->sparsity_level);
+    Eigen::VectorXi A_new;
+    int T0 = this->sparsity_level;
+    if (this->active_warm_start && A.size() != 0)
+    {
+      // the groups of the largest sacrifices among I are added to A, or the smallest among A are dropped
+      if (T0 >= A.size())
+      {
+        Eigen::VectorXd bd_I;
+        slice(bd, I, bd_I);
+        Eigen::VectorXi I_max_k = max_k(bd_I, T0 - A.size(), false, this->order);
+        A_new.resize(T0);
+        A_new << A, vector_slice(I, I_max_k);
+        std::sort(A_new.data(), A_new.data() + T0);
+      }
+      else
+      {
+        Eigen::VectorXd bd_A;
+        slice(bd, A, bd_A);
+        Eigen::VectorXi A_max_k = max_k(bd_A, T0, false, this->order);
+        A_new = vector_slice(A, A_max_k);
+      }
+    }
+    else
+    {
+      A_new = max_k(bd, T0, false, this->order);
+    }
     // int p = X.cols();
 
-    this->U1 = max_k(bd, min(this->sparsity_level + 100, N));
-
 #ifdef TEST
     t4 = clock();
     std::cout << "inital_screening max_k: " << ((double)(t4 - t3) / CLOCKS_PER_SEC) << endl;
 #endif
     return A_new;
   }
-
-  virtual double neg_loglik_loss(T4 &X, T1 &y, Eigen::VectorXd &weights, T2 &beta, T3 &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size) = 0;
-
-  virtual void sacrifice(T4 &X, T4 &XA, T1 &y, T2 &beta, T2 &beta_A, T3 &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd) = 0;
-
-  virtual void primary_model_fit(T4 &X, T1 &y, Eigen::VectorXd &weights, T2 &beta, T3 &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size) = 0;
-
-  virtual double effective_number_of_parameter(T4 &X, T4 &XA, T1 &y, Eigen::VectorXd &weights, T2 &beta, T2 &beta_A, T3 &coef0) = 0;
 };
 
 template <class T4>
-class abessLogistic : public Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>
+class abessLogistic final : public SplicingAlgorithm<abessLogistic<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>
 {
 public:
-  abessLogistic(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 0) : Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  abessLogistic(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 0) : SplicingAlgorithm<abessLogistic<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
 
   ~abessLogistic(){};
 
-  void primary_model_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  void primary_model_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  {
+    this->logistic_fit(x, y, weights, beta, coef0, loss0, A, g_index, g_size, 0, this->lbfgs_memory);
+  };
+
+  void exchange_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot)
+  {
+    this->logistic_fit(x, y, weights, beta, coef0, loss0, A, g_index, g_size, slot, this->exchange_lbfgs[slot]);
+  };
+
+  // the primary fit on workspace(slot), whose L-BFGS steps start from and update memory
+  void logistic_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot, LbfgsMemory &memory)
   {
 #ifdef TEST
     clock_t t1 = clock();
@@ -533,16 +1075,17 @@ public:
       return;
     }
 
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     int n = x.rows();
     int p = x.cols();
 
     // to ensure
-    T4 X(n, p + 1);
+    Workspace<Eigen::VectorXd, T5> &ws = this->workspace(slot);
+    T5 &X = ws.X;
+    X.resize(n, p + 1);
     X.rightCols(p) = x;
     add_constant_column(X);
 
-    T4 X_new(X);
-
 #ifdef TEST
     clock_t t2 = clock();
     std::cout << "primary fit init time: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
@@ -551,7 +1094,20 @@ public:
     Eigen::VectorXd beta0 = Eigen::VectorXd::Zero(p + 1);
     beta0(0) = coef0;
     beta0.tail(p) = beta;
-    Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    if (this->primary_solver != 0)
+    {
+      LogisticObjective<T5> f(X, y, weights, this->lambda_level, center);
+      int iter = this->solver_fit(f, beta0, 1, A, g_index, g_size, memory, loss0);
+      this->count_primary_fit(slot, iter, start);
+      beta = beta0.tail(p).eval();
+      coef0 = beta0(0);
+      return;
+    }
+
+    // the Newton steps are the same on the uncentered columns, with the centering taken up by the intercept
+    beta0(0) -= center_shift(center, beta);
+    Eigen::VectorXd &one = ws.ones(n);
     Eigen::MatrixXd lambdamat = Eigen::MatrixXd::Identity(p + 1, p + 1);
     lambdamat(0, 0) = 0;
 
@@ -559,90 +1115,32 @@ public:
     Eigen::VectorXd log_Pi = Pi.array().log();
     Eigen::VectorXd log_1_Pi = (one - Pi).array().log();
     double loglik1 = DBL_MAX, loglik0 = (y.cwiseProduct(log_Pi) + (one - y).cwiseProduct(log_1_Pi)).dot(weights);
-    Eigen::VectorXd W = Pi.cwiseProduct(one - Pi);
+    Eigen::VectorXd &W = ws.W;
+    W = Pi.cwiseProduct(one - Pi);
     for (int i = 0; i < n; i++)
     {
       if (W(i) < 0.001)
         W(i) = 0.001;
     }
-    Eigen::VectorXd Z = X * beta0 + (y - Pi).cwiseQuotient(W);
+    Eigen::VectorXd &Z = ws.Z;
+    Z = X * beta0 + (y - Pi).cwiseQuotient(W);
 
     // cout << "l0 loglik: " << loglik0 << endl;
 
     int j;
-    // double step = 1;
-    Eigen::VectorXd g(p + 1);
-    Eigen::VectorXd beta1;
     for (j = 0; j < this->primary_model_fit_max_iter; j++)
     {
-      // // To do: Approximate Newton method
-      // if (this->approximate_Newton)
-      // {
-      //   Eigen::VectorXd h_diag(p + 1);
-      //   for (int i = 0; i < p + 1; i++)
-      //   {
-      //     h_diag(i) = 1.0 / X.col(i).cwiseProduct(W).cwiseProduct(weights).dot(X.col(i));
-      //   }
-      //   g = X.transpose() * ((y - Pi).cwiseProduct(weights));
-      //   beta1 = beta0 + step * g.cwiseProduct(h_diag);
-      //   Pi = pi(X, y, beta1);
-      //   log_Pi = Pi.array().log();
-      //   log_1_Pi = (one - Pi).array().log();
-      //   loglik1 = (y.cwiseProduct(log_Pi) + (one - y).cwiseProduct(log_1_Pi)).dot(weights);
-
-      //   while (loglik1 < loglik0 && step > this->primary_model_fit_epsilon)
-      //   {
-      //     step = step / 2;
-      //     beta1 = beta0 + step * g.cwiseProduct(h_diag);
-      //     Pi = pi(X, y, beta1);
-      //     log_Pi = Pi.array().log();
-      //     log_1_Pi = (one - Pi).array().log();
-      //     loglik1 = (y.cwiseProduct(log_Pi) + (one - y).cwiseProduct(log_1_Pi)).dot(weights);
-      //   }
-
-      //   // cout << "j=" << j << " loglik: " << loglik1 << endl;
-      //   // cout << "j=" << j << " loglik diff: " << loglik1 - loglik0 << endl;
-      //   bool condition1 = -(loglik1 + (this->primary_model_fit_max_iter - j - 1) * (loglik1 - loglik0)) + this->tau > loss0;
-      //   // bool condition1 = false;
-      //   if (condition1)
-      //     break;
-
-      //   if (loglik1 > loglik0)
-      //   {
-      //     beta0 = beta1;
-      //     loglik0 = loglik1;
-      //     W = Pi.cwiseProduct(one - Pi);
-      //     for (int i = 0; i < n; i++)
-      //     {
-      //       if (W(i) < 0.001)
-      //         W(i) = 0.001;
-      //     }
-      //   }
-
-      //   if (step < this->primary_model_fit_epsilon)
-      //   {
-      //     break;
-      //   }
-      // }
-      // else
-      // {
-      // #ifdef TEST
-      //         t1 = clock();
-      // #endif
-      for (int i = 0; i < p + 1; i++)
-      {
-        X_new.col(i) = X.col(i).cwiseProduct(W).cwiseProduct(weights);
-      }
-
-      Eigen::MatrixXd XTX = 2 * this->lambda_level * lambdamat + X_new.transpose() * X;
-      beta0 = XTX.ldlt().solve(X_new.transpose() * Z);
-
-      // overload_ldlt(X_new, X, Z, beta0);
+      Eigen::VectorXd w = W.cwiseProduct(weights);
+      Eigen::MatrixXd XTX;
+      Eigen::VectorXd XTZ;
+      weighted_gram(X, w, Z, XTX, XTZ);
+      XTX += 2 * this->lambda_level * lambdamat;
+      beta0 = XTX.ldlt().solve(XTZ);
 
       // CG
       // ConjugateGradient<T4, Lower | Upper> cg;
-      // cg.compute(X_new.transpose() * X);
-      // beta0 = cg.solve(X_new.transpose() * Z);
+      // cg.compute(XTX);
+      // beta0 = cg.solve(XTZ);
 
       Pi = pi(X, y, beta0);
       log_Pi = Pi.array().log();
@@ -667,37 +1165,38 @@ public:
       }
       Z = X * beta0 + (y - Pi).cwiseQuotient(W);
     }
-    // }
+    this->count_primary_fit(slot, min(j + 1, this->primary_model_fit_max_iter), start);
 #ifdef TEST
     t2 = clock();
     std::cout << "primary fit time: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
     cout << "primary fit iter : " << j << endl;
 #endif
     beta = beta0.tail(p).eval();
-    coef0 = beta0(0);
+    coef0 = beta0(0) + center_shift(center, beta);
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     int n = X.rows();
     int p = X.cols();
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
     Eigen::VectorXd coef = Eigen::VectorXd::Ones(p + 1);
-    coef(0) = coef0;
+    coef(0) = coef0 - center_shift(center, beta);
     coef.tail(p) = beta;
     return -loglik_logit(X, y, coef, n, weights);
   }
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  void sacrifice(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     clock_t t1 = clock(), t2;
 #endif
-    int p = X.cols();
-    int n = X.rows();
+    int n = this->train_rows(X);
 
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
     Eigen::VectorXd coef = Eigen::VectorXd::Ones(XA.cols() + 1);
     Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
-    coef(0) = coef0;
+    coef(0) = coef0 - center_shift(center, beta_A);
     coef.tail(XA.cols()) = beta_A;
 
     Eigen::VectorXd pr = pi(XA, y, coef);
@@ -709,7 +1208,7 @@ public:
     t1 = clock();
 #endif
 
-    Eigen::VectorXd d = X.transpose() * res - 2 * this->lambda_level * beta;
+    Eigen::VectorXd d = this->XTr_working(X, res) - 2 * this->lambda_level * beta;
     Eigen::VectorXd h = weights.array() * pr.array() * (one - pr).array();
 
 #ifdef TEST
@@ -721,27 +1220,9 @@ public:
     int A_size = A.size();
     int I_size = I.size();
 
-    Eigen::VectorXd betabar = Eigen::VectorXd::Zero(p);
-    Eigen::VectorXd dbar = Eigen::VectorXd::Zero(p);
-
-    for (int i = 0; i < N; i++)
-    {
-      T4 XG = X.middleCols(g_index(i), g_size(i));
-      T4 XG_new = XG;
-      for (int j = 0; j < g_size(i); j++)
-      {
-        XG_new.col(j) = XG.col(j).cwiseProduct(h);
-      }
-      Eigen::MatrixXd XGbar;
-      XGbar = XG_new.transpose() * XG + 2 * this->lambda_level * Eigen::MatrixXd::Identity(g_size(i), g_size(i));
-
-      //to do
-      Eigen::MatrixXd phiG;
-      XGbar.sqrt().evalTo(phiG);
-      Eigen::MatrixXd invphiG = phiG.ldlt().solve(Eigen::MatrixXd::Identity(g_size(i), g_size(i)));
-      betabar.segment(g_index(i), g_size(i)) = phiG * beta.segment(g_index(i), g_size(i));
-      dbar.segment(g_index(i), g_size(i)) = invphiG * d.segment(g_index(i), g_size(i));
-    }
+    this->group_bar(X, h, beta, d, A, I, g_index, g_size);
+    Eigen::VectorXd &betabar = this->workspace().betabar;
+    Eigen::VectorXd &dbar = this->workspace().dbar;
     for (int i = 0; i < A_size; i++)
     {
       bd(A[i]) = betabar.segment(g_index(A[i]), g_size(A[i])).squaredNorm() / g_size(A[i]);
@@ -756,7 +1237,7 @@ public:
 #endif
   }
 
-  double effective_number_of_parameter(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
+  double effective_number_of_parameter(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
   {
     if (this->lambda_level == 0.)
     {
@@ -769,11 +1250,13 @@ public:
       clock_t t1 = clock(), t2;
 #endif
       // int p = X.cols();
-      int n = X.rows();
+      int n = this->train_rows(X);
 
+      // XA is the active_X of fit()
+      Eigen::VectorXd center = this->center_of(this->active_ind);
       Eigen::VectorXd coef = Eigen::VectorXd::Ones(XA.cols() + 1);
       Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
-      coef(0) = coef0;
+      coef(0) = coef0 - center_shift(center, beta_A);
       coef.tail(XA.cols()) = beta_A;
 
       Eigen::VectorXd pr = pi(XA, y, coef);
@@ -788,13 +1271,18 @@ public:
       // Eigen::VectorXd d = X.transpose() * res - 2 * this->lambda_level * beta;
       Eigen::VectorXd h = weights.array() * pr.array() * (one - pr).array();
 
-      T4 XA_new = XA;
+      T5 XA_new = XA;
       for (int j = 0; j < XA.cols(); j++)
       {
         XA_new.col(j) = XA.col(j).cwiseProduct(h);
       }
       Eigen::MatrixXd XGbar;
       XGbar = XA_new.transpose() * XA;
+      if (center.size() != 0)
+      {
+        Eigen::VectorXd XATh = XA.transpose() * h;
+        center_XTHX(XGbar, XATh, h.sum(), center);
+      }
 
       Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> adjoint_eigen_solver(XGbar);
 
@@ -810,14 +1298,23 @@ public:
 };
 
 template <class T4>
-class abessLm : public Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>
+class abessLm final : public SplicingAlgorithm<abessLm<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>
 {
 public:
-  abessLm(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), bool covariance_update = true, int splicing_type = 0) : Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  // the Cholesky factor of X_A^T X_A + lambda I for the active set of get_A(), see splicing_base()
+  Eigen::MatrixXd splicing_L;
+  Eigen::VectorXd splicing_XTy;
+  Eigen::VectorXd splicing_XTone;
+  double splicing_yTy = 0;
+  double splicing_oneTy = 0;
+
+  abessLm(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), bool covariance_update = true, int splicing_type = 0) : SplicingAlgorithm<abessLm<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type){};
 
   ~abessLm(){};
 
-  void primary_model_fit(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  void primary_model_fit(T5 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     if (X.cols() == 0)
     {
@@ -825,8 +1322,15 @@ public:
       return;
     }
     // beta = (X.adjoint() * X + this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols())).colPivHouseholderQr().solve(X.adjoint() * y);
-    Eigen::MatrixXd XTX = X.adjoint() * X + this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols());
-    beta = XTX.ldlt().solve(X.adjoint() * y);
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    Eigen::MatrixXd XTX = X.adjoint() * X;
+    if (center.size() != 0)
+    {
+      Eigen::VectorXd XTone = X.transpose() * Eigen::VectorXd::Ones(X.rows());
+      center_XTHX(XTX, XTone, X.rows(), center);
+    }
+    XTX.diagonal().array() += this->lambda_level;
+    beta = XTX.ldlt().solve(XTr(X, y, center));
 
     // if (X.cols() == 0)
     // {
@@ -840,11 +1344,12 @@ public:
     // beta = cg.solveWithGuess(X.adjoint() * y, beta);
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     int n = X.rows();
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
     Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
-    return (y - X * beta - coef0 * one).array().square().sum() / n;
+    return (y - X * beta - (coef0 - center_shift(center, beta)) * one).array().square().sum() / n;
   }
 
   void covariance_update_f(T4 &X, Eigen::VectorXi &A_ind)
@@ -857,19 +1362,161 @@ public:
     {
       if (this->covariance_update_flag(A_ind(i)) == 0)
       {
-        this->covariance.col(A_ind(i)) = X.transpose() * (X.col(A_ind(i)).eval());
+        T5 X_i;
+        X_cols(X, this->train_mask, A_ind(i), 1, X_i);
+        Eigen::VectorXd x_i = X_i;
+        if (this->x_center.size() != 0)
+          x_i = x_i.array() - this->x_center(A_ind(i));
+        this->covariance.col(A_ind(i)) = XTr(X, this->train_mask, x_i, this->x_center);
         this->covariance_update_flag(A_ind(i)) = 1;
       }
     }
   }
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  bool splicing_base(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXi &A_ind)
+  {
+    Eigen::MatrixXd XTX;
+    if (this->covariance_update)
+    {
+      this->covariance_update_f(X, A_ind);
+      Eigen::MatrixXd XTX_A = X_seg(this->covariance, this->covariance.rows(), A_ind);
+      slice(XTX_A, A_ind, XTX, 0);
+      slice(this->XTy, A_ind, this->splicing_XTy);
+      slice(this->XTone, A_ind, this->splicing_XTone);
+    }
+    else
+    {
+      Eigen::VectorXd center = this->center_of(A_ind);
+      XTX = XA.transpose() * XA;
+      this->splicing_XTy = XTr(XA, y, center);
+      this->splicing_XTone = XA.transpose() * Eigen::VectorXd::Ones(XA.rows());
+      if (center.size() != 0)
+      {
+        center_XTHX(XTX, this->splicing_XTone, XA.rows(), center);
+        this->splicing_XTone -= XA.rows() * center;
+      }
+    }
+    XTX.diagonal().array() += this->lambda_level;
+    Eigen::LLT<Eigen::MatrixXd> llt(XTX);
+    if (llt.info() != Eigen::Success)
+      return false;
+    this->splicing_L = llt.matrixL();
+    this->splicing_yTy = y.squaredNorm();
+    this->splicing_oneTy = y.sum();
+    return true;
+  }
+
+  // the factor of the exchange is the one of A_ind without the columns taken out, then with the new ones appended
+  bool splicing_trial(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXi &A_ind, Eigen::VectorXi &A_ind_exchange, Eigen::VectorXd &beta_A, double &coef0, double &loss)
+  {
+    int n = this->train_rows(X);
+    int m = A_ind.size();
+    int m_new = A_ind_exchange.size();
+
+    // both are sorted, so one pass splits them into kept, taken out and new columns
+    std::vector<int> out_pos, keep_pos, new_pos;
+    int i = 0, j = 0;
+    while (i < m || j < m_new)
+    {
+      if (i < m && j < m_new && A_ind(i) == A_ind_exchange(j))
+      {
+        keep_pos.push_back(i++);
+        j++;
+      }
+      else if (j == m_new || (i < m && A_ind(i) < A_ind_exchange(j)))
+        out_pos.push_back(i++);
+      else
+        new_pos.push_back(j++);
+    }
+    int keep = keep_pos.size();
+    int q = new_pos.size();
+    Eigen::VectorXi keep_col(keep), new_col(q);
+    for (int k = 0; k < keep; k++)
+      keep_col(k) = A_ind(keep_pos[k]);
+    for (int k = 0; k < q; k++)
+      new_col(k) = A_ind_exchange(new_pos[k]);
+
+    Eigen::MatrixXd L = this->splicing_L;
+    for (int k = out_pos.size() - 1; k >= 0; k--)
+      cholesky_delete(L, out_pos[k]);
+
+    // the cross products of the new columns with the kept ones and with each other
+    Eigen::MatrixXd XTX_new(keep + q, q);
+    Eigen::VectorXd XTy_new, XTone_new;
+    if (this->covariance_update)
+    {
+      this->covariance_update_f(X, new_col);
+      Eigen::VectorXi rows(keep + q);
+      rows << keep_col, new_col;
+      Eigen::MatrixXd XTX_cols = X_seg(this->covariance, this->covariance.rows(), new_col);
+      slice(XTX_cols, rows, XTX_new, 0);
+      slice(this->XTy, new_col, XTy_new);
+      slice(this->XTone, new_col, XTone_new);
+    }
+    else
+    {
+      T5 X_new = X_seg(X, this->train_mask, new_col);
+      Eigen::VectorXd center_new = this->center_of(new_col);
+      // the products with all the active columns, of which the kept rows are taken
+      Eigen::MatrixXd XATX_new = XA.transpose() * X_new;
+      for (int k = 0; k < keep; k++)
+        XTX_new.row(k) = XATX_new.row(keep_pos[k]);
+      XTX_new.bottomRows(q) = X_new.transpose() * X_new;
+      XTy_new = XTr(X_new, y, center_new);
+      XTone_new = X_new.transpose() * Eigen::VectorXd::Ones(n);
+      if (center_new.size() != 0)
+      {
+        Eigen::VectorXd XATone = XA.transpose() * Eigen::VectorXd::Ones(n);
+        Eigen::VectorXd center_rows(keep + q), XTone_rows(keep + q);
+        center_rows << this->center_of(keep_col), center_new;
+        for (int k = 0; k < keep; k++)
+          XTone_rows(k) = XATone(keep_pos[k]);
+        XTone_rows.tail(q) = XTone_new;
+        center_XTHZ(XTX_new, XTone_rows, XTone_new, n, center_rows, center_new);
+        XTone_new -= n * center_new;
+      }
+    }
+    for (int k = 0; k < q; k++)
+    {
+      XTX_new(keep + k, k) += this->lambda_level;
+      if (!cholesky_append(L, XTX_new.col(k).head(keep + k + 1)))
+        return false;
+    }
+
+    Eigen::VectorXd XTy_f(keep + q), XTone_f(keep + q);
+    for (int k = 0; k < keep; k++)
+    {
+      XTy_f(k) = this->splicing_XTy(keep_pos[k]);
+      XTone_f(k) = this->splicing_XTone(keep_pos[k]);
+    }
+    XTy_f.tail(q) = XTy_new;
+    XTone_f.tail(q) = XTone_new;
+    Eigen::VectorXd beta_f = L.triangularView<Eigen::Lower>().solve(XTy_f);
+    L.transpose().triangularView<Eigen::Upper>().solveInPlace(beta_f);
+
+    // the kept columns are in the order of A_ind_exchange, the new ones after them
+    int k_keep = 0, k_new = 0;
+    for (int k = 0; k < m_new; k++)
+    {
+      if (k_new < q && new_pos[k_new] == k)
+        beta_A(k) = beta_f(keep + k_new++);
+      else
+        beta_A(k) = beta_f(k_keep++);
+    }
+
+    // |y - X beta - coef0|^2, with (X^T X + lambda I) beta = X^T y
+    loss = this->splicing_yTy - beta_f.dot(XTy_f) - this->lambda_level * beta_f.squaredNorm() - 2 * coef0 * this->splicing_oneTy + 2 * coef0 * beta_f.dot(XTone_f) + coef0 * coef0 * n;
+    loss /= n;
+    return true;
+  }
+
+  void sacrifice(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     clock_t t1 = clock(), t2;
 #endif
     int p = X.cols();
-    int n = X.rows();
+    int n = this->train_rows(X);
 
     Eigen::VectorXd d;
     if (!this->covariance_update)
@@ -877,11 +1524,14 @@ public:
       Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
       if (beta.size() != 0)
       {
-        d = X.adjoint() * (y - XA * beta_A - coef0 * one) / double(n) - 2 * this->lambda_level * beta;
+        Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+        Eigen::VectorXd res = y - XA * beta_A - (coef0 - center_shift(center, beta_A)) * one;
+        d = this->XTr_working(X, res) / double(n) - 2 * this->lambda_level * beta;
       }
       else
       {
-        d = X.adjoint() * (y - coef0 * one) / double(n);
+        Eigen::VectorXd res = y - coef0 * one;
+        d = this->XTr_working(X, res) / double(n);
       }
     }
     else
@@ -915,23 +1565,19 @@ public:
     int A_size = A.size();
     int I_size = I.size();
 
-    Eigen::VectorXd betabar = Eigen::VectorXd::Zero(p);
-    Eigen::VectorXd dbar = Eigen::VectorXd::Zero(p);
-    Eigen::MatrixXd phiG, invphiG;
+    Eigen::VectorXd &betabar = this->workspace().betabar;
+    Eigen::VectorXd &dbar = this->workspace().dbar;
+    betabar.setZero(p);
+    dbar.setZero(p);
 
-    for (int i = 0; i < N; i++)
-    {
-      phiG = this->PhiG(i, 0);
-      invphiG = this->invPhiG(i, 0);
-      betabar.segment(g_index(i), g_size(i)) = phiG * beta.segment(g_index(i), g_size(i));
-      dbar.segment(g_index(i), g_size(i)) = invphiG * d.segment(g_index(i), g_size(i));
-    }
     for (int i = 0; i < A_size; i++)
     {
+      betabar.segment(g_index(A[i]), g_size(A[i])).noalias() = this->PhiG(A[i], 0) * beta.segment(g_index(A[i]), g_size(A[i]));
       bd(A[i]) = betabar.segment(g_index(A[i]), g_size(A[i])).squaredNorm() / g_size(A[i]);
     }
     for (int i = 0; i < I_size; i++)
     {
+      dbar.segment(g_index(I[i]), g_size(I[i])).noalias() = this->invPhiG(I[i], 0) * d.segment(g_index(I[i]), g_size(I[i]));
       bd(I[i]) = dbar.segment(g_index(I[i]), g_size(I[i])).squaredNorm() / g_size(I[i]);
     }
 #ifdef TEST
@@ -940,7 +1586,7 @@ public:
 #endif
   }
 
-  double effective_number_of_parameter(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
+  double effective_number_of_parameter(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
   {
     if (this->lambda_level == 0.)
     {
@@ -958,33 +1604,60 @@ public:
 };
 
 template <class T4>
-class abessPoisson : public Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>
+class abessPoisson final : public SplicingAlgorithm<abessPoisson<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>
 {
 public:
-  abessPoisson(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 0) : Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  abessPoisson(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 0) : SplicingAlgorithm<abessPoisson<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
 
   ~abessPoisson(){};
 
-  void primary_model_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  void primary_model_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  {
+    this->poisson_fit(x, y, weights, beta, coef0, loss0, A, g_index, g_size, 0, this->lbfgs_memory);
+  };
+
+  void exchange_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot)
+  {
+    this->poisson_fit(x, y, weights, beta, coef0, loss0, A, g_index, g_size, slot, this->exchange_lbfgs[slot]);
+  };
+
+  // the primary fit on workspace(slot), whose L-BFGS steps start from and update memory
+  void poisson_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot, LbfgsMemory &memory)
   {
 #ifdef TEST
     clock_t t1 = clock();
 #endif
     // cout << "primary_fit-----------" << endl;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     int n = x.rows();
     int p = x.cols();
-    T4 X(n, p + 1);
+    Workspace<Eigen::VectorXd, T5> &ws = this->workspace(slot);
+    T5 &X = ws.X;
+    X.resize(n, p + 1);
     X.rightCols(p) = x;
     add_constant_column(X);
 
     Eigen::MatrixXd lambdamat = Eigen::MatrixXd::Identity(p + 1, p + 1);
     lambdamat(0, 0) = 0;
 
-    // Eigen::MatrixXd X_trans = X.transpose();
-    T4 X_new(n, p + 1);
     Eigen::VectorXd beta0 = Eigen::VectorXd::Zero(p + 1);
     beta0.tail(p) = beta;
     beta0(0) = coef0;
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    if (this->primary_solver != 0)
+    {
+      PoissonObjective<T5> f(X, y, weights, this->lambda_level, center);
+      int iter = this->solver_fit(f, beta0, 1, A, g_index, g_size, memory, loss0);
+      this->count_primary_fit(slot, iter, start);
+      beta = beta0.tail(p).eval();
+      coef0 = beta0(0);
+      return;
+    }
+
+    // the Newton steps are the same on the uncentered columns, with the centering taken up by the intercept
+    beta0(0) -= center_shift(center, beta);
     Eigen::VectorXd eta = X * beta0;
     Eigen::VectorXd expeta = eta.array().exp();
     Eigen::VectorXd z = Eigen::VectorXd::Zero(n);
@@ -994,14 +1667,13 @@ public:
     int j;
     for (j = 0; j < this->primary_model_fit_max_iter; j++)
     {
-      for (int i = 0; i < p + 1; i++)
-      {
-        // temp.col(i) = X_trans.col(i) * expeta(i) * weights(i);
-        X_new.col(i) = X.col(i).cwiseProduct(expeta).cwiseProduct(weights);
-      }
+      Eigen::VectorXd w = expeta.cwiseProduct(weights);
       z = eta + (y - expeta).cwiseQuotient(expeta);
-      Eigen::MatrixXd XTX = X_new.transpose() * X + 2 * this->lambda_level * lambdamat;
-      beta0 = (XTX).ldlt().solve(X_new.transpose() * z);
+      Eigen::MatrixXd XTX;
+      Eigen::VectorXd XTz;
+      weighted_gram(X, w, z, XTX, XTz);
+      XTX += 2 * this->lambda_level * lambdamat;
+      beta0 = (XTX).ldlt().solve(XTz);
       eta = X * beta0;
       for (int i = 0; i <= n - 1; i++)
       {
@@ -1025,34 +1697,36 @@ public:
       }
       loglik0 = loglik1;
     }
+    this->count_primary_fit(slot, min(j + 1, this->primary_model_fit_max_iter), start);
 #ifdef TEST
     clock_t t2 = clock();
     std::cout << "primary fit time: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
     cout << "primary fit iter : " << j << endl;
 #endif
     beta = beta0.tail(p).eval();
-    coef0 = beta0(0);
+    coef0 = beta0(0) + center_shift(center, beta);
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     int n = X.rows();
     int p = X.cols();
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
     Eigen::VectorXd coef = Eigen::VectorXd::Ones(p + 1);
-    coef(0) = coef0;
+    coef(0) = coef0 - center_shift(center, beta);
     coef.tail(p) = beta;
     return -loglik_poiss(X, y, coef, n, weights);
   }
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  void sacrifice(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     clock_t t1 = clock(), t2;
 #endif
-    int p = X.cols();
-    int n = X.rows();
+    int n = this->train_rows(X);
 
-    Eigen::VectorXd coef = Eigen::VectorXd::Ones(n) * coef0;
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    Eigen::VectorXd coef = Eigen::VectorXd::Ones(n) * (coef0 - center_shift(center, beta_A));
     Eigen::VectorXd xbeta_exp = XA * beta_A + coef;
     for (int i = 0; i <= n - 1; i++)
     {
@@ -1069,7 +1743,8 @@ public:
     t1 = clock();
 #endif
 
-    Eigen::VectorXd d = X.transpose() * (y - xbeta_exp) - 2 * this->lambda_level * beta;
+    Eigen::VectorXd res = y - xbeta_exp;
+    Eigen::VectorXd d = this->XTr_working(X, res) - 2 * this->lambda_level * beta;
     Eigen::VectorXd h = xbeta_exp;
 
 #ifdef TEST
@@ -1081,26 +1756,9 @@ public:
     int A_size = A.size();
     int I_size = I.size();
 
-    Eigen::VectorXd betabar = Eigen::VectorXd::Zero(p);
-    Eigen::VectorXd dbar = Eigen::VectorXd::Zero(p);
-
-    for (int i = 0; i < N; i++)
-    {
-      T4 XG = X.middleCols(g_index(i), g_size(i));
-      T4 XG_new = XG;
-      for (int j = 0; j < g_size(i); j++)
-      {
-        XG_new.col(j) = XG.col(j).cwiseProduct(h);
-      }
-      Eigen::MatrixXd XGbar;
-      XGbar = XG_new.transpose() * XG + 2 * this->lambda_level * Eigen::MatrixXd::Identity(g_size(i), g_size(i));
-
-      Eigen::MatrixXd phiG;
-      XGbar.sqrt().evalTo(phiG);
-      Eigen::MatrixXd invphiG = phiG.ldlt().solve(Eigen::MatrixXd::Identity(g_size(i), g_size(i)));
-      betabar.segment(g_index(i), g_size(i)) = phiG * beta.segment(g_index(i), g_size(i));
-      dbar.segment(g_index(i), g_size(i)) = invphiG * d.segment(g_index(i), g_size(i));
-    }
+    this->group_bar(X, h, beta, d, A, I, g_index, g_size);
+    Eigen::VectorXd &betabar = this->workspace().betabar;
+    Eigen::VectorXd &dbar = this->workspace().dbar;
     for (int i = 0; i < A_size; i++)
     {
       bd(A[i]) = betabar.segment(g_index(A[i]), g_size(A[i])).squaredNorm() / g_size(A[i]);
@@ -1115,7 +1773,7 @@ public:
 #endif
   }
 
-  double effective_number_of_parameter(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
+  double effective_number_of_parameter(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
   {
     if (this->lambda_level == 0.)
     {
@@ -1129,9 +1787,11 @@ public:
 #endif
 
       // int p = X.cols();
-      int n = X.rows();
+      int n = this->train_rows(X);
 
-      Eigen::VectorXd coef = Eigen::VectorXd::Ones(n) * coef0;
+      // XA is the active_X of fit()
+      Eigen::VectorXd center = this->center_of(this->active_ind);
+      Eigen::VectorXd coef = Eigen::VectorXd::Ones(n) * (coef0 - center_shift(center, beta_A));
       Eigen::VectorXd xbeta_exp = XA * beta_A + coef;
       for (int i = 0; i <= n - 1; i++)
       {
@@ -1151,13 +1811,18 @@ public:
       // Eigen::VectorXd d = X.transpose() * res - 2 * this->lambda_level * beta;
       Eigen::VectorXd h = xbeta_exp;
 
-      T4 XA_new = XA;
+      T5 XA_new = XA;
       for (int j = 0; j < XA.cols(); j++)
       {
         XA_new.col(j) = XA.col(j).cwiseProduct(h);
       }
       Eigen::MatrixXd XGbar;
       XGbar = XA_new.transpose() * XA;
+      if (center.size() != 0)
+      {
+        Eigen::VectorXd XATh = XA.transpose() * h;
+        center_XTHX(XGbar, XATh, h.sum(), center);
+      }
 
       Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> adjoint_eigen_solver(XGbar);
 
@@ -1173,14 +1838,51 @@ public:
 };
 
 template <class T4>
-class abessCox : public Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>
+class abessCox final : public SplicingAlgorithm<abessCox<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>
 {
 public:
-  abessCox(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 0) : Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  abessCox(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 0) : SplicingAlgorithm<abessCox<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
 
   ~abessCox(){};
 
-  void primary_model_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  // cox_hessian and cox_g of the exchanges fitted at once, by slot, see exchange_slots()
+  std::vector<CoxHessian> exchange_hessian;
+  std::vector<Eigen::VectorXd> exchange_g;
+
+  void primary_model_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  {
+    this->cox_fit(x, y, weight, beta, coef0, loss0, A, g_index, g_size, this->cox_hessian, this->cox_g);
+  };
+
+  void exchange_slots(int slots)
+  {
+    this->exchange_hessian.resize(slots);
+    this->exchange_g.assign(slots, Eigen::VectorXd::Zero(0));
+  };
+
+  void exchange_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot)
+  {
+    this->cox_fit(x, y, weight, beta, coef0, loss0, A, g_index, g_size, this->exchange_hessian[slot], this->exchange_g[slot]);
+  };
+
+  void exchange_keep(int slot, bool accepted)
+  {
+    for (int i = slot; i >= 0; i--)
+    {
+      if (this->exchange_g[i].size() != 0)
+      {
+        std::swap(this->cox_hessian, this->exchange_hessian[i]);
+        this->cox_g.swap(this->exchange_g[i]);
+        return;
+      }
+    }
+  };
+
+  // the Newton fit of primary_model_fit(), which sets hessian and grad to those of its last step
+  void cox_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weight, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size,
+               CoxHessian &hessian, Eigen::VectorXd &grad)
   {
 #ifdef TEST
     clock_t t1 = clock();
@@ -1192,21 +1894,10 @@ public:
     }
 
     // cout << "primary_fit-----------" << endl;
-    int n = x.rows();
     int p = x.cols();
-    Eigen::MatrixXd lambdamat = Eigen::MatrixXd::Identity(p, p);
-    Eigen::VectorXd theta(n);
-    Eigen::MatrixXd one = (Eigen::MatrixXd::Ones(n, n)).triangularView<Eigen::Upper>();
-    Eigen::MatrixXd x_theta(n, p);
-    Eigen::VectorXd xij_theta(n);
-    Eigen::VectorXd cum_theta(n);
-    Eigen::VectorXd g(p);
+    Eigen::VectorXd g;
     Eigen::VectorXd beta0 = beta, beta1;
-    Eigen::VectorXd cum_eta(n);
-    Eigen::VectorXd cum_eta2(n);
-    Eigen::VectorXd cum_eta3(n);
-    Eigen::MatrixXd h(p, p);
-    Eigen::VectorXd eta;
+    CoxHessian h;
 
     Eigen::VectorXd d(p);
     double loglik1, loglik0 = -neg_loglik_loss(x, y, weight, beta0, coef0, A, g_index, g_size);
@@ -1216,46 +1907,8 @@ public:
     int l;
     for (l = 1; l <= this->primary_model_fit_max_iter; l++)
     {
-
-      eta = x * beta0;
-      for (int i = 0; i <= n - 1; i++)
-      {
-        if (eta(i) < -30.0)
-          eta(i) = -30.0;
-        if (eta(i) > 30.0)
-          eta(i) = 30.0;
-      }
-      eta = weight.array() * eta.array().exp();
-      cum_eta(n - 1) = eta(n - 1);
-      for (int k = n - 2; k >= 0; k--)
-      {
-        cum_eta(k) = cum_eta(k + 1) + eta(k);
-      }
-      cum_eta2(0) = (y(0) * weight(0)) / cum_eta(0);
-      for (int k = 1; k <= n - 1; k++)
-      {
-        cum_eta2(k) = (y(k) * weight(k)) / cum_eta(k) + cum_eta2(k - 1);
-      }
-      cum_eta3(0) = (y(0) * weight(0)) / pow(cum_eta(0), 2);
-      for (int k = 1; k <= n - 1; k++)
-      {
-        cum_eta3(k) = (y(k) * weight(k)) / pow(cum_eta(k), 2) + cum_eta3(k - 1);
-      }
-      h = -cum_eta3.replicate(1, n);
-      h = h.cwiseProduct(eta.replicate(1, n));
-      h = h.cwiseProduct(eta.replicate(1, n).transpose());
-      for (int i = 0; i < n; i++)
-      {
-        for (int j = i + 1; j < n; j++)
-        {
-          h(j, i) = h(i, j);
-        }
-      }
-      h.diagonal() = cum_eta2.cwiseProduct(eta) + h.diagonal();
-      // g = x.transpose() * (weight.cwiseProduct(y) - cum_eta2.cwiseProduct(eta));
-      // g = g - 2 * this->lambda_level * beta0;
-
-      g = weight.cwiseProduct(y) - cum_eta2.cwiseProduct(eta);
+      cox_derivatives(x, y, weight, beta0, this->status, this->cox_ties, h, g);
+      Eigen::MatrixXd XTHX = cox_XTHX(x, h);
 
 #ifdef TEST
       std::cout << "g: " << g << endl;
@@ -1267,67 +1920,17 @@ public:
 #endif
       if (this->approximate_Newton)
       {
-        // d = g.cwiseQuotient((x.transpose() * h * x + 2 * this->lambda_level * lambdamat).diagonal());
-        d = (x.transpose() * g - 2 * this->lambda_level * beta0).cwiseQuotient((x.transpose() * h * x).diagonal());
+        d = (x.transpose() * g - 2 * this->lambda_level * beta0).cwiseQuotient(XTHX.diagonal());
       }
       else
       {
-        // d = (x.transpose() * h * x + 2 * this->lambda_level * lambdamat).ldlt().solve(g);
-        d = (x.transpose() * h * x).ldlt().solve(x.transpose() * g - 2 * this->lambda_level * beta0);
+        d = XTHX.ldlt().solve(x.transpose() * g - 2 * this->lambda_level * beta0);
       }
 
 #ifdef TEST
       cout << "d: " << d << endl;
 #endif
 
-      // theta = x * beta0;
-      // for (int i = 0; i < n; i++)
-      // {
-      //   if (theta(i) > 30)
-      //     theta(i) = 30;
-      //   else if (theta(i) < -30)
-      //     theta(i) = -30;
-      // }
-      // theta = theta.array().exp();
-      // cum_theta = one * theta;
-      // x_theta = x.array().colwise() * theta.array();
-      // x_theta = one * x_theta;
-      // x_theta = x_theta.array().colwise() / cum_theta.array();
-      // g = (x - x_theta).transpose() * (weights.cwiseProduct(y));
-
-      // if (this->approximate_Newton)
-      // {
-      //   Eigen::VectorXd h(p);
-      //   for (int k1 = 0; k1 < p; k1++)
-      //   {
-      //     xij_theta = (theta.cwiseProduct(x.col(k1))).cwiseProduct(x.col(k1));
-      //     for (int j = n - 2; j >= 0; j--)
-      //     {
-      //       xij_theta(j) = xij_theta(j + 1) + xij_theta(j);
-      //     }
-      //     h(k1) = -(xij_theta.cwiseQuotient(cum_theta) - x_theta.col(k1).cwiseProduct(x_theta.col(k1))).dot(weights.cwiseProduct(y));
-      //   }
-      //   d = g.cwiseQuotient(h);
-      // }
-      // else
-      // {
-      //   Eigen::MatrixXd h(p, p);
-      //   for (int k1 = 0; k1 < p; k1++)
-      //   {
-      //     for (int k2 = k1; k2 < p; k2++)
-      //     {
-      //       xij_theta = (theta.cwiseProduct(x.col(k1))).cwiseProduct(x.col(k2));
-      //       for (int j = n - 2; j >= 0; j--)
-      //       {
-      //         xij_theta(j) = xij_theta(j + 1) + xij_theta(j);
-      //       }
-      //       h(k1, k2) = -(xij_theta.cwiseQuotient(cum_theta) - x_theta.col(k1).cwiseProduct(x_theta.col(k2))).dot(weights.cwiseProduct(y));
-      //       h(k2, k1) = h(k1, k2);
-      //     }
-      //   }
-      //   d = h.ldlt().solve(g);
-      // }
-
       beta1 = beta0 + step * d;
 
       loglik1 = -neg_loglik_loss(x, y, weight, beta1, coef0, A, g_index, g_size);
@@ -1344,8 +1947,8 @@ public:
       {
         loss0 = -loglik0;
         beta = beta0;
-        this->cox_hessian = h;
-        this->cox_g = g;
+        hessian = h;
+        grad = g;
         // cout << "condition1" << endl;
         return;
       }
@@ -1354,8 +1957,8 @@ public:
       {
         beta0 = beta1;
         loglik0 = loglik1;
-        this->cox_hessian = h;
-        this->cox_g = g;
+        hessian = h;
+        grad = g;
         // cout << "condition1" << endl;
       }
 
@@ -1363,8 +1966,8 @@ public:
       {
         loss0 = -loglik0;
         beta = beta0;
-        this->cox_hessian = h;
-        this->cox_g = g;
+        hessian = h;
+        grad = g;
         // cout << "condition2" << endl;
         return;
       }
@@ -1378,21 +1981,20 @@ public:
     beta = beta0;
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
-    return -loglik_cox(X, y, beta, weights);
+    return -loglik_cox(X, y, beta, weights, this->status, this->cox_ties);
   }
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  void sacrifice(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     clock_t t1 = clock(), t2;
 #endif
     int p = X.cols();
-    int n = X.rows();
 
     Eigen::VectorXd d;
-    Eigen::MatrixXd h;
+    CoxHessian h;
     Eigen::VectorXd g;
     if (this->cox_g.size() != 0)
     {
@@ -1401,48 +2003,10 @@ public:
     }
     else
     {
-      Eigen::VectorXd cum_eta(n);
-      Eigen::VectorXd cum_eta2(n);
-      Eigen::VectorXd cum_eta3(n);
-      Eigen::VectorXd eta = XA * beta_A;
-      for (int i = 0; i <= n - 1; i++)
-      {
-        if (eta(i) < -30.0)
-          eta(i) = -30.0;
-        if (eta(i) > 30.0)
-          eta(i) = 30.0;
-      }
-      eta = weights.array() * eta.array().exp();
-      cum_eta(n - 1) = eta(n - 1);
-      for (int k = n - 2; k >= 0; k--)
-      {
-        cum_eta(k) = cum_eta(k + 1) + eta(k);
-      }
-      cum_eta2(0) = (y(0) * weights(0)) / cum_eta(0);
-      for (int k = 1; k <= n - 1; k++)
-      {
-        cum_eta2(k) = (y(k) * weights(k)) / cum_eta(k) + cum_eta2(k - 1);
-      }
-      cum_eta3(0) = (y(0) * weights(0)) / pow(cum_eta(0), 2);
-      for (int k = 1; k <= n - 1; k++)
-      {
-        cum_eta3(k) = (y(k) * weights(k)) / pow(cum_eta(k), 2) + cum_eta3(k - 1);
-      }
-      h = -cum_eta3.replicate(1, n);
-      h = h.cwiseProduct(eta.replicate(1, n));
-      h = h.cwiseProduct(eta.replicate(1, n).transpose());
-      for (int i = 0; i < n; i++)
-      {
-        for (int j = i + 1; j < n; j++)
-        {
-          h(j, i) = h(i, j);
-        }
-      }
-      h.diagonal() = cum_eta2.cwiseProduct(eta) + h.diagonal();
-      g = weights.cwiseProduct(y) - cum_eta2.cwiseProduct(eta);
+      cox_derivatives(XA, y, weights, beta_A, this->status, this->cox_ties, h, g);
     }
 
-    d = X.transpose() * g - 2 * this->lambda_level * beta;
+    d = this->XTr_working(X, g) - 2 * this->lambda_level * beta;
 
 #ifdef TEST
     t2 = clock();
@@ -1462,21 +2026,24 @@ public:
     int A_size = A.size();
     int I_size = I.size();
 
-    Eigen::VectorXd betabar = Eigen::VectorXd::Zero(p);
-    Eigen::VectorXd dbar = Eigen::VectorXd::Zero(p);
+    Workspace<Eigen::VectorXd, T5> &ws = this->workspace();
+    Eigen::VectorXd &betabar = ws.betabar;
+    Eigen::VectorXd &dbar = ws.dbar;
+    betabar.setZero(p);
+    dbar.setZero(p);
 
-    for (int i = 0; i < N; i++)
-      for (int i = 0; i < N; i++)
-      {
-        T4 XG = X.middleCols(g_index(i), g_size(i));
-        Eigen::MatrixXd XGbar = XG.transpose() * h * XG + 2 * this->lambda_level * Eigen::MatrixXd::Identity(g_size(i), g_size(i));
-
-        Eigen::MatrixXd phiG;
-        XGbar.sqrt().evalTo(phiG);
-        Eigen::MatrixXd invphiG = phiG.ldlt().solve(Eigen::MatrixXd::Identity(g_size(i), g_size(i)));
-        betabar.segment(g_index(i), g_size(i)) = phiG * beta.segment(g_index(i), g_size(i));
-        dbar.segment(g_index(i), g_size(i)) = invphiG * d.segment(g_index(i), g_size(i));
-      }
+    for (int k = 0; k < A_size + I_size; k++)
+    {
+      int i = k < A_size ? A(k) : I(k - A_size);
+      X_cols(X, this->train_mask, g_index(i), g_size(i), ws.XG);
+      ws.XGbar = cox_XTHX(ws.XG, h) + 2 * this->lambda_level * Eigen::MatrixXd::Identity(g_size(i), g_size(i));
+
+      matrix_sqrt_inverse(ws.XGbar, ws.phiG, ws.invphiG);
+      if (k < A_size)
+        betabar.segment(g_index(i), g_size(i)).noalias() = ws.phiG * beta.segment(g_index(i), g_size(i));
+      else
+        dbar.segment(g_index(i), g_size(i)).noalias() = ws.invphiG * d.segment(g_index(i), g_size(i));
+    }
     for (int i = 0; i < A_size; i++)
     {
       bd(A[i]) = betabar.segment(g_index(A[i]), g_size(A[i])).squaredNorm() / g_size(A[i]);
@@ -1491,7 +2058,7 @@ public:
 #endif
   }
 
-  double effective_number_of_parameter(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
+  double effective_number_of_parameter(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
   {
     if (this->lambda_level == 0.)
     {
@@ -1504,10 +2071,9 @@ public:
       clock_t t1 = clock(), t2;
 #endif
       // int p = X.cols();
-      int n = X.rows();
 
       Eigen::VectorXd d;
-      Eigen::MatrixXd h;
+      CoxHessian h;
       Eigen::VectorXd g;
       if (this->cox_g.size() != 0)
       {
@@ -1516,45 +2082,7 @@ public:
       }
       else
       {
-        Eigen::VectorXd cum_eta(n);
-        Eigen::VectorXd cum_eta2(n);
-        Eigen::VectorXd cum_eta3(n);
-        Eigen::VectorXd eta = XA * beta_A;
-        for (int i = 0; i <= n - 1; i++)
-        {
-          if (eta(i) < -30.0)
-            eta(i) = -30.0;
-          if (eta(i) > 30.0)
-            eta(i) = 30.0;
-        }
-        eta = weights.array() * eta.array().exp();
-        cum_eta(n - 1) = eta(n - 1);
-        for (int k = n - 2; k >= 0; k--)
-        {
-          cum_eta(k) = cum_eta(k + 1) + eta(k);
-        }
-        cum_eta2(0) = (y(0) * weights(0)) / cum_eta(0);
-        for (int k = 1; k <= n - 1; k++)
-        {
-          cum_eta2(k) = (y(k) * weights(k)) / cum_eta(k) + cum_eta2(k - 1);
-        }
-        cum_eta3(0) = (y(0) * weights(0)) / pow(cum_eta(0), 2);
-        for (int k = 1; k <= n - 1; k++)
-        {
-          cum_eta3(k) = (y(k) * weights(k)) / pow(cum_eta(k), 2) + cum_eta3(k - 1);
-        }
-        h = -cum_eta3.replicate(1, n);
-        h = h.cwiseProduct(eta.replicate(1, n));
-        h = h.cwiseProduct(eta.replicate(1, n).transpose());
-        for (int i = 0; i < n; i++)
-        {
-          for (int j = i + 1; j < n; j++)
-          {
-            h(j, i) = h(i, j);
-          }
-        }
-        h.diagonal() = cum_eta2.cwiseProduct(eta) + h.diagonal();
-        // g = weights.cwiseProduct(y) - cum_eta2.cwiseProduct(eta);
+        cox_derivatives(XA, y, weights, beta_A, this->status, this->cox_ties, h, g);
       }
 
 #ifdef TEST
@@ -1566,7 +2094,7 @@ public:
       // Eigen::VectorXd d = X.transpose() * res - 2 * this->lambda_level * beta;
       // Eigen::VectorXd h = weights.array() * pr.array() * (one - pr).array();
 
-      Eigen::MatrixXd XGbar = XA.transpose() * h * XA;
+      Eigen::MatrixXd XGbar = cox_XTHX(XA, h);
 
       Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> adjoint_eigen_solver(XGbar);
 
@@ -1582,14 +2110,16 @@ public:
 };
 
 template <class T4>
-class abessMLm : public Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>
+class abessMLm final : public SplicingAlgorithm<abessMLm<T4>, Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>
 {
 public:
-  abessMLm(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), bool covariance_update = true, int splicing_type = 0) : Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  abessMLm(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), bool covariance_update = true, int splicing_type = 0) : SplicingAlgorithm<abessMLm<T4>, Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type){};
 
   ~abessMLm(){};
 
-  void primary_model_fit(T4 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  void primary_model_fit(T5 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     // beta = (X.adjoint() * X + this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols())).colPivHouseholderQr().solve(X.adjoint() * y);
 
@@ -1600,8 +2130,14 @@ public:
     }
     // cout << "primary_fit 1" << endl;
     // overload_ldlt(X, X, y, beta);
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
     Eigen::MatrixXd XTX = X.transpose() * X;
-    beta = (XTX + this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols())).ldlt().solve(X.transpose() * y);
+    if (center.size() != 0)
+    {
+      Eigen::VectorXd XTone = X.transpose() * Eigen::VectorXd::Ones(X.rows());
+      center_XTHX(XTX, XTone, X.rows(), center);
+    }
+    beta = (XTX + this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols())).ldlt().solve(XTr(X, y, center));
     // cout << "primary_fit 2" << endl;
 
     // CG
@@ -1610,11 +2146,14 @@ public:
     // beta = cg.solveWithGuess(X.adjoint() * y, beta);
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     int n = X.rows();
-    Eigen::MatrixXd one = Eigen::MatrixXd::Ones(n, y.cols());
-    return (y - X * beta - array_product(one, coef0)).array().square().sum() / n / 2.0;
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    Eigen::VectorXd coef0_X = coef0 - center_shift(center, beta);
+    Eigen::MatrixXd res = y - X * beta;
+    res.rowwise() -= coef0_X.transpose();
+    return res.array().square().sum() / n / 2.0;
   }
 
   void covariance_update_f(T4 &X, Eigen::VectorXi &A_ind)
@@ -1627,19 +2166,24 @@ public:
     {
       if (this->covariance_update_flag(A_ind(i)) == 0)
       {
-        this->covariance.col(A_ind(i)) = X.transpose() * X.col(A_ind(i));
+        T5 X_i;
+        X_cols(X, this->train_mask, A_ind(i), 1, X_i);
+        Eigen::VectorXd x_i = X_i;
+        if (this->x_center.size() != 0)
+          x_i = x_i.array() - this->x_center(A_ind(i));
+        this->covariance.col(A_ind(i)) = XTr(X, this->train_mask, x_i, this->x_center);
         this->covariance_update_flag(A_ind(i)) = 1;
       }
     }
   }
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::MatrixXd &y, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  void sacrifice(T4 &X, T5 &XA, Eigen::MatrixXd &y, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     clock_t t1 = clock(), t2;
 #endif
     int p = X.cols();
-    int n = X.rows();
+    int n = this->train_rows(X);
     int M = y.cols();
 
     Eigen::MatrixXd d;
@@ -1648,11 +2192,16 @@ public:
       Eigen::MatrixXd one = Eigen::MatrixXd::Ones(n, y.cols());
       if (beta.size() != 0)
       {
-        d = X.adjoint() * (y - XA * beta_A - array_product(one, coef0)) / double(n) - 2 * this->lambda_level * beta;
+        Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+        Eigen::VectorXd coef0_X = coef0 - center_shift(center, beta_A);
+        Eigen::MatrixXd res = y - XA * beta_A;
+        res.rowwise() -= coef0_X.transpose();
+        d = this->XTr_working(X, res) / double(n) - 2 * this->lambda_level * beta;
       }
       else
       {
-        d = X.adjoint() * (y - array_product(one, coef0)) / double(n);
+        Eigen::MatrixXd res = y - array_product(one, coef0);
+        d = this->XTr_working(X, res) / double(n);
       }
     }
     else
@@ -1696,23 +2245,19 @@ public:
     int A_size = A.size();
     int I_size = I.size();
 
-    Eigen::MatrixXd betabar = Eigen::MatrixXd::Zero(p, M);
-    Eigen::MatrixXd dbar = Eigen::MatrixXd::Zero(p, M);
-    Eigen::MatrixXd phiG, invphiG;
+    Eigen::MatrixXd &betabar = this->workspace().betabar;
+    Eigen::MatrixXd &dbar = this->workspace().dbar;
+    betabar.setZero(p, M);
+    dbar.setZero(p, M);
 
-    for (int i = 0; i < N; i++)
-    {
-      phiG = this->PhiG(i, 0);
-      invphiG = this->invPhiG(i, 0);
-      betabar.block(g_index(i), 0, g_size(i), M) = phiG * beta.block(g_index(i), 0, g_size(i), M);
-      dbar.block(g_index(i), 0, g_size(i), M) = invphiG * d.block(g_index(i), 0, g_size(i), M);
-    }
     for (int i = 0; i < A_size; i++)
     {
+      betabar.block(g_index(A[i]), 0, g_size(A[i]), M).noalias() = this->PhiG(A[i], 0) * beta.block(g_index(A[i]), 0, g_size(A[i]), M);
       bd(A[i]) = betabar.block(g_index(A[i]), 0, g_size(A[i]), M).squaredNorm() / g_size(A[i]);
     }
     for (int i = 0; i < I_size; i++)
     {
+      dbar.block(g_index(I[i]), 0, g_size(I[i]), M).noalias() = this->invPhiG(I[i], 0) * d.block(g_index(I[i]), 0, g_size(I[i]), M);
       bd(I[i]) = dbar.block(g_index(I[i]), 0, g_size(I[i]), M).squaredNorm() / g_size(I[i]);
     }
 #ifdef TEST
@@ -1721,7 +2266,7 @@ public:
 #endif
   }
 
-  double effective_number_of_parameter(T4 &X, T4 &XA, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0)
+  double effective_number_of_parameter(T4 &X, T5 &XA, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0)
   {
     if (this->lambda_level == 0.)
     {
@@ -1739,14 +2284,27 @@ public:
 };
 
 template <class T4>
-class abessMultinomial : public Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>
+class abessMultinomial final : public SplicingAlgorithm<abessMultinomial<T4>, Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>
 {
 public:
-  abessMultinomial(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), bool covariance_update = true, int splicing_type = 0) : Algorithm<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  abessMultinomial(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), bool covariance_update = true, int splicing_type = 0) : SplicingAlgorithm<abessMultinomial<T4>, Eigen::MatrixXd, Eigen::MatrixXd, Eigen::VectorXd, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, covariance_update, splicing_type){};
 
   ~abessMultinomial(){};
 
-  void primary_model_fit(T4 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  void primary_model_fit(T5 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  {
+    this->multinomial_fit(x, y, weights, beta, coef0, loss0, A, g_index, g_size, 0, this->lbfgs_memory);
+  };
+
+  void exchange_fit(T5 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot)
+  {
+    this->multinomial_fit(x, y, weights, beta, coef0, loss0, A, g_index, g_size, slot, this->exchange_lbfgs[slot]);
+  };
+
+  // the primary fit for exchange slot, whose L-BFGS steps start from and update memory
+  void multinomial_fit(T5 &x, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int slot, LbfgsMemory &memory)
   {
 #ifdef TEST
     clock_t t1 = clock();
@@ -1761,20 +2319,34 @@ public:
 #ifdef TEST
     std::cout << "primary_model_fit 1" << endl;
 #endif
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     int n = x.rows();
     int p = x.cols();
     int M = y.cols();
-    T4 X(n, p + 1);
+    Workspace<Eigen::MatrixXd, T5> &ws = this->workspace(slot);
+    T5 &X = ws.X;
+    X.resize(n, p + 1);
     X.rightCols(p) = x;
     add_constant_column(X);
-    Eigen::MatrixXd lambdamat = Eigen::MatrixXd::Identity(p + 1, p + 1);
     Eigen::MatrixXd beta0 = Eigen::MatrixXd::Zero(p + 1, M);
 
-    Eigen::MatrixXd one_vec = Eigen::VectorXd::Ones(n);
     beta0.row(0) = coef0;
     beta0.block(1, 0, p, M) = beta;
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    if (this->primary_solver != 0)
+    {
+      MultinomialObjective<T5> f(X, y, weights, this->lambda_level, center);
+      Eigen::VectorXd coef = Eigen::Map<Eigen::VectorXd>(beta0.data(), (p + 1) * M);
+      int iter = this->solver_fit(f, coef, M, A, g_index, g_size, memory, loss0);
+      this->count_primary_fit(slot, iter, start);
+      beta0 = Eigen::Map<Eigen::MatrixXd>(coef.data(), p + 1, M);
+      beta = beta0.block(1, 0, p, M);
+      coef0 = beta0.row(0).eval();
+      return;
+    }
+
     Eigen::MatrixXd Pi;
-    pi(X, y, beta0, Pi);
+    pi(X, y, beta0, Pi, center);
     Eigen::MatrixXd log_Pi = Pi.array().log();
     array_product(log_Pi, weights, 1);
     double loglik1 = DBL_MAX, loglik0 = (log_Pi.array() * y.array()).sum();
@@ -1782,12 +2354,19 @@ public:
     int j;
     if (this->approximate_Newton)
     {
-      Eigen::MatrixXd one = Eigen::MatrixXd::Ones(n, M);
-      double t = 2 * (Pi.array() * (one - Pi).array()).maxCoeff();
-      Eigen::MatrixXd res = X.transpose() * (y - Pi) / t;
+      double t = 2 * (Pi.array() * (1 - Pi.array())).maxCoeff();
+      CenteredColumns centered(center);
+      Eigen::MatrixXd res = y - Pi;
+      res = XTr(X, res, centered.all) / t;
       // ConjugateGradient<MatrixXd, Lower | Upper> cg;
       // cg.compute(X.adjoint() * X);
-      Eigen::MatrixXd XTX = X.transpose() * X + this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols());
+      Eigen::MatrixXd XTX = X.transpose() * X;
+      if (center.size() != 0)
+      {
+        Eigen::VectorXd XTone = X.transpose() * ws.ones(n);
+        center_XTHX(XTX, XTone, n, centered.all);
+      }
+      XTX += this->lambda_level * Eigen::MatrixXd::Identity(X.cols(), X.cols());
       Eigen::MatrixXd invXTX = XTX.ldlt().solve(Eigen::MatrixXd::Identity(p + 1, p + 1));
 
       // cout << "y: " << y.rows() << " " << y.cols() << endl;
@@ -1817,7 +2396,7 @@ public:
         // cout << "app_loss1: " << app_loss1 << endl;
         // cout << "app_loss2: " << app_loss2 << endl;
 
-        pi(X, y, beta1, Pi);
+        pi(X, y, beta1, Pi, center);
         log_Pi = Pi.array().log();
         array_product(log_Pi, weights, 1);
         loglik1 = (log_Pi.array() * y.array()).sum();
@@ -1844,127 +2423,24 @@ public:
         }
 
         // beta0 = beta1;
-        t = 2 * (Pi.array() * (one - Pi).array()).maxCoeff();
-        res = X.transpose() * (y - Pi) / t;
+        t = 2 * (Pi.array() * (1 - Pi.array())).maxCoeff();
+        res = y - Pi;
+        res = XTr(X, res, centered.all) / t;
       }
     }
     else
     {
-      Eigen::MatrixXd W(M * n, M * n);
-      Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
-      for (int m1 = 0; m1 < M; m1++)
-      {
-        for (int m2 = m1; m2 < M; m2++)
-        {
-          if (m1 == m2)
-          {
-            W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-#ifdef TEST
-            std::cout << "primary_model_fit 5" << endl;
-
-#endif
-            Eigen::VectorXd PiPj = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-            // cout << "PiPj: " << PiPj << endl;
-            for (int i = 0; i < PiPj.size(); i++)
-            {
-              if (PiPj(i) < 0.001)
-              {
-                PiPj(i) = 0.001;
-              }
-            }
-            W.block(m1 * n, m2 * n, n, n).diagonal() = PiPj;
-
-#ifdef TEST
-            std::cout << "primary_model_fit 6" << endl;
-            cout << "W m1 m2: " << W.block(m1 * n, m2 * n, n, n) << endl;
-#endif
-          }
-          else
-          {
-            W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-#ifdef TEST
-            std::cout << "primary_model_fit 5" << endl;
+      Eigen::MatrixXd XTWX;
+      Eigen::VectorXd XTWz;
+      multinomial_irls(X, y, Pi, beta0, this->lambda_level, XTWX, XTWz, center);
 
-#endif
-            Eigen::VectorXd PiPj = Pi.col(m1).array() * Pi.col(m2).array();
-            // cout << "PiPj: " << PiPj << endl;
-            for (int i = 0; i < PiPj.size(); i++)
-            {
-              if (PiPj(i) < 0.001)
-              {
-                PiPj(i) = 0.001;
-              }
-            }
-            W.block(m1 * n, m2 * n, n, n).diagonal() = -PiPj;
-            W.block(m2 * n, m1 * n, n, n) = W.block(m1 * n, m2 * n, n, n);
-
-            // cout << "W m1 m2: " << W.block(m1 * n, m2 * n, n, n) << endl;
-          }
-        }
-      }
-
-#ifdef TEST
-      std::cout << "primary_model_fit 7" << endl;
-#endif
-      // cout << "W: " << W << endl;
-
-      Eigen::MatrixXd XTWX(M * (p + 1), M * (p + 1));
-      Eigen::MatrixXd XTW(M * (p + 1), M * n);
-      for (int m1 = 0; m1 < M; m1++)
-      {
-        for (int m2 = m1; m2 < M; m2++)
-        {
-          XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) = X.transpose() * W.block(m1 * n, m2 * n, n, n);
-          XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1)) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) * X + 2 * this->lambda_level * lambdamat;
-          XTW.block(m2 * (p + 1), m1 * n, (p + 1), n) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n);
-          XTWX.block(m2 * (p + 1), m1 * (p + 1), (p + 1), (p + 1)) = XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1));
-        }
-      }
-
-#ifdef TEST
-      std::cout << "primary_model_fit 8" << endl;
-#endif
-
-      // Eigen::Matrix<Eigen::MatrixXd, -1, -1> res(M, 1);
-      Eigen::VectorXd res(M * n);
-      for (int m1 = 0; m1 < M; m1++)
-      {
-        res.segment(m1 * n, n) = y.col(m1).eval() - Pi.col(m1).eval();
-      }
-
-#ifdef TEST
-      std::cout << "primary_model_fit 9" << endl;
-      cout << "res: " << res << endl;
-#endif
-
-      Eigen::VectorXd Xbeta(M * n);
-      for (int m1 = 0; m1 < M; m1++)
-      {
-        Xbeta.segment(m1 * n, n) = X * beta0.col(m1).eval();
-      }
-
-#ifdef TEST
-      std::cout << "primary_model_fit 10" << endl;
-      cout << "Xbeta: " << Xbeta << endl;
-#endif
-
-      Eigen::VectorXd Z = Xbeta + W.ldlt().solve(res);
-#ifdef TEST
-      std::cout << "primary_model_fit 11" << endl;
-#endif
-
-#ifdef TEST
-      std::cout << "primary_model_fit 2" << endl;
-#endif
-
-      Eigen::MatrixXd beta1;
       Eigen::VectorXd beta0_tmp;
       for (j = 0; j < this->primary_model_fit_max_iter; j++)
       {
 #ifdef TEST
         std::cout << "primary_model_fit 3: " << j << endl;
 #endif
-        beta0_tmp = XTWX.ldlt().solve(XTW * Z);
+        beta0_tmp = XTWX.ldlt().solve(XTWz);
         for (int m1 = 0; m1 < M; m1++)
         {
           beta0.col(m1) = beta0_tmp.segment(m1 * (p + 1), (p + 1)) - beta0_tmp.segment((M - 1) * (p + 1), (p + 1));
@@ -1975,7 +2451,7 @@ public:
         }
         // cout << "beta0" << beta0 << endl;
 
-        pi(X, y, beta0, Pi);
+        pi(X, y, beta0, Pi, center);
         log_Pi = Pi.array().log();
         array_product(log_Pi, weights, 1);
         loglik1 = (log_Pi.array() * y.array()).sum();
@@ -1996,67 +2472,10 @@ public:
         }
         loglik0 = loglik1;
 
-        for (int m1 = 0; m1 < M; m1++)
-        {
-          for (int m2 = m1; m2 < M; m2++)
-          {
-            if (m1 == m2)
-            {
-              // W(m1, m2) = Eigen::MatrixXd::Zero(n, n);
-              // W(m1, m2).diagonal() = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-
-              W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-              Eigen::VectorXd PiPj = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-              for (int i = 0; i < PiPj.size(); i++)
-              {
-                if (PiPj(i) < 0.001)
-                {
-                  PiPj(i) = 0.001;
-                }
-              }
-              W.block(m1 * n, m2 * n, n, n).diagonal() = PiPj;
-            }
-            else
-            {
-              W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-              Eigen::VectorXd PiPj = Pi.col(m1).array() * Pi.col(m2).array();
-              for (int i = 0; i < PiPj.size(); i++)
-              {
-                if (PiPj(i) < 0.001)
-                {
-                  PiPj(i) = 0.001;
-                }
-              }
-              W.block(m1 * n, m2 * n, n, n).diagonal() = -PiPj;
-              W.block(m2 * n, m1 * n, n, n) = W.block(m1 * n, m2 * n, n, n);
-            }
-          }
-        }
-
-        for (int m1 = 0; m1 < M; m1++)
-        {
-          for (int m2 = m1; m2 < M; m2++)
-          {
-            XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) = X.transpose() * W.block(m1 * n, m2 * n, n, n);
-            XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1)) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) * X + 2 * this->lambda_level * lambdamat;
-            XTW.block(m2 * (p + 1), m1 * n, (p + 1), n) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n);
-            XTWX.block(m2 * (p + 1), m1 * (p + 1), (p + 1), (p + 1)) = XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1));
-          }
-        }
-
-        for (int m1 = 0; m1 < M; m1++)
-        {
-          res.segment(m1 * n, n) = y.col(m1).eval() - Pi.col(m1).eval();
-        }
-
-        for (int m1 = 0; m1 < M; m1++)
-        {
-          Xbeta.segment(m1 * n, n) = X * beta0.col(m1).eval();
-        }
-
-        Z = Xbeta + W.ldlt().solve(res);
+        multinomial_irls(X, y, Pi, beta0, this->lambda_level, XTWX, XTWz, center);
       }
     }
+    this->count_primary_fit(slot, min(j + 1, this->primary_model_fit_max_iter), start);
 
 #ifdef TEST
     clock_t t2 = clock();
@@ -2068,11 +2487,13 @@ public:
     coef0 = beta0.row(0).eval();
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
     // weight
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    Eigen::VectorXd coef0_X = coef0 - center_shift(center, beta);
     Eigen::MatrixXd pr;
-    pi(X, y, beta, coef0, pr);
+    pi(X, y, beta, coef0_X, pr);
     Eigen::MatrixXd log_pr = pr.array().log();
     // Eigen::VectorXd one_vec = Eigen::VectorXd::Ones(X.rows());
     // cout << "loss 0" << endl;
@@ -2081,26 +2502,27 @@ public:
     return -((log_pr.array() * y.array()).sum());
   }
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::MatrixXd &y, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  void sacrifice(T4 &X, T5 &XA, Eigen::MatrixXd &y, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     clock_t t1 = clock(), t2;
 #endif
-    int p = X.cols();
-    int n = X.rows();
+    int n = this->train_rows(X);
     int M = y.cols();
 
     Eigen::MatrixXd d;
     Eigen::MatrixXd h;
     Eigen::MatrixXd pr;
-    pi(XA, y, beta_A, coef0, pr);
+    Eigen::VectorXd center = this->fit_center(A, g_index, g_size);
+    Eigen::VectorXd coef0_X = coef0 - center_shift(center, beta_A);
+    pi(XA, y, beta_A, coef0_X, pr);
     Eigen::MatrixXd Pi = pr.leftCols(M - 1);
     Eigen::MatrixXd res = (y.leftCols(M - 1) - Pi);
     for (int i = 0; i < n; i++)
     {
       res.row(i) = res.row(i) * weights(i);
     }
-    d = X.transpose() * res - 2 * this->lambda_level * beta;
+    d = this->XTr_working(X, res) - 2 * this->lambda_level * beta;
     h = Pi;
 
 #ifdef TEST
@@ -2109,24 +2531,42 @@ public:
     t1 = clock();
 #endif
 
-    // int A_size = A.size();
-    // int I_size = I.size();
+    int A_size = A.size();
+    int I_size = I.size();
 
-    Eigen::MatrixXd betabar = Eigen::MatrixXd::Zero(p, M);
-    Eigen::MatrixXd dbar = Eigen::MatrixXd::Zero(p, M);
-    Eigen::MatrixXd phiG, invphiG;
+    Workspace<Eigen::MatrixXd, T5> &ws = this->workspace();
+    T5 &XG = ws.XG;
+    T5 &XG_new = ws.XG_new;
+    Eigen::MatrixXd hTh;
+    Eigen::VectorXd h_sum;
+    if (this->x_center.size() != 0)
+    {
+      hTh = h.transpose() * h;
+      h_sum = h.colwise().sum().transpose();
+    }
 
-    for (int i = 0; i < N; i++)
+    for (int k = 0; k < A_size + I_size; k++)
     {
-      T4 XG = X.middleCols(g_index(i), g_size(i));
-      T4 XG_new(h.rows(), h.cols());
+      int i = k < A_size ? A(k) : I(k - A_size);
+      X_cols(X, this->train_mask, g_index(i), g_size(i), XG);
+      XG_new.resize(h.rows(), h.cols());
       for (int m = 0; m < M - 1; m++)
       {
         XG_new.col(m) = h.col(m).cwiseProduct(XG);
       }
-      Eigen::MatrixXd XGbar = -XG_new.transpose() * XG_new;
+      Eigen::MatrixXd &XGbar = ws.XGbar;
+      XGbar = -XG_new.transpose() * XG_new;
       // cout << "h: " << h << endl;
       XGbar.diagonal() = Eigen::VectorXd(XG_new.transpose() * XG) + XGbar.diagonal();
+      if (this->x_center.size() != 0)
+      {
+        // the same for the centered column XG - c
+        double c = this->x_center(g_index(i));
+        Eigen::MatrixXd hTXGh = XG_new.transpose() * h;
+        Eigen::VectorXd hTXG = h.transpose() * XG;
+        XGbar += 2 * c * hTXGh - c * c * hTh;
+        XGbar.diagonal() += c * c * h_sum - 2 * c * hTXG;
+      }
 
       XGbar = XGbar + 2 * this->lambda_level * Eigen::MatrixXd::Identity(M - 1, M - 1);
 
@@ -2154,7 +2594,7 @@ public:
 #endif
   }
 
-  double effective_number_of_parameter(T4 &x, T4 &XA, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0)
+  double effective_number_of_parameter(T4 &x, T5 &XA, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::MatrixXd &beta, Eigen::MatrixXd &beta_A, Eigen::VectorXd &coef0)
   {
     if (this->lambda_level == 0.)
     {
@@ -2169,91 +2609,25 @@ public:
       int n = XA.rows();
       int p = XA.cols();
       int M = y.cols();
-      T4 X(n, p + 1);
+      T5 &X = this->workspace().X;
+      X.resize(n, p + 1);
       X.rightCols(p) = XA;
       add_constant_column(X);
-      Eigen::MatrixXd lambdamat = Eigen::MatrixXd::Identity(p + 1, p + 1);
       Eigen::MatrixXd beta0 = Eigen::MatrixXd::Zero(p + 1, M);
 
-      Eigen::MatrixXd one_vec = Eigen::VectorXd::Ones(n);
       beta0.row(0) = coef0;
       beta0.block(1, 0, p, M) = beta;
+      // XA is the active_X of fit()
+      Eigen::VectorXd center = this->center_of(this->active_ind);
       Eigen::MatrixXd Pi;
-      pi(X, y, beta0, Pi);
+      pi(X, y, beta0, Pi, center);
       // Eigen::MatrixXd log_Pi = Pi.array().log();
       // array_product(log_Pi, weights, 1);
       // double loglik1 = DBL_MAX, loglik0 = (log_Pi.array() * y.array()).sum();
 
-      Eigen::MatrixXd W(M * n, M * n);
-      Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
-      for (int m1 = 0; m1 < M; m1++)
-      {
-        for (int m2 = m1; m2 < M; m2++)
-        {
-          if (m1 == m2)
-          {
-            W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-#ifdef TEST
-            std::cout << "primary_model_fit 5" << endl;
-
-#endif
-            Eigen::VectorXd PiPj = Pi.col(m1).array() * (one - Pi.col(m1).eval()).array();
-            // cout << "PiPj: " << PiPj << endl;
-            for (int i = 0; i < PiPj.size(); i++)
-            {
-              if (PiPj(i) < 0.001)
-              {
-                PiPj(i) = 0.001;
-              }
-            }
-            W.block(m1 * n, m2 * n, n, n).diagonal() = PiPj;
-
-#ifdef TEST
-            std::cout << "primary_model_fit 6" << endl;
-            cout << "W m1 m2: " << W.block(m1 * n, m2 * n, n, n) << endl;
-#endif
-          }
-          else
-          {
-            W.block(m1 * n, m2 * n, n, n) = Eigen::MatrixXd::Zero(n, n);
-#ifdef TEST
-            std::cout << "primary_model_fit 5" << endl;
-
-#endif
-            Eigen::VectorXd PiPj = Pi.col(m1).array() * Pi.col(m2).array();
-            // cout << "PiPj: " << PiPj << endl;
-            for (int i = 0; i < PiPj.size(); i++)
-            {
-              if (PiPj(i) < 0.001)
-              {
-                PiPj(i) = 0.001;
-              }
-            }
-            W.block(m1 * n, m2 * n, n, n).diagonal() = -PiPj;
-            W.block(m2 * n, m1 * n, n, n) = W.block(m1 * n, m2 * n, n, n);
-
-            // cout << "W m1 m2: " << W.block(m1 * n, m2 * n, n, n) << endl;
-          }
-        }
-      }
-
-#ifdef TEST
-      std::cout << "primary_model_fit 7" << endl;
-#endif
-      // cout << "W: " << W << endl;
-
-      Eigen::MatrixXd XTWX(M * (p + 1), M * (p + 1));
-      Eigen::MatrixXd XTW(M * (p + 1), M * n);
-      for (int m1 = 0; m1 < M; m1++)
-      {
-        for (int m2 = m1; m2 < M; m2++)
-        {
-          XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) = X.transpose() * W.block(m1 * n, m2 * n, n, n);
-          XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1)) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n) * X + 2 * this->lambda_level * lambdamat;
-          XTW.block(m2 * (p + 1), m1 * n, (p + 1), n) = XTW.block(m1 * (p + 1), m2 * n, (p + 1), n);
-          XTWX.block(m2 * (p + 1), m1 * (p + 1), (p + 1), (p + 1)) = XTWX.block(m1 * (p + 1), m2 * (p + 1), (p + 1), (p + 1));
-        }
-      }
+      Eigen::MatrixXd XTWX;
+      Eigen::VectorXd XTWz;
+      multinomial_irls(X, y, Pi, beta0, this->lambda_level, XTWX, XTWz, center);
 
 #ifdef TEST
       t2 = clock();
@@ -2264,7 +2638,7 @@ public:
       // Eigen::VectorXd d = X.transpose() * res - 2 * this->lambda_level * beta;
       // Eigen::VectorXd h = weights.array() * pr.array() * (one - pr).array();
 
-      // T4 XA_new = XA;
+      // T5 XA_new = XA;
       // for (int j = 0; j < XA.cols(); j++)
       // {
       //   XA_new.col(j) = XA.col(j).cwiseProduct(h);
@@ -2286,10 +2660,12 @@ public:
 };
 
 template <class T4>
-class abessPCA : public Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>
+class abessPCA final : public SplicingAlgorithm<abessPCA<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>
 {
 public:
-  abessPCA(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 1) : Algorithm<Eigen::VectorXd, Eigen::VectorXd, double, T4>::Algorithm(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
+  typedef typename ActiveDesign<T4>::type T5;
+
+  abessPCA(int algorithm_type, int model_type, int max_iter = 30, int primary_model_fit_max_iter = 30, double primary_model_fit_epsilon = 1e-8, bool warm_start = true, int exchange_num = 5, bool approximate_Newton = false, Eigen::VectorXi always_select = Eigen::VectorXi::Zero(0), int splicing_type = 1) : SplicingAlgorithm<abessPCA<T4>, Eigen::VectorXd, Eigen::VectorXd, double, T4>(algorithm_type, model_type, max_iter, primary_model_fit_max_iter, primary_model_fit_epsilon, warm_start, exchange_num, approximate_Newton, always_select, false, splicing_type){};
 
   ~abessPCA(){};
 
@@ -2318,7 +2694,7 @@ public:
     return SA;
   }
 
-  void primary_model_fit(T4 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  void primary_model_fit(T5 &x, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, double loss0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
 #ifdef TEST
     cout << "<< SPCA primary_model_fit >>" << endl;
@@ -2354,7 +2730,7 @@ public:
     return;
   };
 
-  double neg_loglik_loss(T4 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
+  double neg_loglik_loss(T5 &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size)
   {
 #ifdef TEST
     cout << "<< SPCA Loss >>" << endl;
@@ -2367,7 +2743,7 @@ public:
     return -beta.transpose() * Y * beta;
   };
 
-  void sacrifice(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
+  void sacrifice(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0, Eigen::VectorXi &A, Eigen::VectorXi &I, Eigen::VectorXd &weights, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int N, Eigen::VectorXi &A_ind, Eigen::VectorXd &bd)
   {
 #ifdef TEST
     cout << "<< SPCA sacrifice >>" << endl;
@@ -2394,7 +2770,7 @@ public:
 #endif
   };
 
-  double effective_number_of_parameter(T4 &X, T4 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
+  double effective_number_of_parameter(T4 &X, T5 &XA, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &beta, Eigen::VectorXd &beta_A, double &coef0)
   {
     //  to be added
     return XA.cols();
@@ -15,6 +15,7 @@
 
 #include <vector>
 #include "normalize.h"
+#include "utilities.h"
 using namespace std;
 using namespace Eigen;
 
@@ -27,6 +28,9 @@ public:
     Eigen::VectorXd weight;
     Eigen::VectorXd x_mean;
     Eigen::VectorXd x_norm;
+    // a sparse x is only scaled by normalize(); its columns are centered by subtracting x_center
+    // wherever they are used, and x_center is empty for a dense x or one that needs no centering
+    Eigen::VectorXd x_center;
     T3 y_mean;
     int n;
     int p;
@@ -41,9 +45,11 @@ public:
 
     Data() = default;
 
-    Data(T4 &x, T1 &y, int data_type, Eigen::VectorXd &weight, bool is_normal, Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool sparse_matrix)
+    // x may be a Map over the caller's buffer, it is only read once here, with its rows taken in row_order if it is not empty
+    template <class T5>
+    Data(T5 &x, T1 &y, int data_type, Eigen::VectorXd &weight, bool is_normal, Eigen::VectorXi &g_index, Eigen::VectorXi &status, bool sparse_matrix, Eigen::VectorXi &row_order)
     {
-        this->x = x;
+        copy_design(this->x, x, row_order);
         this->y = y;
         this->data_type = data_type;
         this->n = x.rows();
@@ -57,10 +63,13 @@ public:
 
         this->status = status;
 
-        // to do !!!!!!!!!!!!!!!!!!!!!!!!!
-        if (is_normal && !sparse_matrix)
+        if (is_normal)
         {
             this->normalize();
+            if (sparse_matrix && data_type != 3)
+            {
+                this->x_center = this->x_mean.cwiseProduct(sqrt(double(this->n)) * this->x_norm.cwiseInverse());
+            }
         }
 
         this->g_index = g_index;
@@ -72,6 +81,17 @@ public:
         this->g_size = temp - g_index;
     };
 
+    // a new response on the same x, only y needs to be re-centered
+    void update_y(T1 &y, Eigen::VectorXi &status)
+    {
+        this->y = y;
+        this->status = status;
+        if (this->is_normal && this->data_type == 1)
+        {
+            Normalize_y(this->y, this->weight, this->y_mean);
+        }
+    };
+
     // to do
     void add_weight()
     {
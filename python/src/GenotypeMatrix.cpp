@@ -0,0 +1,101 @@
+#include "GenotypeMatrix.h"
+
+#include <cstring>
+
+GenotypeMatrix::GenotypeMatrix(const uint8_t *codes, int n, int p)
+{
+    this->n = n;
+    this->p = p;
+    this->stride = (n + 3) / 4;
+    this->codes.assign(codes, codes + (int64_t)this->stride * p);
+
+    // a missing genotype is read as the mean of the observed ones
+    this->values.resize(4, p);
+    Eigen::VectorXd one = Eigen::VectorXd::Ones(n);
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < p; j++)
+    {
+        double count[4];
+        this->code_sums(j, one.data(), count);
+        double observed = count[0] + count[1] + count[2];
+        this->values(0, j) = 0;
+        this->values(1, j) = 1;
+        this->values(2, j) = 2;
+        this->values(3, j) = observed > 0 ? (count[1] + 2 * count[2]) / observed : 0;
+    }
+}
+
+void GenotypeMatrix::unpack(int j, double *x) const
+{
+    const uint8_t *col = this->codes.data() + (int64_t)j * this->stride;
+    const double *v = this->values.col(j).data();
+    int full = this->n / 4;
+    for (int b = 0; b < full; b++)
+    {
+        uint8_t c = col[b];
+        x[4 * b] = v[c & 3];
+        x[4 * b + 1] = v[(c >> 2) & 3];
+        x[4 * b + 2] = v[(c >> 4) & 3];
+        x[4 * b + 3] = v[c >> 6];
+    }
+    for (int i = 4 * full; i < this->n; i++)
+        x[i] = v[(col[full] >> (2 * (i % 4))) & 3];
+}
+
+void GenotypeMatrix::code_sums(int j, const double *r, double *sums) const
+{
+    const uint8_t *col = this->codes.data() + (int64_t)j * this->stride;
+    double s[4] = {0, 0, 0, 0};
+    int full = this->n / 4;
+    for (int b = 0; b < full; b++)
+    {
+        uint8_t c = col[b];
+        s[c & 3] += r[4 * b];
+        s[(c >> 2) & 3] += r[4 * b + 1];
+        s[(c >> 4) & 3] += r[4 * b + 2];
+        s[c >> 6] += r[4 * b + 3];
+    }
+    for (int i = 4 * full; i < this->n; i++)
+        s[(col[full] >> (2 * (i % 4))) & 3] += r[i];
+    memcpy(sums, s, sizeof(s));
+}
+
+double GenotypeMatrix::dot(int j, const double *r) const
+{
+    double s[4];
+    this->code_sums(j, r, s);
+    return this->values(0, j) * s[0] + this->values(1, j) * s[1] + this->values(2, j) * s[2] + this->values(3, j) * s[3];
+}
+
+void GenotypeMatrix::slice(Eigen::VectorXi &ind, GenotypeMatrix &A, int axis) const
+{
+    int k = ind.size();
+    if (axis == 0)
+    {
+        A.n = k;
+        A.p = this->p;
+        A.stride = (k + 3) / 4;
+        A.codes.assign((int64_t)A.stride * A.p, 0);
+        A.values = this->values;
+#pragma omp parallel for schedule(static)
+        for (int j = 0; j < this->p; j++)
+        {
+            uint8_t *col = A.codes.data() + (int64_t)j * A.stride;
+            for (int i = 0; i < k; i++)
+                col[i / 4] |= this->code(ind(i), j) << (2 * (i % 4));
+        }
+    }
+    else
+    {
+        A.n = this->n;
+        A.p = k;
+        A.stride = this->stride;
+        A.codes.resize((int64_t)A.stride * k);
+        A.values.resize(4, k);
+        for (int j = 0; j < k; j++)
+        {
+            memcpy(A.codes.data() + (int64_t)j * A.stride, this->codes.data() + (int64_t)ind(j) * this->stride, this->stride);
+            A.values.col(j) = this->values.col(ind(j));
+        }
+    }
+}
@@ -69,6 +69,21 @@ void List::add(string name, MatrixXd &value)
     vector_MatrixXd_name.push_back(name);
 }
 
+void List::add(string name, MatrixXi &value)
+{
+    std::size_t i;
+    for (i = 0; i < vector_MatrixXi_name.size(); i++)
+    {
+        if (vector_MatrixXi_name[i] == name)
+        {
+            vector_MatrixXi[i] = value;
+            return;
+        }
+    }
+    vector_MatrixXi.push_back(value);
+    vector_MatrixXi_name.push_back(name);
+}
+
 void List::add(string name, VectorXd &value)
 {
     //	cout<<"value in VectorXd add"<<endl;
@@ -165,6 +180,34 @@ void List::get_value_by_name(string name, Eigen::Matrix<VectorXd, Dynamic, Dynam
     }
 }
 
+void List::add(string name, Eigen::Matrix<MatrixXd, Dynamic, Dynamic> &value)
+{
+    std::size_t i;
+    for (i = 0; i < vector_Matrix_MatrixXd_name.size(); i++)
+    {
+        if (vector_Matrix_MatrixXd_name[i] == name)
+        {
+            vector_Matrix_MatrixXd[i] = value;
+            return;
+        }
+    }
+    vector_Matrix_MatrixXd.push_back(value);
+    vector_Matrix_MatrixXd_name.push_back(name);
+}
+
+void List::get_value_by_name(string name, Eigen::Matrix<MatrixXd, Dynamic, Dynamic> &value)
+{
+    std::size_t i;
+    for (i = 0; i < vector_Matrix_MatrixXd_name.size(); i++)
+    {
+        if (vector_Matrix_MatrixXd_name[i] == name)
+        {
+            value = vector_Matrix_MatrixXd[i];
+            break;
+        }
+    }
+}
+
 void List::get_value_by_name(string name, int &value)
 {
     std::size_t i;
@@ -207,6 +250,19 @@ void List::get_value_by_name(string name, MatrixXd &value)
     }
 }
 
+void List::get_value_by_name(string name, MatrixXi &value)
+{
+    std::size_t i;
+    for (i = 0; i < vector_MatrixXi_name.size(); i++)
+    {
+        if (vector_MatrixXi_name[i] == name)
+        {
+            value = vector_MatrixXi[i];
+            break;
+        }
+    }
+}
+
 void List::get_value_by_name(string name, VectorXd &value)
 {
     std::size_t i;
@@ -18,6 +18,8 @@ public:
 	void get_value_by_name(string name, double &value);
 	void add(string name, MatrixXd &value);
 	void get_value_by_name(string name, MatrixXd &value);
+	void add(string name, MatrixXi &value);
+	void get_value_by_name(string name, MatrixXi &value);
 	void add(string name, VectorXd &value);
 	void get_value_by_name(string name, VectorXd &value);
 	void add(string name, VectorXi &value);
@@ -26,6 +28,8 @@ public:
 	void get_value_by_name(string name, Eigen::Matrix<VectorXd, Dynamic, Dynamic> &value);
 	void add(string name, Eigen::Matrix<VectorXi, Dynamic, Dynamic> &value);
 	void get_value_by_name(string name, Eigen::Matrix<VectorXi, Dynamic, Dynamic> &value);
+	void add(string name, Eigen::Matrix<MatrixXd, Dynamic, Dynamic> &value);
+	void get_value_by_name(string name, Eigen::Matrix<MatrixXd, Dynamic, Dynamic> &value);
 
 private:
 	vector<int> vector_int;
@@ -34,6 +38,8 @@ private:
 	vector<string> vector_double_name;
 	vector<Eigen::MatrixXd> vector_MatrixXd;
 	vector<string> vector_MatrixXd_name;
+	vector<Eigen::MatrixXi> vector_MatrixXi;
+	vector<string> vector_MatrixXi_name;
 	vector<Eigen::VectorXd> vector_VectorXd;
 	vector<string> vector_VectorXd_name;
 	vector<Eigen::VectorXi> vector_VectorXi;
@@ -42,6 +48,8 @@ private:
 	vector<string> vector_Matrix_VectorXi_name;
 	vector<Eigen::Matrix<VectorXd, Dynamic, Dynamic>> vector_Matrix_VectorXd;
 	vector<string> vector_Matrix_VectorXd_name;
+	vector<Eigen::Matrix<MatrixXd, Dynamic, Dynamic>> vector_Matrix_MatrixXd;
+	vector<string> vector_Matrix_MatrixXd_name;
 };
 
 #endif //LIST_H
@@ -0,0 +1,223 @@
+#include "MappedDesign.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return;
+
+    MappedDesignHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "ABESSX01", 8) == 0 && header.version == 1 && header.dtype == 0 && header.n > 0 && header.p > 0 && header.data_offset >= (int64_t)(sizeof(header) + 2 * header.p * sizeof(double));
+    if (valid)
+    {
+        this->x_mean.resize(header.p);
+        this->x_norm.resize(header.p);
+        valid = fread(this->x_mean.data(), sizeof(double), header.p, file) == (size_t)header.p && fread(this->x_norm.data(), sizeof(double), header.p, file) == (size_t)header.p;
+    }
+    if (!valid)
+    {
+        fclose(file);
+        return;
+    }
+    this->n = header.n;
+    this->p = header.p;
+    int64_t data_size = header.n * header.p * (int64_t)sizeof(double);
+    this->map_size = header.data_offset + data_size;
+
+#ifndef _WIN32
+    fclose(file);
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < this->map_size)
+    {
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    void *map = mmap(NULL, this->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return;
+    this->map = map;
+    this->data = (const double *)((char *)map + header.data_offset);
+#else
+    // no mmap, the columns are read into memory
+    double *buffer = (double *)malloc(data_size);
+    if (buffer != NULL && fseek(file, (long)header.data_offset, SEEK_SET) == 0 && fread(buffer, 1, data_size, file) == (size_t)data_size)
+    {
+        this->map = buffer;
+        this->data = buffer;
+    }
+    else
+    {
+        free(buffer);
+    }
+    fclose(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (this->map != NULL)
+        munmap(this->map, this->map_size);
+#else
+    free(this->map);
+#endif
+}
+
+void MappedFile::advise(int start, int cols, bool need) const
+{
+#ifndef _WIN32
+    if (cols <= 0)
+        return;
+    static const int64_t page = sysconf(_SC_PAGESIZE);
+    char *begin = (char *)this->col_ptr(start);
+    char *end = (char *)this->col_ptr(start + cols);
+    // madvise needs a page aligned address; a released range keeps its partial pages
+    char *aligned = (char *)this->map + ((begin - (char *)this->map) / page) * page;
+    if (!need)
+        aligned = (char *)this->map + ((begin - (char *)this->map + page - 1) / page) * page;
+    if (end > aligned)
+        madvise(aligned, end - aligned, need ? MADV_WILLNEED : MADV_DONTNEED);
+#endif
+}
+
+MappedDesign::MappedDesign(const char *path)
+{
+    this->file = std::make_shared<MappedFile>(path);
+    if (!this->file->is_open())
+        return;
+    this->n = this->file->n;
+    this->p = this->file->p;
+    this->scale = Eigen::VectorXd::Ones(this->p);
+    this->shift = Eigen::VectorXd::Zero(this->p);
+}
+
+bool MappedDesign::file_stats(Eigen::VectorXd &x_mean, Eigen::VectorXd &x_norm) const
+{
+    // the rows may only be permuted
+    if (this->n != this->file->n || (this->scale.array() != 1).any() || (this->shift.array() != 0).any())
+        return false;
+    x_mean.resize(this->p);
+    x_norm.resize(this->p);
+    for (int j = 0; j < this->p; j++)
+    {
+        x_mean(j) = this->file->x_mean(this->file_col(j));
+        x_norm(j) = this->file->x_norm(this->file_col(j));
+    }
+    return true;
+}
+
+void MappedDesign::unpack(int j, double *x) const
+{
+    const double *col = this->file->col_ptr(this->file_col(j));
+    double a = this->scale(j), b = this->shift(j);
+    if (this->row_ind.size() == 0)
+        for (int i = 0; i < this->n; i++)
+            x[i] = a * col[i] + b;
+    else
+        for (int i = 0; i < this->n; i++)
+            x[i] = a * col[this->row_ind(i)] + b;
+}
+
+double MappedDesign::dot(int j, const double *r) const
+{
+    const double *col = this->file->col_ptr(this->file_col(j));
+    double s = 0, r_sum = 0;
+    if (this->row_ind.size() == 0)
+        for (int i = 0; i < this->n; i++)
+        {
+            s += col[i] * r[i];
+            r_sum += r[i];
+        }
+    else
+        for (int i = 0; i < this->n; i++)
+        {
+            s += col[this->row_ind(i)] * r[i];
+            r_sum += r[i];
+        }
+    return this->scale(j) * s + this->shift(j) * r_sum;
+}
+
+void MappedDesign::advise(int start, int cols, bool need) const
+{
+    if (this->col_ind.size() == 0)
+    {
+        this->file->advise(start, cols, need);
+        return;
+    }
+    for (int j = start; j < start + cols; j++)
+        this->file->advise(this->col_ind(j), 1, need);
+}
+
+void MappedDesign::read_block(int start, int cols, Eigen::MatrixXd &x_block) const
+{
+    int next = start + cols;
+    this->advise(next, std::min(cols, this->p - next), true);
+
+    x_block.resize(this->n, cols);
+    for (int j = 0; j < cols; j++)
+        this->unpack(start + j, x_block.col(j).data());
+
+    this->advise(start, cols, false);
+}
+
+void MappedDesign::read_cols(Eigen::VectorXi &ind, Eigen::MatrixXd &x_cols) const
+{
+    int k = ind.size();
+    x_cols.resize(this->n, k);
+    if (k > 0)
+        this->advise(ind(0), 1, true);
+    for (int j = 0; j < k; j++)
+    {
+        if (j + 1 < k)
+            this->advise(ind(j + 1), 1, true);
+        this->unpack(ind(j), x_cols.col(j).data());
+        this->advise(ind(j), 1, false);
+    }
+}
+
+void MappedDesign::slice(Eigen::VectorXi &ind, MappedDesign &A, int axis) const
+{
+    int k = ind.size();
+    A.file = this->file;
+    if (axis == 0)
+    {
+        A.n = k;
+        A.p = this->p;
+        A.row_ind.resize(k);
+        for (int i = 0; i < k; i++)
+            A.row_ind(i) = this->row_ind.size() == 0 ? ind(i) : this->row_ind(ind(i));
+        A.col_ind = this->col_ind;
+        A.scale = this->scale;
+        A.shift = this->shift;
+    }
+    else
+    {
+        A.n = this->n;
+        A.p = k;
+        A.row_ind = this->row_ind;
+        A.col_ind.resize(k);
+        A.scale.resize(k);
+        A.shift.resize(k);
+        for (int j = 0; j < k; j++)
+        {
+            A.col_ind(j) = this->file_col(ind(j));
+            A.scale(j) = this->scale(ind(j));
+            A.shift(j) = this->shift(ind(j));
+        }
+    }
+}
@@ -31,12 +31,12 @@ public:
   std::vector<Eigen::VectorXi> train_mask_list;
   std::vector<Eigen::VectorXi> test_mask_list;
 
-  std::vector<T4> train_X_list;
-  std::vector<T4> test_X_list;
   std::vector<T1> train_y_list;
   std::vector<T1> test_y_list;
   std::vector<Eigen::VectorXd> train_weight_list;
   std::vector<Eigen::VectorXd> test_weight_list;
+  std::vector<Eigen::VectorXi> train_status_list;
+  std::vector<Eigen::VectorXi> test_status_list;
 
   std::vector<FIT_ARG<T2, T3>> cv_init_fit_arg;
 
@@ -55,12 +55,12 @@ public:
     if (is_cv)
     {
       cv_init_fit_arg.resize(Kfold);
-      train_X_list.resize(Kfold);
-      test_X_list.resize(Kfold);
       train_y_list.resize(Kfold);
       test_y_list.resize(Kfold);
       test_weight_list.resize(Kfold);
       train_weight_list.resize(Kfold);
+      train_status_list.resize(Kfold);
+      test_status_list.resize(Kfold);
     }
   };
 
@@ -169,18 +169,26 @@ public:
       train_mask_list_tmp[k] = train_mask;
       test_mask_list_tmp[k] = group_list[k];
 
-      slice(data.x, train_mask, this->train_X_list[k]);
-      slice(data.x, group_list[k], this->test_X_list[k]);
       slice(data.y, train_mask, this->train_y_list[k]);
       slice(data.y, group_list[k], this->test_y_list[k]);
       slice(data.weight, train_mask, this->train_weight_list[k]);
       slice(data.weight, group_list[k], this->test_weight_list[k]);
+      this->train_status_list[k] = fold_status(data.status, train_mask, n);
+      this->test_status_list[k] = fold_status(data.status, group_list[k], n);
     }
     // cout << "train_mask[0]: " << train_mask_list_tmp[0] << endl;
     this->train_mask_list = train_mask_list_tmp;
     this->test_mask_list = test_mask_list_tmp;
   };
 
+  // the status of the rows mask, when it is given by row
+  static Eigen::VectorXi fold_status(Eigen::VectorXi &status, Eigen::VectorXi &mask, int n)
+  {
+    if (status.size() != n)
+      return status;
+    return vector_slice(status, mask);
+  }
+
   // void cal_cv_group_XTX(Data<T1, T2, T3> &data)
   // {
   //   int p = data.p;
@@ -236,7 +244,8 @@ public:
       return 0;
   };
 
-  double neg_loglik_loss(T4 &train_x, T1 &train_y, Eigen::VectorXd &train_weight, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int train_n, int p, int N, Algorithm<T1, T2, T3, T4> *algorithm)
+  // the loss on the rows test_mask of x, which are only read in the active columns
+  double neg_loglik_loss(T4 &x, Eigen::VectorXi &test_mask, T1 &test_y, Eigen::VectorXd &test_weight, Eigen::VectorXi &test_status, Eigen::VectorXi &g_index, Eigen::VectorXi &g_size, int p, int N, Algorithm<T1, T2, T3, T4> *algorithm)
   {
     // clock_t t1 = clock();
     Eigen::VectorXi A = algorithm->get_A_out();
@@ -244,7 +253,7 @@ public:
     T3 coef0 = algorithm->get_coef0();
 
     Eigen::VectorXi A_ind = find_ind(A, g_index, g_size, p, N);
-    T4 X_A = X_seg(train_x, train_n, A_ind);
+    typename ActiveDesign<T4>::type X_A = X_seg(x, test_mask, A_ind);
 
     T2 beta_A;
     slice(beta, A_ind, beta_A);
@@ -254,7 +263,11 @@ public:
     // {
     //   beta_A(k) = beta(A_ind(k));
     // }
-    double L0 = algorithm->neg_loglik_loss(X_A, train_y, train_weight, beta_A, coef0, A, g_index, g_size);
+    // the risk sets of a cox model are those of the test rows
+    Eigen::VectorXi train_status = algorithm->status;
+    algorithm->status = test_status;
+    double L0 = algorithm->neg_loglik_loss(X_A, test_y, test_weight, beta_A, coef0, A, g_index, g_size);
+    algorithm->status = train_status;
     // clock_t t2 = clock();
     // std::cout << "ic loss time: " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
 
@@ -298,7 +311,6 @@ public:
       for (int k = 0; k < this->Kfold; k++)
       {
         //get test_x, test_y
-        int test_n = this->test_mask_list[k].size();
         int train_n = this->train_mask_list[k].size();
 
         // train & test data
@@ -325,9 +337,8 @@ public:
           // algorithm->update_coef0_init(this->cv_initial_coef0[k]);
           // algorithm->update_A_init(this->cv_initial_A[k], N);
         }
-        // algorithm->update_train_mask(this->train_mask_list[k]);
-        /// ??????????????????????????????????????????????????????????????
-        algorithm_list[k]->fit(this->train_X_list[k], this->train_y_list[k], this->train_weight_list[k], g_index, g_size, train_n, p, N, data.status, algorithm_list[k]->Sigma);
+        // the train mask of the fold is set by gs_path()
+        algorithm_list[k]->fit(data.x, this->train_y_list[k], this->train_weight_list[k], g_index, g_size, train_n, p, N, this->train_status_list[k], algorithm_list[k]->Sigma);
 
         if (algorithm_list[k]->get_warm_start())
         {
@@ -339,7 +350,7 @@ public:
           // this->update_cv_initial_coef0(algorithm->get_coef0(), k);
         }
 
-        loss_list(k) = this->neg_loglik_loss(this->test_X_list[k], this->test_y_list[k], this->test_weight_list[k], g_index, g_size, test_n, p, N, algorithm_list[k]);
+        loss_list(k) = this->neg_loglik_loss(data.x, this->test_mask_list[k], this->test_y_list[k], this->test_weight_list[k], this->test_status_list[k], g_index, g_size, p, N, algorithm_list[k]);
       }
 
       return loss_list.mean();
@@ -12,7 +12,10 @@ import_array();
 %}
 
 
-void pywrap_abess(double* IN_ARRAY2, int DIM1, int DIM2, double* IN_ARRAY2, int DIM1, int DIM2, int n, int p, int data_type, double* IN_ARRAY1, int DIM1, double* IN_ARRAY2, int DIM1, int DIM2,
+void pywrap_abess(double* IN_ARRAY2, int DIM1, int DIM2, double* IN_ARRAY2, int DIM1, int DIM2, int n, int p, int x_layout,
+                 double* IN_ARRAY1, int DIM1, int* IN_ARRAY1, int DIM1, int* IN_ARRAY1, int DIM1, int sparse_format,
+                 int* IN_ARRAY1, int DIM1,
+                 int data_type, double* IN_ARRAY1, int DIM1, double* IN_ARRAY2, int DIM1, int DIM2,
                  bool is_normal,
                  int algorithm_type, int model_type, int max_iter, int exchange_num,
                  int path_type, bool is_warm_start,
@@ -31,7 +34,85 @@ void pywrap_abess(double* IN_ARRAY2, int DIM1, int DIM2, double* IN_ARRAY2, int
                  bool covariance_update,
                  bool sparse_matrix,
                  int splicing_type,
-                 double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* OUTPUT, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1, int*OUTPUT);
+                 int important_search,
+                 double strong_rule,
+                 bool active_warm_start,
+                 int cox_ties,
+                 int primary_solver,
+                 bool parallel_exchange,
+                 double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* OUTPUT,
+                 double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1,
+                 int* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, int* OUTPUT);
+
+AbessSession *pywrap_session_new(double* IN_ARRAY2, int DIM1, int DIM2, double* IN_ARRAY2, int DIM1, int DIM2, int n, int p, int x_layout,
+                 double* IN_ARRAY1, int DIM1, int* IN_ARRAY1, int DIM1, int* IN_ARRAY1, int DIM1, int sparse_format,
+                 int* IN_ARRAY1, int DIM1,
+                 int data_type, double* IN_ARRAY1, int DIM1,
+                 bool is_normal,
+                 int *IN_ARRAY1, int DIM1,
+                 int* IN_ARRAY1, int DIM1,
+                 bool sparse_matrix);
+
+AbessSession *pywrap_session_new_float(float* IN_ARRAY2, int DIM1, int DIM2, double* IN_ARRAY2, int DIM1, int DIM2, int x_layout,
+                 int* IN_ARRAY1, int DIM1,
+                 int data_type, double* IN_ARRAY1, int DIM1,
+                 bool is_normal,
+                 int *IN_ARRAY1, int DIM1,
+                 int* IN_ARRAY1, int DIM1);
+
+AbessSession *pywrap_session_new_genotype(unsigned char* IN_ARRAY2, int DIM1, int DIM2, int n, double* IN_ARRAY2, int DIM1, int DIM2,
+                 int* IN_ARRAY1, int DIM1,
+                 int data_type, double* IN_ARRAY1, int DIM1,
+                 bool is_normal,
+                 int *IN_ARRAY1, int DIM1,
+                 int* IN_ARRAY1, int DIM1);
+
+AbessSession *pywrap_session_new_mapped(MappedDesign *design, double* IN_ARRAY2, int DIM1, int DIM2,
+                 int* IN_ARRAY1, int DIM1,
+                 int data_type, double* IN_ARRAY1, int DIM1,
+                 bool is_normal,
+                 int *IN_ARRAY1, int DIM1,
+                 int* IN_ARRAY1, int DIM1);
+
+void pywrap_session_fit(AbessSession *session, double* IN_ARRAY2, int DIM1, int DIM2, double* IN_ARRAY2, int DIM1, int DIM2,
+                 int algorithm_type, int model_type, int max_iter, int exchange_num,
+                 int path_type, bool is_warm_start,
+                 int ic_type, double ic_coef, bool is_cv, int K,
+                 int* IN_ARRAY1, int DIM1,
+                 int * IN_ARRAY1, int DIM1,
+                 double* IN_ARRAY1, int DIM1,
+                 int s_min, int s_max, int K_max, double epsilon,
+                 double lambda_min, double lambda_max, int n_lambda,
+                 bool is_screening, int screening_size, int powell_path,
+                 int * IN_ARRAY1, int DIM1, double tau,
+                 int primary_model_fit_max_iter, double primary_model_fit_epsilon,
+                 bool early_stop, bool approximate_Newton,
+                 int thread,
+                 bool covariance_update,
+                 int splicing_type,
+                 int important_search,
+                 double strong_rule,
+                 bool active_warm_start,
+                 int cox_ties,
+                 int primary_solver,
+                 bool parallel_exchange,
+                 double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* OUTPUT,
+                 double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1,
+                 int* ARGOUT_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1, int* OUTPUT);
+
+void pywrap_session_free(AbessSession *session);
+
+MappedDesign *pywrap_mapped_open(char *path);
+
+int pywrap_mapped_rows(MappedDesign *design);
+
+int pywrap_mapped_cols(MappedDesign *design);
+
+void pywrap_mapped_gather(MappedDesign *design, int* IN_ARRAY1, int DIM1, double* ARGOUT_ARRAY1, int DIM1);
+
+void pywrap_mapped_close(MappedDesign *design);
+
+void pywrap_cox_risk_sets(double* IN_ARRAY1, int DIM1, int* IN_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1, int* ARGOUT_ARRAY1, int DIM1);
 
 // .i文件里面不能加默认变量
 
@@ -10,15 +10,40 @@
 #else
 #include <Eigen/Eigen>
 #endif
+#include "GenotypeMatrix.h"
+#include "MappedDesign.h"
 
 void Normalize(Eigen::MatrixXd &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx);
 void Normalize(Eigen::MatrixXd &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx);
 void Normalize3(Eigen::MatrixXd &X, Eigen::VectorXd &y, Eigen::VectorXd &meanx, Eigen::VectorXd &normx);
 void Normalize4(Eigen::MatrixXd &X, Eigen::VectorXd &y, Eigen::VectorXd &normx);
 
+// re-center a new response, for a design that is already normalized
+void Normalize_y(Eigen::VectorXd &y, Eigen::VectorXd &weights, double &meany);
+void Normalize_y(Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meany);
+
+// a sparse X is scaled only, its centering is kept in Data::x_center
 void Normalize(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx);
 void Normalize(Eigen::SparseMatrix<double> &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx);
-void Normalize3(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &meanx, Eigen::VectorXd &normx);
-void Normalize4(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &y, Eigen::VectorXd &normx);
+void Normalize3(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx);
+void Normalize4(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx);
+
+// a float X is normalized in double, and rounded to float once
+void Normalize(Eigen::MatrixXf &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx);
+void Normalize(Eigen::MatrixXf &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx);
+void Normalize3(Eigen::MatrixXf &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx);
+void Normalize4(Eigen::MatrixXf &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx);
+
+// the genotypes are normalized through their value table, see GenotypeMatrix
+void Normalize(GenotypeMatrix &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx);
+void Normalize(GenotypeMatrix &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx);
+void Normalize3(GenotypeMatrix &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx);
+void Normalize4(GenotypeMatrix &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx);
+
+// a design on disk is normalized through its table, see MappedDesign
+void Normalize(MappedDesign &X, Eigen::VectorXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, double &meany, Eigen::VectorXd &normx);
+void Normalize(MappedDesign &X, Eigen::MatrixXd &y, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &meany, Eigen::VectorXd &normx);
+void Normalize3(MappedDesign &X, Eigen::VectorXd &weights, Eigen::VectorXd &meanx, Eigen::VectorXd &normx);
+void Normalize4(MappedDesign &X, Eigen::VectorXd &weights, Eigen::VectorXd &normx);
 
 #endif //BESS_NORMALIZE_H
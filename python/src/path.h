@@ -22,9 +22,10 @@ using namespace Eigen;
 #include "Metric.h"
 #include "abess.h"
 #include "utilities.h"
+#include "Session.h"
 
 template <class T1, class T2, class T3, class T4>
-void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algorithm<T1, T2, T3, T4> *algorithm, Metric<T1, T2, T3, T4> *metric, Eigen::VectorXi &sequence, Eigen::VectorXd &lambda_seq, bool early_stop, int k, Result<T2, T3> &result)
+void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algorithm<T1, T2, T3, T4> *algorithm, Metric<T1, T2, T3, T4> *metric, Eigen::VectorXi &sequence, Eigen::VectorXd &lambda_seq, bool early_stop, int k, Result<T2, T3> &result, std::vector<TrainCache<T1, T4>> &train_cache)
 {
 #ifdef TEST
     clock_t t0, t1, t2;
@@ -36,6 +37,7 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
     Eigen::VectorXi g_index = data.g_index;
     Eigen::VectorXi g_size = data.g_size;
     Eigen::VectorXi status = data.status;
+    Eigen::VectorXi test_status;
     int sequence_size = sequence.size();
     int lambda_size = lambda_seq.size();
     // int early_stop_s = sequence_size;
@@ -43,15 +45,15 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
     Eigen::VectorXi train_mask, test_mask;
     T1 train_y, test_y;
     Eigen::VectorXd train_weight, test_weight;
-    T4 train_x, test_x;
-    int train_n = 0, test_n = 0;
+    // a train fold is fitted on the full data through its rows, see Algorithm::train_mask,
+    // and the test rows are read from it as well, so that the design is never copied
+    int train_n = 0;
 #ifdef TEST
     t1 = clock();
 #endif
     // train & test data
     if (!metric->is_cv)
     {
-        train_x = data.x;
         train_y = data.y;
         train_weight = data.weight;
         train_n = data.n;
@@ -60,38 +62,23 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
     {
         train_mask = metric->train_mask_list[k];
         test_mask = metric->test_mask_list[k];
-        slice(data.x, train_mask, train_x);
-        slice(data.x, test_mask, test_x);
         slice(data.y, train_mask, train_y);
         slice(data.y, test_mask, test_y);
         slice(data.weight, train_mask, train_weight);
         slice(data.weight, test_mask, test_weight);
+        status = metric->fold_status(data.status, train_mask, data.n);
+        test_status = metric->fold_status(data.status, test_mask, data.n);
 
         train_n = train_mask.size();
-        test_n = test_mask.size();
     }
 #ifdef TEST
     t2 = clock();
     std::cout << "train_x time : " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
     cout << "path 1" << endl;
 #endif
-    Eigen::Matrix<T4, -1, -1> train_group_XTX = group_XTX<T4>(train_x, g_index, g_size, train_n, p, N, algorithm->model_type);
-#ifdef TEST
-    cout << "path 1.5" << endl;
-#endif
-    algorithm->update_group_XTX(train_group_XTX);
-    algorithm->PhiG.resize(0, 0);
-
-#ifdef TEST
-    cout << "path 2" << endl;
-#endif
-
-    if (algorithm->covariance_update)
-    {
-        algorithm->covariance_update_flag = Eigen::VectorXi::Zero(p);
-        algorithm->XTy = train_x.transpose() * train_y;
-        algorithm->XTone = train_x.transpose() * Eigen::MatrixXd::Ones(train_n, M);
-    }
+    // k = -1 is the full data
+    algorithm->update_train_mask(train_mask);
+    train_cache[k + 1].load(algorithm, data.x, train_y, g_index, g_size, train_n, p, N, M);
 #ifdef TEST
     cout << "path 3" << endl;
 #endif
@@ -102,6 +89,14 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
     Eigen::MatrixXd ic_matrix(sequence_size, lambda_size);
     Eigen::MatrixXd test_loss_matrix(sequence_size, lambda_size);
     Eigen::Matrix<VectorXd, Dynamic, Dynamic> bd_matrix(sequence_size, lambda_size);
+    Eigen::MatrixXi pruned_matrix(sequence_size, lambda_size);
+    Eigen::MatrixXi iter_matrix(sequence_size, lambda_size);
+    Eigen::MatrixXi primary_iter_matrix(sequence_size, lambda_size);
+    Eigen::MatrixXd primary_time_matrix(sequence_size, lambda_size);
+    // the primary fits counted are those of the path
+    int primary_iter;
+    double primary_time;
+    algorithm->primary_stats(primary_iter, primary_time);
 
     T2 beta_init;
     T3 coef0_init;
@@ -128,7 +123,7 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
             algorithm->update_coef0_init(coef0_init);
             algorithm->update_A_init(A_init, N);
 
-            algorithm->fit(train_x, train_y, train_weight, g_index, g_size, train_n, p, N, status, sigma);
+            algorithm->fit(data.x, train_y, train_weight, g_index, g_size, train_n, p, N, status, sigma);
 #ifdef TEST
             t2 = clock();
             std::cout << "fit time : " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
@@ -140,6 +135,8 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
                 beta_init = algorithm->get_beta();
                 coef0_init = algorithm->get_coef0();
                 bd_init = algorithm->get_bd();
+                if (algorithm->active_warm_start)
+                    A_init = algorithm->active_set.A;
             }
 #ifdef TEST
             t2 = clock();
@@ -150,7 +147,7 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
             // evaluate the beta
             if (metric->is_cv)
             {
-                test_loss_matrix(i, j) = metric->neg_loglik_loss(test_x, test_y, test_weight, g_index, g_size, test_n, p, N, algorithm);
+                test_loss_matrix(i, j) = metric->neg_loglik_loss(data.x, test_mask, test_y, test_weight, test_status, g_index, g_size, p, N, algorithm);
             }
             else
             {
@@ -167,6 +164,9 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
             coef0_matrix(i, j) = algorithm->coef0;
             train_loss_matrix(i, j) = algorithm->get_train_loss();
             bd_matrix(i, j) = algorithm->bd;
+            pruned_matrix(i, j) = algorithm->pruned_size;
+            iter_matrix(i, j) = algorithm->get_l();
+            algorithm->primary_stats(primary_iter_matrix(i, j), primary_time_matrix(i, j));
 
 #ifdef TEST
             t2 = clock();
@@ -194,16 +194,24 @@ void sequential_path_cv(Data<T1, T2, T3, T4> &data, Eigen::MatrixXd sigma, Algor
     //     ic_sequence = ic_sequence.block(0, 0, early_stop_s, lambda_size).eval();
     // }
 
+    train_cache[k + 1].save(algorithm);
+    train_mask.resize(0);
+    algorithm->update_train_mask(train_mask);
+
     result.beta_matrix = beta_matrix;
     result.coef0_matrix = coef0_matrix;
     result.train_loss_matrix = train_loss_matrix;
     result.bd_matrix = bd_matrix;
+    result.pruned_matrix = pruned_matrix;
+    result.iter_matrix = iter_matrix;
+    result.primary_iter_matrix = primary_iter_matrix;
+    result.primary_time_matrix = primary_time_matrix;
     result.ic_matrix = ic_matrix;
     result.test_loss_matrix = test_loss_matrix;
 }
 
 template <class T1, class T2, class T3, class T4>
-void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, vector<Algorithm<T1, T2, T3, T4> *> algorithm_list, Metric<T1, T2, T3, T4> *metric, int s_min, int s_max, Eigen::VectorXi &sequence, Eigen::VectorXd &lambda_seq, int K_max, double epsilon, bool is_parallel, Result<T2, T3> &result)
+void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, vector<Algorithm<T1, T2, T3, T4> *> algorithm_list, Metric<T1, T2, T3, T4> *metric, int s_min, int s_max, Eigen::VectorXi &sequence, Eigen::VectorXd &lambda_seq, int K_max, double epsilon, bool is_parallel, Result<T2, T3> &result, std::vector<TrainCache<T1, T4>> &train_cache)
 {
     int p = data.get_p();
     // int n = data.get_n();
@@ -213,45 +221,14 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
     sequence = Eigen::VectorXi::Zero(sequence_size);
     double lambda = lambda_seq[0];
 
-    Eigen::Matrix<T4, -1, -1> train_group_XTX = group_XTX<T4>(data.x, data.g_index, data.g_size, data.n, p, data.g_num, algorithm->model_type);
-#ifdef TEST
-    cout << "path 1.5" << endl;
-#endif
-    algorithm->update_group_XTX(train_group_XTX);
-    algorithm->PhiG.resize(0, 0);
-
-#ifdef TEST
-    cout << "path 2" << endl;
-#endif
-
-    if (algorithm->covariance_update)
-    {
-        algorithm->covariance_update_flag = Eigen::VectorXi::Zero(data.p);
-        algorithm->XTy = data.x.transpose() * data.y;
-        algorithm->XTone = data.x.transpose() * Eigen::MatrixXd::Ones(data.n, data.M);
-    }
+    train_cache[0].load(algorithm, data.x, data.y, data.g_index, data.g_size, data.n, p, data.g_num, data.M);
 
     if (metric->is_cv)
     {
         for (int k = 0; k < metric->Kfold; k++)
         {
-            Eigen::Matrix<T4, -1, -1> tmp_group_XTX = group_XTX<T4>(metric->train_X_list[k], data.g_index, data.g_size, metric->train_mask_list[k].size(), data.p, data.g_num, algorithm->model_type);
-#ifdef TEST
-            cout << "path 1.5" << endl;
-#endif
-            algorithm_list[k]->update_group_XTX(tmp_group_XTX);
-            algorithm_list[k]->PhiG.resize(0, 0);
-
-#ifdef TEST
-            cout << "path 2" << endl;
-#endif
-
-            if (algorithm_list[k]->covariance_update)
-            {
-                algorithm_list[k]->covariance_update_flag = Eigen::VectorXi::Zero(p);
-                algorithm_list[k]->XTy = metric->train_X_list[k].transpose() * metric->train_y_list[k];
-                algorithm_list[k]->XTone = metric->train_X_list[k].transpose() * Eigen::MatrixXd::Ones(metric->train_mask_list[k].size(), data.M);
-            }
+            algorithm_list[k]->update_train_mask(metric->train_mask_list[k]);
+            train_cache[k + 1].load(algorithm_list[k], data.x, metric->train_y_list[k], data.g_index, data.g_size, metric->train_mask_list[k].size(), data.p, data.g_num, data.M);
         }
     }
 
@@ -277,9 +254,18 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
     Eigen::Matrix<T2, Dynamic, Dynamic> beta_matrix(sequence_size, 1);
     Eigen::Matrix<T3, Dynamic, Dynamic> coef0_matrix(sequence_size, 1);
     Eigen::MatrixXd train_loss_matrix(sequence_size, 1);
-    Eigen::MatrixXd ic_matrix(sequence_size, 1);
-    Eigen::MatrixXd test_loss_matrix(sequence_size, 1);
+    // only one of them is evaluated, depending on is_cv
+    Eigen::MatrixXd ic_matrix = Eigen::MatrixXd::Zero(sequence_size, 1);
+    Eigen::MatrixXd test_loss_matrix = Eigen::MatrixXd::Zero(sequence_size, 1);
     Eigen::Matrix<VectorXd, Dynamic, Dynamic> bd_matrix(sequence_size, 1);
+    Eigen::MatrixXi pruned_matrix(sequence_size, 1);
+    Eigen::MatrixXi iter_matrix(sequence_size, 1);
+    Eigen::MatrixXi primary_iter_matrix(sequence_size, 1);
+    Eigen::MatrixXd primary_time_matrix(sequence_size, 1);
+    // the primary fits counted are those of the path
+    int primary_iter;
+    double primary_time;
+    algorithm->primary_stats(primary_iter, primary_time);
 
     T2 beta_init;
     T3 coef0_init;
@@ -327,6 +313,9 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
     coef0_matrix(0, 0) = algorithm->coef0;
     train_loss_matrix(0, 0) = algorithm->get_train_loss();
     bd_matrix(0, 0) = algorithm->bd;
+    pruned_matrix(0, 0) = algorithm->pruned_size;
+    iter_matrix(0, 0) = algorithm->get_l();
+    algorithm->primary_stats(primary_iter_matrix(0, 0), primary_time_matrix(0, 0));
 
     // beta_matrix.col(1) = algorithm->get_beta();
     // coef0_sequence(1) = algorithm->get_coef0();
@@ -372,6 +361,9 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
     coef0_matrix(1, 0) = algorithm->coef0;
     train_loss_matrix(1, 0) = algorithm->get_train_loss();
     bd_matrix(1, 0) = algorithm->bd;
+    pruned_matrix(1, 0) = algorithm->pruned_size;
+    iter_matrix(1, 0) = algorithm->get_l();
+    algorithm->primary_stats(primary_iter_matrix(1, 0), primary_time_matrix(1, 0));
 
     // algorithm->fit();
     // if (algorithm->warm_start)
@@ -439,6 +431,9 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
             coef0_matrix(iter, 0) = algorithm->coef0;
             train_loss_matrix(iter, 0) = algorithm->get_train_loss();
             bd_matrix(iter, 0) = algorithm->bd;
+            pruned_matrix(iter, 0) = algorithm->pruned_size;
+            iter_matrix(iter, 0) = algorithm->get_l();
+            algorithm->primary_stats(primary_iter_matrix(iter, 0), primary_time_matrix(iter, 0));
             // algorithm->update_train_mask(full_mask);
             // algorithm->update_sparsity_level(T1);
             // algorithm->update_beta_init(beta_init);
@@ -507,6 +502,9 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
             coef0_matrix(iter, 0) = algorithm->coef0;
             train_loss_matrix(iter, 0) = algorithm->get_train_loss();
             bd_matrix(iter, 0) = algorithm->bd;
+            pruned_matrix(iter, 0) = algorithm->pruned_size;
+            iter_matrix(iter, 0) = algorithm->get_l();
+            algorithm->primary_stats(primary_iter_matrix(iter, 0), primary_time_matrix(iter, 0));
             // algorithm->update_train_mask(full_mask);
             // algorithm->update_sparsity_level(T2);
             // algorithm->update_beta_init(beta_init);
@@ -582,6 +580,9 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
             coef0_matrix(iter, 0) = algorithm->coef0;
             train_loss_matrix(iter, 0) = algorithm->get_train_loss();
             bd_matrix(iter, 0) = algorithm->bd;
+            pruned_matrix(iter, 0) = algorithm->pruned_size;
+            iter_matrix(iter, 0) = algorithm->get_l();
+            algorithm->primary_stats(primary_iter_matrix(iter, 0), primary_time_matrix(iter, 0));
 
             sequence(iter) = T_tmp;
             // best_beta = algorithm->get_beta();
@@ -597,10 +598,25 @@ void gs_path(Data<T1, T2, T3, T4> &data, Algorithm<T1, T2, T3, T4> *algorithm, v
         }
     }
 
+    train_cache[0].save(algorithm);
+    if (metric->is_cv)
+    {
+        for (int k = 0; k < metric->Kfold; k++)
+        {
+            train_cache[k + 1].save(algorithm_list[k]);
+            Eigen::VectorXi full_mask;
+            algorithm_list[k]->update_train_mask(full_mask);
+        }
+    }
+
     result.beta_matrix = beta_matrix.block(0, 0, iter, 1);
     result.coef0_matrix = coef0_matrix.block(0, 0, iter, 1);
     result.train_loss_matrix = train_loss_matrix.block(0, 0, iter, 1);
     result.bd_matrix = bd_matrix.block(0, 0, iter, 1);
+    result.pruned_matrix = pruned_matrix.block(0, 0, iter, 1);
+    result.iter_matrix = iter_matrix.block(0, 0, iter, 1);
+    result.primary_iter_matrix = primary_iter_matrix.block(0, 0, iter, 1);
+    result.primary_time_matrix = primary_time_matrix.block(0, 0, iter, 1);
     result.ic_matrix = ic_matrix.block(0, 0, iter, 1);
     result.test_loss_matrix = test_loss_matrix.block(0, 0, iter, 1);
     sequence = sequence.head(iter).eval();
@@ -122,6 +122,109 @@ void VectorXd2Pointer(Eigen::VectorXd x_vector, double *x)
 //     }
 // }
 
+// Convert CSR (sparse_format = 1) or COO (sparse_format = 2) buffers into CSC arrays.
+// For CSR, ptr is the row pointer (n + 1) and idx the column index;
+// for COO, idx is the row index and ptr the column index (both nnz).
+// A parallel counting sort over columns, then each column is sorted by row
+// and duplicated entries are summed, as scipy does.
+void sparse_to_csc(int n, int p, int nnz, double *val, int *idx, int *ptr, int sparse_format, Eigen::VectorXi &outer, Eigen::VectorXi &inner, Eigen::VectorXd &value)
+{
+    Eigen::VectorXi row(nnz), col(nnz);
+    if (sparse_format == 1)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            for (int k = ptr[i]; k < ptr[i + 1]; k++)
+            {
+                row(k) = i;
+                col(k) = idx[k];
+            }
+        }
+    }
+    else
+    {
+        row = Eigen::Map<Eigen::VectorXi>(idx, nnz);
+        col = Eigen::Map<Eigen::VectorXi>(ptr, nnz);
+    }
+
+    // count
+    Eigen::VectorXi count = Eigen::VectorXi::Zero(p + 1);
+#pragma omp parallel for
+    for (int k = 0; k < nnz; k++)
+    {
+#pragma omp atomic
+        count(col(k) + 1)++;
+    }
+    for (int j = 0; j < p; j++)
+    {
+        count(j + 1) += count(j);
+    }
+
+    // scatter
+    Eigen::VectorXi next = count.head(p);
+    Eigen::VectorXi tmp_inner(nnz);
+    Eigen::VectorXd tmp_value(nnz);
+#pragma omp parallel for
+    for (int k = 0; k < nnz; k++)
+    {
+        int pos;
+#pragma omp atomic capture
+        pos = next(col(k))++;
+        tmp_inner(pos) = row(k);
+        tmp_value(pos) = val[k];
+    }
+
+    // sort each column by row and merge duplicates
+    Eigen::VectorXi col_nnz(p);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int j = 0; j < p; j++)
+    {
+        int start = count(j), len = count(j + 1) - count(j);
+        if (len > 1)
+        {
+            std::vector<std::pair<int, double>> entry(len);
+            for (int k = 0; k < len; k++)
+            {
+                entry[k] = std::make_pair(tmp_inner(start + k), tmp_value(start + k));
+            }
+            std::sort(entry.begin(), entry.end(), [](const std::pair<int, double> &a, const std::pair<int, double> &b) { return a.first < b.first; });
+            int m = 0;
+            for (int k = 0; k < len; k++)
+            {
+                if (m > 0 && entry[k].first == tmp_inner(start + m - 1))
+                {
+                    tmp_value(start + m - 1) += entry[k].second;
+                }
+                else
+                {
+                    tmp_inner(start + m) = entry[k].first;
+                    tmp_value(start + m) = entry[k].second;
+                    m++;
+                }
+            }
+            len = m;
+        }
+        col_nnz(j) = len;
+    }
+
+    // compress
+    outer.resize(p + 1);
+    outer(0) = 0;
+    for (int j = 0; j < p; j++)
+    {
+        outer(j + 1) = outer(j) + col_nnz(j);
+    }
+    inner.resize(outer(p));
+    value.resize(outer(p));
+#pragma omp parallel for
+    for (int j = 0; j < p; j++)
+    {
+        inner.segment(outer(j), col_nnz(j)) = tmp_inner.segment(count(j), col_nnz(j));
+        value.segment(outer(j), col_nnz(j)) = tmp_value.segment(count(j), col_nnz(j));
+    }
+}
+
 Eigen::VectorXi find_ind(Eigen::VectorXi &L, Eigen::VectorXi &index, Eigen::VectorXi &gsize, int p, int N)
 {
     if (L.size() == N)
@@ -247,71 +350,167 @@ Eigen::VectorXi vector_slice(Eigen::VectorXi &nums, Eigen::VectorXi &ind)
 // }
 
 // replace B by C in A
-// to do : binary search
 Eigen::VectorXi diff_union(Eigen::VectorXi A, Eigen::VectorXi &B, Eigen::VectorXi &C)
 {
-    unsigned int k;
-    for (unsigned int i = 0; i < B.size(); i++)
-    {
-        for (k = 0; k < A.size(); k++)
-        {
-            if (B(i) == A(k))
-            {
-                A(k) = C(i);
-                break;
-            }
-        }
-    }
-    sort(A.data(), A.data() + A.size());
-    return A;
+    IndexSet set;
+    set.A = A;
+    sort(set.A.data(), set.A.data() + set.A.size());
+    return set.exchange(B, C);
 }
 
-Eigen::VectorXi min_k(Eigen::VectorXd &vec, int k, bool sort_by_value)
+// the first k entries of order in rule, sorted by index, or by rule if sort_by_value
+template <class Rule>
+static Eigen::VectorXi select_k(int k, bool sort_by_value, Eigen::VectorXi &order, Rule rule)
 {
-    Eigen::VectorXi ind = Eigen::VectorXi::LinSpaced(vec.size(), 0, vec.size() - 1); //[0 1 2 3 ... N-1]
-    auto rule = [vec](int i, int j) -> bool {
-        return vec(i) < vec(j);
-    }; // sort rule
-    std::nth_element(ind.data(), ind.data() + k, ind.data() + ind.size(), rule);
+    std::nth_element(order.data(), order.data() + k, order.data() + order.size(), rule);
     if (sort_by_value)
     {
-        std::sort(ind.data(), ind.data() + k, rule);
+        std::sort(order.data(), order.data() + k, rule);
     }
     else
     {
-        std::sort(ind.data(), ind.data() + k);
+        std::sort(order.data(), order.data() + k);
     }
+    return order.head(k);
+}
 
-    return ind.head(k).eval();
+Eigen::VectorXi min_k(Eigen::VectorXd &vec, int k, bool sort_by_value, Eigen::VectorXi &order)
+{
+    order = Eigen::VectorXi::LinSpaced(vec.size(), 0, vec.size() - 1); //[0 1 2 3 ... N-1]
+    return select_k(k, sort_by_value, order, [&vec](int i, int j) -> bool {
+        return vec(i) < vec(j);
+    });
 }
 
-Eigen::VectorXi max_k(Eigen::VectorXd &vec, int k, bool sort_by_value)
+Eigen::VectorXi max_k(Eigen::VectorXd &vec, int k, bool sort_by_value, Eigen::VectorXi &order)
 {
-    Eigen::VectorXi ind = Eigen::VectorXi::LinSpaced(vec.size(), 0, vec.size() - 1); //[0 1 2 3 ... N-1]
-    auto rule = [vec](int i, int j) -> bool {
+    order = Eigen::VectorXi::LinSpaced(vec.size(), 0, vec.size() - 1); //[0 1 2 3 ... N-1]
+    return select_k(k, sort_by_value, order, [&vec](int i, int j) -> bool {
         return vec(i) > vec(j);
-    }; // sort rule
-    std::nth_element(ind.data(), ind.data() + k, ind.data() + ind.size(), rule);
-    if (sort_by_value)
+    });
+}
+
+Eigen::VectorXi min_k(Eigen::VectorXd &vec, int k, bool sort_by_value)
+{
+    Eigen::VectorXi order;
+    return min_k(vec, k, sort_by_value, order);
+}
+
+Eigen::VectorXi max_k(Eigen::VectorXd &vec, int k, bool sort_by_value)
+{
+    Eigen::VectorXi order;
+    return max_k(vec, k, sort_by_value, order);
+}
+
+Eigen::VectorXi max_k_2(Eigen::VectorXd &vec, int k)
+{
+    return max_k(vec, k, false);
+}
+
+void IndexSet::assign(const Eigen::VectorXi &A, int N)
+{
+    this->N = N;
+    this->A = A;
+    this->bits.assign(N, false);
+    for (int i = 0; i < A.size(); i++)
     {
-        std::sort(ind.data(), ind.data() + k, rule);
+        this->bits[A(i)] = true;
     }
-    else
+    this->I.resize(N - A.size());
+    for (int i = 0, j = 0; i < N; i++)
     {
-        std::sort(ind.data(), ind.data() + k);
+        if (!this->bits[i])
+            this->I(j++) = i;
     }
-    return ind.head(k).eval();
 }
 
-Eigen::VectorXi max_k_2(Eigen::VectorXd &vec, int k)
+Eigen::VectorXi IndexSet::exchange(const Eigen::VectorXi &B, const Eigen::VectorXi &C) const
 {
-    Eigen::VectorXi ind = Eigen::VectorXi::LinSpaced(vec.size(), 0, vec.size() - 1); //[0 1 2 3 ... N-1]
-    auto rule = [vec](int i, int j) -> bool {
-        return vec(i) > vec(j);
-    }; // sort rule
-    std::nth_element(ind.data(), ind.data() + k, ind.data() + ind.size(), rule);
-    std::sort(ind.data(), ind.data() + k);
-    return ind.head(k).eval();
+    Eigen::VectorXi B_sorted = B, C_sorted = C;
+    std::sort(B_sorted.data(), B_sorted.data() + B_sorted.size());
+    std::sort(C_sorted.data(), C_sorted.data() + C_sorted.size());
+
+    Eigen::VectorXi A_new(this->A.size() - B.size() + C.size());
+    int a = 0, b = 0, c = 0, k = 0;
+    while (a < this->A.size())
+    {
+        if (b < B_sorted.size() && this->A(a) == B_sorted(b))
+        {
+            a++;
+            b++;
+        }
+        else if (c < C_sorted.size() && C_sorted(c) < this->A(a))
+        {
+            A_new(k++) = C_sorted(c++);
+        }
+        else
+        {
+            A_new(k++) = this->A(a++);
+        }
+    }
+    while (c < C_sorted.size())
+    {
+        A_new(k++) = C_sorted(c++);
+    }
+    return A_new;
+}
+
+void IndexSet::update(const Eigen::VectorXi &A_new)
+{
+    for (int i = 0; i < this->A.size(); i++)
+    {
+        this->bits[this->A(i)] = false;
+    }
+    for (int i = 0; i < A_new.size(); i++)
+    {
+        this->bits[A_new(i)] = true;
+    }
+
+    // I \ A_new and A \ A_new, merged
+    this->I_new.resize(this->N - A_new.size());
+    int i = 0, a = 0, k = 0;
+    while (i < this->I.size() || a < this->A.size())
+    {
+        int next;
+        if (a >= this->A.size() || (i < this->I.size() && this->I(i) < this->A(a)))
+            next = this->I(i++);
+        else
+            next = this->A(a++);
+        if (!this->bits[next])
+            this->I_new(k++) = next;
+    }
+    this->I.swap(this->I_new);
+    this->A = A_new;
+}
+
+uint64_t IndexSet::hash() const
+{
+    // FNV-1a over the entries
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < this->A.size(); i++)
+    {
+        h = (h ^ (uint64_t)(uint32_t)this->A(i)) * 1099511628211ULL;
+    }
+    return h;
+}
+
+void IndexSetHistory::clear()
+{
+    this->hashes.clear();
+    this->sets.clear();
+}
+
+bool IndexSetHistory::seen(const IndexSet &A)
+{
+    uint64_t h = A.hash();
+    for (unsigned int i = 0; i < this->hashes.size(); i++)
+    {
+        if (this->hashes[i] == h && this->sets[i] == A.A)
+            return true;
+    }
+    this->hashes.push_back(h);
+    this->sets.push_back(A.A);
+    return false;
 }
 
 // Ac
@@ -432,39 +631,60 @@ void slice(Eigen::MatrixXd &nums, Eigen::VectorXi &ind, Eigen::MatrixXd &A, int
     }
 }
 
+void slice(Eigen::MatrixXf &nums, Eigen::VectorXi &ind, Eigen::MatrixXf &A, int axis)
+{
+    if (axis == 0)
+    {
+        A.resize(ind.size(), nums.cols());
+        for (int i = 0; i < ind.size(); i++)
+        {
+            A.row(i) = nums.row(ind(i));
+        }
+    }
+    else
+    {
+        A.resize(nums.rows(), ind.size());
+        for (int i = 0; i < ind.size(); i++)
+        {
+            A.col(i) = nums.col(ind(i));
+        }
+    }
+}
+
+void slice(GenotypeMatrix &nums, Eigen::VectorXi &ind, GenotypeMatrix &A, int axis)
+{
+    nums.slice(ind, A, axis);
+}
+
+void slice(MappedDesign &nums, Eigen::VectorXi &ind, MappedDesign &A, int axis)
+{
+    nums.slice(ind, A, axis);
+}
+
 void slice(Eigen::SparseMatrix<double> &nums, Eigen::VectorXi &ind, Eigen::SparseMatrix<double> &A, int axis)
 {
     if (axis == 0)
     {
-#ifdef TEST
-        clock_t t1, t2;
-        t1 = clock();
-#endif
-        Eigen::SparseMatrix<double, Eigen::RowMajor> nums_row(nums);
-        Eigen::SparseMatrix<double, Eigen::RowMajor> A_row(ind.size(), nums.cols());
-        A_row.reserve(nums.nonZeros());
-#ifdef TEST
-        t2 = clock();
-        std::cout << "slice 1 : " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
-        t1 = clock();
-#endif
-        if (ind.size() != 0)
+        // the rows in ind are distinct, each kept row is mapped to its position in A
+        Eigen::VectorXi row_map = Eigen::VectorXi::Constant(nums.rows(), -1);
+        for (int i = 0; i < ind.size(); i++)
         {
-            for (int i = 0; i < ind.size(); i++)
+            row_map(ind(i)) = i;
+        }
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(nums.nonZeros());
+        for (int j = 0; j < nums.outerSize(); j++)
+        {
+            for (Eigen::SparseMatrix<double>::InnerIterator it(nums, j); it; ++it)
             {
-                A_row.row(i) = nums_row.row(ind(i));
+                if (row_map(it.row()) >= 0)
+                {
+                    triplets.push_back(Eigen::Triplet<double>(row_map(it.row()), j, it.value()));
+                }
             }
         }
-#ifdef TEST
-        t2 = clock();
-        std::cout << "slice 2 : " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
-        t1 = clock();
-#endif
-        A = A_row;
-#ifdef TEST
-        t2 = clock();
-        std::cout << "slice 3 : " << ((double)(t2 - t1) / CLOCKS_PER_SEC) << endl;
-#endif
+        A.resize(ind.size(), nums.cols());
+        A.setFromTriplets(triplets.begin(), triplets.end());
     }
     else
     {
@@ -522,6 +742,54 @@ void slice_restore(Eigen::MatrixXd &A, Eigen::VectorXi &ind, Eigen::MatrixXd &nu
     }
 }
 
+void slice_restore(Eigen::VectorXd &A, Eigen::VectorXi &ind, Eigen::VectorXd &nums, Eigen::VectorXi &support)
+{
+    for (int i = 0; i < support.size(); i++)
+    {
+        nums(support(i)) = 0;
+    }
+    for (int i = 0; i < ind.size(); i++)
+    {
+        nums(ind(i)) = A(i);
+    }
+}
+
+void slice_restore(Eigen::MatrixXd &A, Eigen::VectorXi &ind, Eigen::MatrixXd &nums, Eigen::VectorXi &support)
+{
+    for (int i = 0; i < support.size(); i++)
+    {
+        nums.row(support(i)).setZero();
+    }
+    for (int i = 0; i < ind.size(); i++)
+    {
+        nums.row(ind(i)) = A.row(i);
+    }
+}
+
+Eigen::VectorXi nonzero_ind(Eigen::VectorXd &nums)
+{
+    Eigen::VectorXi ind(nums.size());
+    int k = 0;
+    for (int i = 0; i < nums.size(); i++)
+    {
+        if (nums(i) != 0)
+            ind(k++) = i;
+    }
+    return ind.head(k).eval();
+}
+
+Eigen::VectorXi nonzero_ind(Eigen::MatrixXd &nums)
+{
+    Eigen::VectorXi ind(nums.rows());
+    int k = 0;
+    for (int i = 0; i < nums.rows(); i++)
+    {
+        if ((nums.row(i).array() != 0).any())
+            ind(k++) = i;
+    }
+    return ind.head(k).eval();
+}
+
 void coef_set_zero(int p, int M, Eigen::VectorXd &beta, double &coef0)
 {
     beta = Eigen::VectorXd::Zero(p);
@@ -619,6 +887,21 @@ Eigen::VectorXd matrix_dot(Eigen::MatrixXd &A, Eigen::VectorXd &B)
 //     }
 // }
 
+void matrix_sqrt_inverse(Eigen::MatrixXd &A, Eigen::MatrixXd &B, Eigen::MatrixXd &C)
+{
+    if (A.rows() == 1)
+    {
+        // as the general case gives it, with the pseudo-inverse of LDLT
+        B.resize(1, 1);
+        C.resize(1, 1);
+        B(0, 0) = std::sqrt(A(0, 0));
+        C(0, 0) = B(0, 0) > 1 / Eigen::NumTraits<double>::highest() ? 1 / B(0, 0) : 0;
+        return;
+    }
+    A.sqrt().evalTo(B);
+    C = B.ldlt().solve(Eigen::MatrixXd::Identity(A.rows(), A.rows()));
+}
+
 void add_constant_column(Eigen::MatrixXd &X)
 {
     X.col(0) = Eigen::MatrixXd::Ones(X.rows(), 1);
@@ -632,6 +915,329 @@ void add_constant_column(Eigen::SparseMatrix<double> &X)
     }
 }
 
+double center_shift(Eigen::VectorXd &center, Eigen::VectorXd &beta)
+{
+    return center.size() != 0 ? center.dot(beta) : 0;
+}
+
+Eigen::VectorXd center_shift(Eigen::VectorXd &center, Eigen::MatrixXd &beta)
+{
+    if (center.size() == 0)
+        return Eigen::VectorXd::Zero(beta.cols());
+    return beta.transpose() * center;
+}
+
+void center_XTHX(Eigen::MatrixXd &XTHX, Eigen::VectorXd &XTh, double h_sum, Eigen::VectorXd &center)
+{
+    XTHX -= center * XTh.transpose() + XTh * center.transpose();
+    XTHX += h_sum * center * center.transpose();
+}
+
+void center_XTHZ(Eigen::MatrixXd &XTHZ, Eigen::VectorXd &XTh, Eigen::VectorXd &ZTh, double h_sum, Eigen::VectorXd &x_center, Eigen::VectorXd &z_center)
+{
+    XTHZ -= x_center * ZTh.transpose() + XTh * z_center.transpose();
+    XTHZ += h_sum * x_center * z_center.transpose();
+}
+
+void move_columns(Eigen::MatrixXd &X_A, Eigen::VectorXi &from, Eigen::MatrixXd &X_read, Eigen::MatrixXd &X_new)
+{
+    int m = from.size();
+    if (&X_new != &X_A || X_A.rows() != X_read.rows())
+    {
+        Eigen::MatrixXd X_tmp(X_read.rows(), m);
+        for (int j = 0, r = 0; j < m; j++)
+        {
+            if (from(j) >= 0)
+                X_tmp.col(j) = X_A.col(from(j));
+            else
+                X_tmp.col(j) = X_read.col(r++);
+        }
+        X_new.swap(X_tmp);
+        return;
+    }
+
+    // in place: from is increasing over the columns kept, so the ones moving left are moved
+    // from the left and the ones moving right from the right, before the new ones are read in
+    if (m > X_A.cols())
+        X_A.conservativeResize(Eigen::NoChange, m);
+    for (int j = 0; j < m; j++)
+    {
+        if (from(j) > j)
+            X_A.col(j) = X_A.col(from(j));
+    }
+    for (int j = m - 1; j >= 0; j--)
+    {
+        if (from(j) >= 0 && from(j) < j)
+            X_A.col(j) = X_A.col(from(j));
+    }
+    for (int j = 0, r = 0; j < m; j++)
+    {
+        if (from(j) < 0)
+            X_A.col(j) = X_read.col(r++);
+    }
+    if (m < X_A.cols())
+        X_A.conservativeResize(Eigen::NoChange, m);
+}
+
+void move_columns(Eigen::SparseMatrix<double> &X_A, Eigen::VectorXi &from, Eigen::SparseMatrix<double> &X_read, Eigen::SparseMatrix<double> &X_new)
+{
+    int m = from.size();
+    Eigen::SparseMatrix<double> X_tmp(X_read.rows(), m);
+    X_tmp.reserve(X_A.nonZeros() + X_read.nonZeros());
+    for (int j = 0, r = 0; j < m; j++)
+    {
+        if (from(j) >= 0)
+            X_tmp.col(j) = X_A.col(from(j));
+        else
+            X_tmp.col(j) = X_read.col(r++);
+    }
+    X_new.swap(X_tmp);
+}
+
+void cholesky_delete(Eigen::MatrixXd &L, int j)
+{
+    int m = L.rows();
+    int t = m - j - 1;
+    // the factor of the trailing block takes the rank-one update by the deleted column
+    Eigen::VectorXd x = L.col(j).tail(t);
+    for (int k = 0; k < t; k++)
+    {
+        double l_kk = L(j + 1 + k, j + 1 + k);
+        double r = sqrt(l_kk * l_kk + x(k) * x(k));
+        double c = r / l_kk;
+        double s = x(k) / l_kk;
+        L(j + 1 + k, j + 1 + k) = r;
+        int rest = t - k - 1;
+        if (rest > 0)
+        {
+            L.col(j + 1 + k).tail(rest) = (L.col(j + 1 + k).tail(rest) + s * x.tail(rest)) / c;
+            x.tail(rest) = c * x.tail(rest) - s * L.col(j + 1 + k).tail(rest);
+        }
+    }
+    Eigen::MatrixXd L_new = Eigen::MatrixXd::Zero(m - 1, m - 1);
+    L_new.topLeftCorner(j, j) = L.topLeftCorner(j, j);
+    L_new.bottomLeftCorner(t, j) = L.bottomLeftCorner(t, j);
+    L_new.bottomRightCorner(t, t) = L.bottomRightCorner(t, t);
+    L = L_new;
+}
+
+bool cholesky_append(Eigen::MatrixXd &L, const Eigen::VectorXd &col)
+{
+    int m = L.rows();
+    Eigen::VectorXd l = L.triangularView<Eigen::Lower>().solve(col.head(m));
+    double d2 = col(m) - l.squaredNorm();
+    if (d2 <= 1e-10 * col(m))
+        return false;
+    Eigen::MatrixXd L_new = Eigen::MatrixXd::Zero(m + 1, m + 1);
+    L_new.topLeftCorner(m, m) = L;
+    L_new.row(m).head(m) = l.transpose();
+    L_new(m, m) = sqrt(d2);
+    L = L_new;
+    return true;
+}
+
+Eigen::VectorXd XTr(Eigen::MatrixXf &X, const Eigen::VectorXd &r, Eigen::VectorXd &center)
+{
+    Eigen::VectorXd result(X.cols());
+#pragma omp parallel for
+    for (int j = 0; j < X.cols(); j++)
+    {
+        result(j) = X.col(j).cast<double>().dot(r);
+    }
+    if (center.size() != 0)
+        result -= r.sum() * center;
+    return result;
+}
+
+Eigen::MatrixXd XTr(Eigen::MatrixXf &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center)
+{
+    Eigen::MatrixXd result(X.cols(), r.cols());
+#pragma omp parallel for
+    for (int j = 0; j < X.cols(); j++)
+    {
+        Eigen::VectorXd x_j = X.col(j).cast<double>();
+        result.row(j) = x_j.transpose() * r;
+    }
+    if (center.size() != 0)
+        result -= center * r.colwise().sum();
+    return result;
+}
+
+Eigen::VectorXd XTr(GenotypeMatrix &X, const Eigen::VectorXd &r, Eigen::VectorXd &center)
+{
+    Eigen::VectorXd result(X.cols());
+#pragma omp parallel for
+    for (int j = 0; j < X.cols(); j++)
+    {
+        result(j) = X.dot(j, r.data());
+    }
+    return result;
+}
+
+Eigen::MatrixXd XTr(GenotypeMatrix &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center)
+{
+    Eigen::MatrixXd result(X.cols(), r.cols());
+#pragma omp parallel for
+    for (int j = 0; j < X.cols(); j++)
+    {
+        for (int m = 0; m < r.cols(); m++)
+            result(j, m) = X.dot(j, r.col(m).data());
+    }
+    return result;
+}
+
+Eigen::MatrixXd X_cols(GenotypeMatrix &X, int start, int size)
+{
+    Eigen::MatrixXd X_new(X.rows(), size);
+    for (int k = 0; k < size; k++)
+    {
+        X.unpack(start + k, X_new.col(k).data());
+    }
+    return X_new;
+}
+
+void X_cols(GenotypeMatrix &X, int start, int size, Eigen::MatrixXd &X_new)
+{
+    X_new.resize(X.rows(), size);
+    for (int k = 0; k < size; k++)
+    {
+        X.unpack(start + k, X_new.col(k).data());
+    }
+}
+
+Eigen::MatrixXd X_seg(GenotypeMatrix &X, int n, Eigen::VectorXi &ind)
+{
+    Eigen::MatrixXd X_new(n, ind.size());
+    for (int k = 0; k < ind.size(); k++)
+    {
+        X.unpack(ind(k), X_new.col(k).data());
+    }
+    return X_new;
+}
+
+Eigen::MatrixXd X_seg(GenotypeMatrix &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind)
+{
+    if (rows.size() == 0)
+        return X_seg(X, X.rows(), ind);
+    Eigen::MatrixXd X_new(rows.size(), ind.size());
+    Eigen::VectorXd col(X.rows());
+    for (int k = 0; k < ind.size(); k++)
+    {
+        X.unpack(ind(k), col.data());
+        for (int i = 0; i < rows.size(); i++)
+        {
+            X_new(i, k) = col(rows(i));
+        }
+    }
+    return X_new;
+}
+
+Eigen::SparseMatrix<double> X_seg(Eigen::SparseMatrix<double> &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind)
+{
+    if (rows.size() == 0)
+        return X_seg(X, X.rows(), ind);
+    // each row in rows is mapped to its position in X_new
+    Eigen::VectorXi row_map = Eigen::VectorXi::Constant(X.rows(), -1);
+    for (int i = 0; i < rows.size(); i++)
+    {
+        row_map(rows(i)) = i;
+    }
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (int k = 0; k < ind.size(); k++)
+    {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(X, ind(k)); it; ++it)
+        {
+            if (row_map(it.row()) >= 0)
+                triplets.push_back(Eigen::Triplet<double>(row_map(it.row()), k, it.value()));
+        }
+    }
+    Eigen::SparseMatrix<double> X_new(rows.size(), ind.size());
+    X_new.setFromTriplets(triplets.begin(), triplets.end());
+    return X_new;
+}
+
+Eigen::MatrixXd XTX_full(GenotypeMatrix &X)
+{
+    Eigen::MatrixXd X_all = X_cols(X, 0, X.cols());
+    return X_all.transpose() * X_all;
+}
+
+// the columns on disk are read by blocks of this size
+static const int MAPPED_BLOCK_COLS = 256;
+
+Eigen::VectorXd XTr(MappedDesign &X, const Eigen::VectorXd &r, Eigen::VectorXd &center)
+{
+    Eigen::VectorXd result(X.cols());
+    for (int start = 0; start < X.cols(); start += MAPPED_BLOCK_COLS)
+    {
+        int cols = std::min(MAPPED_BLOCK_COLS, X.cols() - start);
+        int next = start + cols;
+        X.advise(next, std::min(cols, X.cols() - next), true);
+#pragma omp parallel for
+        for (int j = start; j < next; j++)
+        {
+            result(j) = X.dot(j, r.data());
+        }
+        X.advise(start, cols, false);
+    }
+    return result;
+}
+
+Eigen::MatrixXd XTr(MappedDesign &X, const Eigen::MatrixXd &r, Eigen::VectorXd &center)
+{
+    Eigen::MatrixXd result(X.cols(), r.cols());
+    for (int start = 0; start < X.cols(); start += MAPPED_BLOCK_COLS)
+    {
+        int cols = std::min(MAPPED_BLOCK_COLS, X.cols() - start);
+        int next = start + cols;
+        X.advise(next, std::min(cols, X.cols() - next), true);
+#pragma omp parallel for
+        for (int j = start; j < next; j++)
+        {
+            for (int m = 0; m < r.cols(); m++)
+                result(j, m) = X.dot(j, r.col(m).data());
+        }
+        X.advise(start, cols, false);
+    }
+    return result;
+}
+
+Eigen::MatrixXd X_cols(MappedDesign &X, int start, int size)
+{
+    Eigen::MatrixXd X_new;
+    X.read_block(start, size, X_new);
+    return X_new;
+}
+
+void X_cols(MappedDesign &X, int start, int size, Eigen::MatrixXd &X_new)
+{
+    X.read_block(start, size, X_new);
+}
+
+Eigen::MatrixXd X_seg(MappedDesign &X, int n, Eigen::VectorXi &ind)
+{
+    Eigen::MatrixXd X_new;
+    X.read_cols(ind, X_new);
+    return X_new;
+}
+
+Eigen::MatrixXd X_seg(MappedDesign &X, Eigen::VectorXi &rows, Eigen::VectorXi &ind)
+{
+    Eigen::MatrixXd X_ind;
+    X.read_cols(ind, X_ind);
+    if (rows.size() == 0)
+        return X_ind;
+    Eigen::MatrixXd X_new;
+    slice(X_ind, rows, X_new, 0);
+    return X_new;
+}
+
+Eigen::MatrixXd XTX_full(MappedDesign &X)
+{
+    Eigen::MatrixXd X_all = X_cols(X, 0, X.cols());
+    return X_all.transpose() * X_all;
+}
+
 void set_nonzeros(Eigen::MatrixXd &X, Eigen::MatrixXd &x)
 {
     return;
@@ -678,3 +1284,78 @@ void overload_ldlt(Eigen::MatrixXd &X_new, Eigen::MatrixXd &X, Eigen::MatrixXd &
 {
     beta = (X_new.transpose() * X).ldlt().solve(X_new.transpose() * Z);
 }
+
+void weighted_gram(Eigen::MatrixXd &X, Eigen::VectorXd &w, Eigen::VectorXd &z, Eigen::MatrixXd &XTWX, Eigen::VectorXd &XTWz)
+{
+    const int block = 256;
+    const int max_chunks = 16;
+    int n = X.rows();
+    int q = X.cols();
+    bool with_z = z.size() == n;
+    int chunks = std::max(1, std::min(max_chunks, (n + block - 1) / block));
+    std::vector<Eigen::MatrixXd> gram(chunks);
+    std::vector<Eigen::VectorXd> xtwz(chunks);
+
+#pragma omp parallel for schedule(static) if (chunks > 1)
+    for (int c = 0; c < chunks; c++)
+    {
+        int begin = (int)((long long)n * c / chunks);
+        int end = (int)((long long)n * (c + 1) / chunks);
+        gram[c] = Eigen::MatrixXd::Zero(q, q);
+        xtwz[c] = Eigen::VectorXd::Zero(with_z ? q : 0);
+
+        // the rows of a block scaled by sqrt(|w|), those with w > 0 from the top and those with w < 0 from the bottom
+        Eigen::MatrixXd rows(block, q);
+        Eigen::VectorXi index(block);
+        Eigen::VectorXd root(block);
+        for (int r = begin; r < end; r += block)
+        {
+            int size = std::min(block, end - r);
+            int top = 0, bottom = block;
+            for (int i = r; i < r + size; i++)
+            {
+                if (w(i) > 0)
+                {
+                    index(top) = i;
+                    root(top++) = sqrt(w(i));
+                }
+                else if (w(i) < 0)
+                {
+                    index(--bottom) = i;
+                    root(bottom) = sqrt(-w(i));
+                }
+            }
+            for (int j = 0; j < q; j++)
+            {
+                for (int k = 0; k < top; k++)
+                    rows(k, j) = root(k) * X(index(k), j);
+                for (int k = bottom; k < block; k++)
+                    rows(k, j) = root(k) * X(index(k), j);
+            }
+            if (top > 0)
+                gram[c].selfadjointView<Eigen::Lower>().rankUpdate(rows.topRows(top).transpose());
+            if (bottom < block)
+                gram[c].selfadjointView<Eigen::Lower>().rankUpdate(rows.bottomRows(block - bottom).transpose(), -1.0);
+            if (with_z)
+                xtwz[c].noalias() += X.middleRows(r, size).transpose() * w.segment(r, size).cwiseProduct(z.segment(r, size));
+        }
+    }
+
+    for (int c = 1; c < chunks; c++)
+        gram[0] += gram[c];
+    XTWX = gram[0].selfadjointView<Eigen::Lower>();
+    if (with_z)
+    {
+        XTWz = xtwz[0];
+        for (int c = 1; c < chunks; c++)
+            XTWz += xtwz[c];
+    }
+}
+
+void weighted_gram(Eigen::SparseMatrix<double> &X, Eigen::VectorXd &w, Eigen::VectorXd &z, Eigen::MatrixXd &XTWX, Eigen::VectorXd &XTWz)
+{
+    Eigen::SparseMatrix<double> WX = w.asDiagonal() * X;
+    XTWX = X.transpose() * WX;
+    if (z.size() == X.rows())
+        XTWz = WX.transpose() * z;
+}